@@ -0,0 +1,152 @@
+/*
+ * Boot Profiler Implementation
+ *
+ * Times come from esp_timer (started by the IDF before app_main), so
+ * ROM and bootloader time before it is not included. The RTC copy is
+ * protected by a magic and a CRC that is refreshed on every update; on
+ * power-on the RTC contents are random and fail the check.
+ */
+
+#include "boot_profiler.h"
+#include <esp_attr.h>
+#include <esp_timer.h>
+#include <esp_system.h>
+#include <esp_rom_crc.h>
+
+#define BOOT_RTC_MAGIC 0x424F4F54  // "BOOT"
+
+struct RtcBootRecord {
+  uint32_t magic;
+  uint32_t crc;
+  BootTimeline timeline;
+};
+
+// Survives software, watchdog and brownout resets (not power-on)
+RTC_NOINIT_ATTR static RtcBootRecord rtcRecord;
+
+static BootTimeline previous;
+static bool previousValid = false;
+static int openPhase = -1;
+
+static const char* const markNames[BOOT_MARK_COUNT] = {
+  "sensorArmed", "setupDone", "wifiConnected", "printerConnected"
+};
+
+static uint32_t timelineCrc(const BootTimeline& timeline) {
+  return esp_rom_crc32_le(0, (const uint8_t*)&timeline, sizeof(timeline));
+}
+
+static void sealRecord() {
+  rtcRecord.crc = timelineCrc(rtcRecord.timeline);
+}
+
+static uint32_t nowUs() {
+  // 0 means "not reached" for marks
+  uint32_t us = (uint32_t)esp_timer_get_time();
+  return us != 0 ? us : 1;
+}
+
+void bootProfilerBegin() {
+  BootTimeline& timeline = rtcRecord.timeline;
+  uint32_t bootCount = 1;
+
+  if (rtcRecord.magic == BOOT_RTC_MAGIC && rtcRecord.crc == timelineCrc(timeline) &&
+      timeline.phaseCount <= BOOT_MAX_PHASES) {
+    previous = timeline;
+    previousValid = true;
+    bootCount = timeline.bootCount + 1;
+  }
+
+  memset(&timeline, 0, sizeof(timeline));
+  timeline.bootCount = bootCount;
+  timeline.resetReason = (uint8_t)esp_reset_reason();
+  rtcRecord.magic = BOOT_RTC_MAGIC;
+  openPhase = -1;
+  sealRecord();
+}
+
+static void closePhase(uint32_t now) {
+  if (openPhase >= 0) {
+    BootPhase& phase = rtcRecord.timeline.phases[openPhase];
+    phase.durationUs = now - phase.startUs;
+    openPhase = -1;
+  }
+}
+
+void bootPhase(const char* name) {
+  BootTimeline& timeline = rtcRecord.timeline;
+  uint32_t now = nowUs();
+
+  closePhase(now);
+  if (timeline.phaseCount < BOOT_MAX_PHASES) {
+    openPhase = timeline.phaseCount++;
+    BootPhase& phase = timeline.phases[openPhase];
+    strlcpy(phase.name, name, sizeof(phase.name));
+    phase.startUs = now;
+    phase.durationUs = 0;
+  }
+  sealRecord();
+}
+
+void bootProfilerEnd() {
+  closePhase(nowUs());
+  bootProfilerMark(BOOT_MARK_SETUP_DONE);
+  printBootTimeline();
+}
+
+void bootProfilerMark(BootMark mark) {
+  if (rtcRecord.timeline.marks[mark] != 0) {
+    return;
+  }
+  rtcRecord.timeline.marks[mark] = nowUs();
+  sealRecord();
+}
+
+const BootTimeline& getBootTimeline() {
+  return rtcRecord.timeline;
+}
+
+bool getPreviousBootTimeline(BootTimeline& timeline) {
+  if (!previousValid) {
+    return false;
+  }
+  timeline = previous;
+  return true;
+}
+
+const char* getBootMarkName(BootMark mark) {
+  return mark >= 0 && mark < BOOT_MARK_COUNT ? markNames[mark] : "unknown";
+}
+
+const char* getResetReasonName(uint8_t reason) {
+  switch ((esp_reset_reason_t)reason) {
+    case ESP_RST_POWERON:   return "powerOn";
+    case ESP_RST_EXT:       return "external";
+    case ESP_RST_SW:        return "software";
+    case ESP_RST_PANIC:     return "panic";
+    case ESP_RST_INT_WDT:   return "interruptWatchdog";
+    case ESP_RST_TASK_WDT:  return "taskWatchdog";
+    case ESP_RST_WDT:       return "watchdog";
+    case ESP_RST_DEEPSLEEP: return "deepSleep";
+    case ESP_RST_BROWNOUT:  return "brownout";
+    case ESP_RST_SDIO:      return "sdio";
+    default:                return "unknown";
+  }
+}
+
+void printBootTimeline() {
+  const BootTimeline& timeline = rtcRecord.timeline;
+
+  Serial.printf("[BOOT] Boot #%lu, reset reason: %s\n",
+                (unsigned long)timeline.bootCount, getResetReasonName(timeline.resetReason));
+  for (int i = 0; i < timeline.phaseCount; i++) {
+    const BootPhase& phase = timeline.phases[i];
+    Serial.printf("[BOOT]   %-16s start %7lu us  duration %7lu us\n", phase.name,
+                  (unsigned long)phase.startUs, (unsigned long)phase.durationUs);
+  }
+  for (int i = 0; i < BOOT_MARK_COUNT; i++) {
+    if (timeline.marks[i] != 0) {
+      Serial.printf("[BOOT]   %-16s at    %7lu us\n", markNames[i], (unsigned long)timeline.marks[i]);
+    }
+  }
+}
@@ -0,0 +1,65 @@
+/*
+ * Boot Profiler
+ * Microsecond timeline of the setup() phases and of milestones reached
+ * later in the background (sensor armed, WiFi up, printer connected).
+ * Kept in RTC memory so the timeline of the previous boot survives
+ * resets (OTA, watchdog, brownout) and can be inspected afterwards.
+ */
+
+#ifndef BOOT_PROFILER_H
+#define BOOT_PROFILER_H
+
+#include <Arduino.h>
+
+// ========== Boot Profiler Configuration ==========
+#define BOOT_MAX_PHASES 20          // setup() phases recorded per boot
+#define BOOT_PHASE_NAME_LEN 16
+
+// Milestones reached during or after setup()
+enum BootMark {
+  BOOT_MARK_SENSOR_ARMED,       // Runout pin driven from the sensor, ISR attached
+  BOOT_MARK_SETUP_DONE,         // setup() returned
+  BOOT_MARK_WIFI_CONNECTED,     // First WiFi connection
+  BOOT_MARK_PRINTER_CONNECTED,  // First printer WebSocket connection
+  BOOT_MARK_COUNT
+};
+
+struct BootPhase {
+  char name[BOOT_PHASE_NAME_LEN];
+  uint32_t startUs;             // Since the boot timer started
+  uint32_t durationUs;
+};
+
+struct BootTimeline {
+  uint32_t bootCount;           // Boots since power-on
+  uint8_t resetReason;          // esp_reset_reason_t
+  uint8_t phaseCount;
+  uint32_t marks[BOOT_MARK_COUNT];  // Time of each milestone, 0 = not reached
+  BootPhase phases[BOOT_MAX_PHASES];
+};
+
+// Start a new timeline (first call in setup(), right after Serial.begin())
+void bootProfilerBegin();
+
+// End the running phase (if any) and start the next one
+void bootPhase(const char* name);
+
+// End the last phase and record BOOT_MARK_SETUP_DONE (last call in setup())
+void bootProfilerEnd();
+
+// Record a milestone (only the first occurrence per boot counts)
+void bootProfilerMark(BootMark mark);
+
+// Timeline of this boot
+const BootTimeline& getBootTimeline();
+
+// Timeline of the boot before the last reset (false after power-on)
+bool getPreviousBootTimeline(BootTimeline& timeline);
+
+const char* getBootMarkName(BootMark mark);
+const char* getResetReasonName(uint8_t reason);
+
+// Print the timeline of this boot to Serial
+void printBootTimeline();
+
+#endif // BOOT_PROFILER_H
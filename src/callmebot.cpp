@@ -3,30 +3,57 @@
  */
 
 #include "callmebot.h"
+#include "metrics.h"
+#include "heap_monitor.h"
+#include "url_encode.h"
 #include <HTTPClient.h>
-#include <Preferences.h>
-
-// Preferences namespace
-static Preferences preferences;
+#include <WiFiClientSecure.h>
+#include "settings_store.h"
 
 // CallMeBot settings
 static bool callmebotEnabled = false;
 static String callmebotPhone = "";
 static String callmebotApiKey = "";
 
-// Rate limiting
-static unsigned long lastNotificationTime = 0;
-static const unsigned long NOTIFICATION_COOLDOWN = 60000;  // 60 seconds between notifications
+#define CALLMEBOT_URL_PREFIX "https://api.callmebot.com/whatsapp.php"
 
-void setupCallMeBot() {
-  // Load settings from flash
-  preferences.begin("callmebot", false);
+// HTTP timeouts (keep each attempt inside the dispatcher's time budget)
+static const uint32_t HTTP_CONNECT_TIMEOUT = 5000;
+static const uint16_t HTTP_RESPONSE_TIMEOUT = 8000;
+
+// Persistent TLS connection to the API (reused while the server keeps it open)
+static WiFiClientSecure tlsClient;
+static HTTPClient http;
+
+// Delivers dispatcher batches as one WhatsApp message
+class CallMeBotSink : public NotificationSink {
+public:
+  const char* name() const override { return "callmebot"; }
+  bool isEnabled() const override { return callmebotEnabled; }
+
+  NotifyResult send(const char* const* messages, int count, NotificationPriority priority) override {
+    formatNotificationBatch(messages, count, text, sizeof(text));
+    return deliverWhatsAppNotification(text);
+  }
 
-  callmebotEnabled = preferences.getBool("enabled", false);
-  callmebotPhone = preferences.getString("phone", "");
-  callmebotApiKey = preferences.getString("apiKey", "");
+private:
+  char text[NOTIFY_DIGEST_SIZE + 64];
+};
 
-  preferences.end();
+static CallMeBotSink callMeBotSink;
+
+void setupCallMeBot() {
+  // Load settings from the settings store
+  const Settings& settings = getSettings();
+  callmebotEnabled = settings.callmebotEnabled;
+  callmebotPhone = settings.callmebotPhone;
+  callmebotApiKey = settings.callmebotApiKey;
+
+  tlsClient.setInsecure();
+  http.setReuse(true);
+  http.setConnectTimeout(HTTP_CONNECT_TIMEOUT);
+  http.setTimeout(HTTP_RESPONSE_TIMEOUT);
+  registerNotificationSink(&callMeBotSink);
 
   Serial.println("[CALLMEBOT] Module initialized");
   Serial.printf("[CALLMEBOT]   Enabled: %s\n", callmebotEnabled ? "Yes" : "No");
@@ -34,63 +61,75 @@ void setupCallMeBot() {
   Serial.printf("[CALLMEBOT]   API Key: %s\n", callmebotApiKey.length() > 0 ? "***" : "(not set)");
 }
 
-void sendWhatsAppNotification(const char* message) {
+// Append text (optionally percent-encoded) to a fixed URL buffer.
+// Returns the new length; >= size once anything was truncated.
+static size_t appendUrl(char* url, size_t size, size_t length, const char* text, bool encode) {
+  if (length >= size) {
+    return length;
+  }
+  size_t added = encode ? urlEncode(text, url + length, size - length)
+                        : strlcpy(url + length, text, size - length);
+  return length + added;
+}
+
+NotifyResult deliverWhatsAppNotification(const char* message) {
+  HEAP_TAG_SCOPE(HEAP_TAG_NOTIFY);
+
   // Check if enabled and configured
   if (!callmebotEnabled) {
     Serial.println("[CALLMEBOT] Notifications disabled");
-    return;
+    return NOTIFY_SKIPPED;
   }
 
   if (callmebotPhone.length() == 0 || callmebotApiKey.length() == 0) {
     Serial.println("[CALLMEBOT] Phone or API key not configured");
-    return;
+    return NOTIFY_SKIPPED;
   }
 
-  // Rate limiting - avoid spamming
-  unsigned long now = millis();
-  if (now - lastNotificationTime < NOTIFICATION_COOLDOWN) {
-    Serial.printf("[CALLMEBOT] Rate limit: %lu ms remaining\n",
-                  NOTIFICATION_COOLDOWN - (now - lastNotificationTime));
-    return;
-  }
+  // Rate limiting and coalescing are handled by the dispatcher (notifier.cpp)
+
+  // Build API URL (single-pass encoding into a fixed buffer, dispatcher task only)
+  static char url[sizeof(CALLMEBOT_URL_PREFIX) + URL_ENCODED_SIZE(NOTIFY_DIGEST_SIZE + 64) + 96];
+  size_t length = strlcpy(url, CALLMEBOT_URL_PREFIX "?phone=", sizeof(url));
+  length = appendUrl(url, sizeof(url), length, callmebotPhone.c_str(), true);
+  length = appendUrl(url, sizeof(url), length, "&text=", false);
+  length = appendUrl(url, sizeof(url), length, message, true);
+  length = appendUrl(url, sizeof(url), length, "&apikey=", false);
+  length = appendUrl(url, sizeof(url), length, callmebotApiKey.c_str(), true);
 
-  // URL encode the message
-  String encodedMessage = String(message);
-  encodedMessage.replace(" ", "+");
-  encodedMessage.replace("\n", "%0A");
-  encodedMessage.replace("ä", "%C3%A4");
-  encodedMessage.replace("ö", "%C3%B6");
-  encodedMessage.replace("ü", "%C3%BC");
-  encodedMessage.replace("ß", "%C3%9F");
-  encodedMessage.replace("Ä", "%C3%84");
-  encodedMessage.replace("Ö", "%C3%96");
-  encodedMessage.replace("Ü", "%C3%9C");
-
-  // Build API URL
-  String url = "https://api.callmebot.com/whatsapp.php?phone=" + callmebotPhone +
-               "&text=" + encodedMessage +
-               "&apikey=" + callmebotApiKey;
+  if (length >= sizeof(url)) {
+    Serial.println("[CALLMEBOT] ❌ Message too long");
+    return NOTIFY_SKIPPED;
+  }
 
   Serial.printf("[CALLMEBOT] Sending notification: %s\n", message);
 
-  HTTPClient http;
-  http.begin(url);
+  if (!http.begin(tlsClient, url)) {
+    metricsIncrement(METRIC_CALLMEBOT_FAILED);
+    Serial.println("[CALLMEBOT] ❌ Invalid request URL");
+    return NOTIFY_FAILED;
+  }
 
   int httpCode = http.GET();
+  NotifyResult result = NOTIFY_FAILED;
 
   if (httpCode > 0) {
     Serial.printf("[CALLMEBOT] Response: %d\n", httpCode);
     if (httpCode == HTTP_CODE_OK) {
       Serial.println("[CALLMEBOT] ✅ Notification sent successfully");
-      lastNotificationTime = now;
+      metricsIncrement(METRIC_CALLMEBOT_SENT);
+      result = NOTIFY_SENT;
     } else {
+      metricsIncrement(METRIC_CALLMEBOT_FAILED);
       Serial.printf("[CALLMEBOT] ❌ Error: %s\n", http.getString().c_str());
     }
   } else {
+    metricsIncrement(METRIC_CALLMEBOT_FAILED);
     Serial.printf("[CALLMEBOT] ❌ Request failed: %s\n", http.errorToString(httpCode).c_str());
   }
 
   http.end();
+  return result;
 }
 
 bool getCallMeBotEnabled() {
@@ -100,9 +139,9 @@ bool getCallMeBotEnabled() {
 void setCallMeBotEnabled(bool enabled) {
   callmebotEnabled = enabled;
 
-  preferences.begin("callmebot", false);
-  preferences.putBool("enabled", enabled);
-  preferences.end();
+  Settings& settings = beginSettingsUpdate();
+  settings.callmebotEnabled = enabled;
+  endSettingsUpdate(SETTINGS_CALLMEBOT);
 
   Serial.printf("[CALLMEBOT] Enabled: %s\n", enabled ? "Yes" : "No");
 }
@@ -114,9 +153,9 @@ String getCallMeBotPhone() {
 void setCallMeBotPhone(const String& phone) {
   callmebotPhone = phone;
 
-  preferences.begin("callmebot", false);
-  preferences.putString("phone", phone);
-  preferences.end();
+  Settings& settings = beginSettingsUpdate();
+  strlcpy(settings.callmebotPhone, phone.c_str(), sizeof(settings.callmebotPhone));
+  endSettingsUpdate(SETTINGS_CALLMEBOT);
 
   Serial.printf("[CALLMEBOT] Phone number set: %s\n", phone.c_str());
 }
@@ -128,36 +167,9 @@ String getCallMeBotApiKey() {
 void setCallMeBotApiKey(const String& apiKey) {
   callmebotApiKey = apiKey;
 
-  preferences.begin("callmebot", false);
-  preferences.putString("apiKey", apiKey);
-  preferences.end();
+  Settings& settings = beginSettingsUpdate();
+  strlcpy(settings.callmebotApiKey, apiKey.c_str(), sizeof(settings.callmebotApiKey));
+  endSettingsUpdate(SETTINGS_CALLMEBOT);
 
   Serial.println("[CALLMEBOT] API key updated");
 }
-
-void notifyFilamentError(const char* errorType) {
-  char message[200];
-  snprintf(message, sizeof(message),
-           "🚨 Centauri Carbon Alarm!\n\n%s erkannt!\n\nDruck wurde pausiert.",
-           errorType);
-  sendWhatsAppNotification(message);
-}
-
-void notifyPrintComplete(const char* filename, unsigned long duration) {
-  char message[200];
-  unsigned long hours = duration / 3600000;
-  unsigned long minutes = (duration % 3600000) / 60000;
-
-  snprintf(message, sizeof(message),
-           "✅ Druck abgeschlossen!\n\nDatei: %s\nDauer: %luh %lumin",
-           filename, hours, minutes);
-  sendWhatsAppNotification(message);
-}
-
-void notifyPrintStarted(const char* filename) {
-  char message[200];
-  snprintf(message, sizeof(message),
-           "🖨️ Druck gestartet\n\nDatei: %s",
-           filename);
-  sendWhatsAppNotification(message);
-}
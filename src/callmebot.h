@@ -7,12 +7,13 @@
 #define CALLMEBOT_H
 
 #include <Arduino.h>
+#include "notifier.h"
 
-// Initialize CallMeBot module
+// Initialize CallMeBot module and register it as notification sink
 void setupCallMeBot();
 
-// Send WhatsApp notification
-void sendWhatsAppNotification(const char* message);
+// Deliver WhatsApp notification now (blocking HTTPS request, notifier task only)
+NotifyResult deliverWhatsAppNotification(const char* message);
 
 // Get/Set CallMeBot settings
 bool getCallMeBotEnabled();
@@ -24,9 +25,4 @@ void setCallMeBotPhone(const String& phone);
 String getCallMeBotApiKey();
 void setCallMeBotApiKey(const String& apiKey);
 
-// Notification types
-void notifyFilamentError(const char* errorType);
-void notifyPrintComplete(const char* filename, unsigned long duration);
-void notifyPrintStarted(const char* filename);
-
 #endif // CALLMEBOT_H
@@ -6,6 +6,9 @@
 #ifndef CONFIG_H
 #define CONFIG_H
 
+// ========== Firmware Version ==========
+#define FIRMWARE_VERSION "1.0.0"    // Keep in sync with firmware/VERSION.txt
+
 // ========== WiFi Configuration ==========
 extern const char* WIFI_SSID;
 extern const char* WIFI_PASSWORD;
@@ -29,4 +32,7 @@ extern const char* PRINTER_WS_PATH;
 extern const unsigned long STATUS_INTERVAL;  // Request status every 3 seconds
 extern const unsigned long PING_INTERVAL;   // Send ping every 50 seconds
 
+// ========== Boot Configuration ==========
+#define BOOT_SERIAL_WAIT_MS 0       // Wait for the USB serial monitor before logging (0 = don't delay the sensor)
+
 #endif // CONFIG_H
@@ -4,11 +4,10 @@
 
 #include "config_manager.h"
 #include "config.h"
-#include <Preferences.h>
+#include "settings_store.h"
 #include <WiFi.h>
 #include <esp_wifi.h>
 
-static Preferences configPrefs;
 static SystemConfig currentConfig;
 
 void initConfigManager() {
@@ -28,38 +27,28 @@ void initConfigManager() {
 }
 
 bool loadConfig() {
-  configPrefs.begin("system", true);  // true = read-only
-
-  bool configured = configPrefs.getBool("configured", false);
+  const SystemConfig& stored = getSettings().system;
+  bool configured = stored.configured;
 
   if (configured) {
-    configPrefs.getString("wifiSSID", currentConfig.wifiSSID, sizeof(currentConfig.wifiSSID));
-    configPrefs.getString("wifiPass", currentConfig.wifiPassword, sizeof(currentConfig.wifiPassword));
-    configPrefs.getString("printerIP", currentConfig.printerIP, sizeof(currentConfig.printerIP));
-    currentConfig.printerPort = configPrefs.getInt("printerPort", 80);
-    currentConfig.configured = true;
+    currentConfig = stored;
 
     Serial.println("[CONFIG] Loaded settings:");
     Serial.printf("[CONFIG]   WiFi SSID: %s\n", currentConfig.wifiSSID);
     Serial.printf("[CONFIG]   Printer IP: %s:%d\n", currentConfig.printerIP, currentConfig.printerPort);
   }
 
-  configPrefs.end();
   return configured;
 }
 
 void saveConfig() {
-  configPrefs.begin("system", false);  // false = read-write
-
-  configPrefs.putBool("configured", true);
-  configPrefs.putString("wifiSSID", currentConfig.wifiSSID);
-  configPrefs.putString("wifiPass", currentConfig.wifiPassword);
-  configPrefs.putString("printerIP", currentConfig.printerIP);
-  configPrefs.putInt("printerPort", currentConfig.printerPort);
+  currentConfig.configured = true;
 
-  configPrefs.end();
+  // System settings are committed immediately by the settings store
+  Settings& settings = beginSettingsUpdate();
+  settings.system = currentConfig;
+  endSettingsUpdate(SETTINGS_SYSTEM);
 
-  currentConfig.configured = true;
   Serial.println("[CONFIG] Configuration saved to flash");
 }
 
@@ -191,3 +180,13 @@ void updatePrinterConfig(const char* ip, int port) {
   Serial.printf("[CONFIG] Printer updated: %s:%d\n", ip, port);
   saveConfig();
 }
+
+const char* getDeviceId() {
+  static char deviceId[24] = "";
+  if (deviceId[0] == '\0') {
+    uint8_t mac[6];
+    WiFi.macAddress(mac);
+    snprintf(deviceId, sizeof(deviceId), "centauri-%02x%02x%02x", mac[3], mac[4], mac[5]);
+  }
+  return deviceId;
+}
@@ -44,4 +44,7 @@ void updateWiFiConfig(const char* ssid, const char* password);
 // Update printer configuration
 void updatePrinterConfig(const char* ip, int port);
 
+// Stable device name derived from the MAC address ("centauri-a1b2c3")
+const char* getDeviceId();
+
 #endif // CONFIG_MANAGER_H
@@ -7,11 +7,14 @@
 #include "printer_status.h"
 #include "printer_status_codes.h"
 #include "printer_control.h"
-#include "callmebot.h"
-#include <Preferences.h>
-
-// Preferences namespace
-static Preferences preferences;
+#include "notifier.h"
+#include "metrics.h"
+#include "heap_monitor.h"
+#include "settings_store.h"
+#include "warm_restart.h"
+#include "power_manager.h"
+#include "logger.h"
+#include "trace.h"
 
 // Filament Sensor Variables
 static volatile unsigned long lastMotionPulse = 0;
@@ -24,39 +27,28 @@ static bool autoPauseEnabled = true;
 static bool switchDirectMode = true;  // true = direct to RUNOUT_PIN, false = send pause command
 static unsigned long motionTimeout = MOTION_TIMEOUT;  // Default from config.h, but changeable
 static bool motionDetectedThisPrint = false;  // Track if we've seen motion during current print
+static bool interruptsAttached = false;
+static bool sensorEvaluated = false;
+static bool warmupLogged = false;
 
-// Load settings from persistent storage
+// Load settings from the settings store
 void loadSensorSettings() {
-  preferences.begin("filament", false);  // false = read-write mode
-
-  // Load motion timeout (default: MOTION_TIMEOUT from config.h)
-  motionTimeout = preferences.getULong("motionTimeout", MOTION_TIMEOUT);
-
-  // Load auto-pause enabled (default: true)
-  autoPauseEnabled = preferences.getBool("autoPause", true);
-
-  // Load switch mode (default: true = direct mode)
-  switchDirectMode = preferences.getBool("switchDirect", true);
+  const Settings& settings = getSettings();
+  motionTimeout = settings.motionTimeout;
+  autoPauseEnabled = settings.autoPause;
+  switchDirectMode = settings.switchDirect;
 
-  preferences.end();
-
-  Serial.println("[SENSOR] Settings loaded from flash:");
-  Serial.printf("[SENSOR]   Motion Timeout: %lu ms\n", motionTimeout);
-  Serial.printf("[SENSOR]   Auto-Pause: %s\n", autoPauseEnabled ? "enabled" : "disabled");
-  Serial.printf("[SENSOR]   Switch Mode: %s\n", switchDirectMode ? "Direct" : "Pause Command");
+  LOGI("SENSOR", "Settings loaded: motion timeout %lu ms, auto-pause %s, switch mode %s", motionTimeout,
+       autoPauseEnabled ? "enabled" : "disabled", switchDirectMode ? "Direct" : "Pause Command");
 }
 
-// Save settings to persistent storage
+// Save settings (committed to flash in a debounced batch)
 void saveSensorSettings() {
-  preferences.begin("filament", false);  // false = read-write mode
-
-  preferences.putULong("motionTimeout", motionTimeout);
-  preferences.putBool("autoPause", autoPauseEnabled);
-  preferences.putBool("switchDirect", switchDirectMode);
-
-  preferences.end();
-
-  Serial.println("[SENSOR] Settings saved to flash");
+  Settings& settings = beginSettingsUpdate();
+  settings.motionTimeout = motionTimeout;
+  settings.autoPause = autoPauseEnabled;
+  settings.switchDirect = switchDirectMode;
+  endSettingsUpdate(SETTINGS_FILAMENT);
 }
 
 void setupFilamentSensor() {
@@ -66,6 +58,13 @@ void setupFilamentSensor() {
   // Initialize motion timer to current time (prevent false jam on first print)
   lastMotionPulse = millis();
 
+  // After a warm restart continue the running print instead of re-arming from scratch
+  const WarmRestartState* restored = getRestoredState();
+  if (restored) {
+    motionDetectedThisPrint = restored->motionDetectedThisPrint;
+    filamentErrorDetected = restored->filamentErrorDetected;
+  }
+
   pinMode(SENSOR_SWITCH, INPUT_PULLDOWN);
   pinMode(SENSOR_MOTION, INPUT_PULLUP);
 
@@ -75,17 +74,28 @@ void setupFilamentSensor() {
   // Attach interrupt for motion detection
   attachInterrupt(digitalPinToInterrupt(SENSOR_MOTION), filamentMotionISR, FALLING);
 
-  Serial.println("[SENSOR] Filament sensor initialized");
-  Serial.printf("[SENSOR] Switch Pin: %d, Motion Pin: %d, Runout Output: %d\n",
-                SENSOR_SWITCH, SENSOR_MOTION, RUNOUT_PIN);
+  // Switch changes only wake the loop in idle mode (the state is polled)
+  attachInterrupt(digitalPinToInterrupt(SENSOR_SWITCH), filamentSwitchISR, CHANGE);
+  interruptsAttached = true;
+
+  LOGI("SENSOR", "Filament sensor initialized (switch pin %d, motion pin %d, runout output %d)",
+       SENSOR_SWITCH, SENSOR_MOTION, RUNOUT_PIN);
 }
 
 void IRAM_ATTR filamentMotionISR() {
   lastMotionPulse = millis();
   motionPulseCount++;
+  metricsIncrement(METRIC_MOTION_PULSES);
+  TRACE_INSTANT("isr", "motionPulse");
+  powerWakeFromISR();
 }
 
-void checkFilamentSensor() {
+void IRAM_ATTR filamentSwitchISR() {
+  TRACE_INSTANT("isr", "switchEdge");
+  powerWakeFromISR();
+}
+
+static void evaluateFilamentSensor() {
   unsigned long now = millis();
 
   // Read filament switch state
@@ -110,6 +120,7 @@ void checkFilamentSensor() {
     filamentErrorDetected = false;
     lastFilamentCheck = 0;  // Reset check timer
     motionDetectedThisPrint = false;  // Reset motion tracking for next print
+    warmupLogged = false;
     return;
   }
 
@@ -118,28 +129,33 @@ void checkFilamentSensor() {
   // CRITICAL: Do not check for filament errors until Layer 1 is reached
   // This prevents false errors during warmup/homing/priming
   if (printerStatus.currentLayer < 1) {
-    Serial.println("[SENSOR] Warmup/Layer 0 - filament check disabled");
+    if (!warmupLogged) {
+      LOGI("SENSOR", "Warmup/Layer 0 - filament check disabled");
+      warmupLogged = true;
+    }
     filamentErrorDetected = false;
     return;
   }
 
   // PRIORITY 1: Check if filament switch detects no filament (IMMEDIATE)
   if (!filamentPresent && !filamentErrorDetected) {
-    Serial.println("\n[SENSOR] ⚠️  FILAMENT RUNOUT DETECTED!");
+    LOGW("SENSOR", "⚠️  FILAMENT RUNOUT DETECTED!");
     filamentErrorDetected = true;
+    metricsIncrement(METRIC_RUNOUT_EVENTS);
 
-    // Send WhatsApp notification
-    notifyFilamentError("Filament-Runout");
-
-    // In Pause Mode: send pause command (Direct Mode handles via pin)
+    // Safety first: In Pause Mode send pause command (Direct Mode handles via pin)
     if (!switchDirectMode && autoPauseEnabled) {
       pausePrint();
-      Serial.println("[SENSOR] Print paused automatically (Pause Mode - RUNOUT)");
+      metricsIncrement(METRIC_AUTO_PAUSES);
+      LOGI("SENSOR", "Print paused automatically (Pause Mode - RUNOUT)");
     }
+
+    // Queue WhatsApp notification (delivered in background)
+    notifyFilamentError("Filament-Runout");
     return;
   } else if (filamentPresent && filamentErrorDetected) {
     // Filament restored
-    Serial.println("[SENSOR] ✓ Filament restored");
+    LOGI("SENSOR", "✓ Filament restored");
     filamentErrorDetected = false;
   }
 
@@ -159,7 +175,7 @@ void checkFilamentSensor() {
     motionDetectedThisPrint = true;  // Mark that we've seen motion during this print
 
     if (filamentErrorDetected) {
-      Serial.println("[SENSOR] ✓ Filament motion resumed");
+      LOGI("SENSOR", "✓ Filament motion resumed");
       filamentErrorDetected = false;
     }
   }
@@ -174,29 +190,58 @@ void checkFilamentSensor() {
     // Printhead is moving and not on last layer, filament should be moving too
     // Only check for jam if we've already seen motion during this print (prevents false positives at start)
     if (motionDetectedThisPrint && timeSinceLastPulse > motionTimeout && !filamentErrorDetected) {
-      Serial.println("\n[SENSOR] ⚠️  FILAMENT JAM DETECTED!");
-      Serial.printf("[SENSOR] No motion for %lu ms while printing\n", timeSinceLastPulse);
-      Serial.printf("[SENSOR] Position: %s\n", printerStatus.currentCoord.c_str());
-      Serial.printf("[SENSOR] Layer: %d/%d\n", printerStatus.currentLayer, printerStatus.totalLayers);
-      Serial.printf("[SENSOR] Motion pulses: %u\n", motionPulseCount.load());
+      LOGW("SENSOR", "⚠️  FILAMENT JAM DETECTED! No motion for %lu ms, layer %d/%d, %u pulses, position %s",
+           timeSinceLastPulse, printerStatus.currentLayer, printerStatus.totalLayers,
+           motionPulseCount.load(), printerStatus.currentCoord.c_str());
 
       filamentErrorDetected = true;
+      metricsIncrement(METRIC_JAM_EVENTS);
 
-      // Send WhatsApp notification
-      notifyFilamentError("Filament-Stau");
-
+      // Safety first: pause before anything else
       if (autoPauseEnabled) {
         pausePrint();
-        Serial.println("[SENSOR] Print paused automatically (JAM)");
+        metricsIncrement(METRIC_AUTO_PAUSES);
+        LOGI("SENSOR", "Print paused automatically (JAM)");
       }
+
+      // Queue WhatsApp notification (delivered in background)
+      notifyFilamentError("Filament-Stau");
     }
   } else if (onLastLayer && filamentErrorDetected) {
     // On last layer, clear any previous errors
-    Serial.println("[SENSOR] Last layer - clearing filament errors");
+    LOGI("SENSOR", "Last layer - clearing filament errors");
     filamentErrorDetected = false;
   }
 }
 
+void checkFilamentSensor() {
+  HEAP_TAG_SCOPE(HEAP_TAG_SENSOR);
+  TRACE_SCOPE("sensor", "checkFilamentSensor");
+  evaluateFilamentSensor();
+  sensorEvaluated = true;
+
+  // Keep the warm restart snapshot in sync (only written on changes)
+  const WarmRestartState& snapshot = getWarmRestartState();
+  if (snapshot.motionDetectedThisPrint != motionDetectedThisPrint ||
+      snapshot.filamentErrorDetected != filamentErrorDetected) {
+    WarmRestartState& state = beginWarmRestartUpdate();
+    state.motionDetectedThisPrint = motionDetectedThisPrint;
+    state.filamentErrorDetected = filamentErrorDetected;
+    endWarmRestartUpdate();
+  }
+}
+
+bool isFilamentSensorArmed() {
+  if (!interruptsAttached || !sensorEvaluated) {
+    return false;
+  }
+  // While printing the motion ISR must have delivered pulses
+  int status = printerStatus.printStatus;
+  bool printing = status == SDCP_PRINT_STATUS_PRINTING || status == SDCP_PRINT_STATUS_PRINTING_ALT ||
+                  status == SDCP_PRINT_STATUS_PRINTING_RESUME;
+  return !printing || motionPulseCount > 0;
+}
+
 bool isPrintHeadMoving() {
   unsigned long now = millis();
 
@@ -217,8 +262,7 @@ bool isPrintHeadMoving() {
   bool moving = (currentPos != lastPosition);
 
   if (moving) {
-    Serial.printf("[SENSOR] Movement detected: %s -> %s\n",
-                  lastPosition.c_str(), currentPos.c_str());
+    LOGV("SENSOR", "Movement detected: %s -> %s", lastPosition.c_str(), currentPos.c_str());
   }
 
   lastPosition = currentPos;
@@ -228,13 +272,13 @@ bool isPrintHeadMoving() {
 void setAutoPauseEnabled(bool enabled) {
   autoPauseEnabled = enabled;
   saveSensorSettings();  // Save to flash
-  Serial.printf("[SENSOR] Auto-pause %s\n", enabled ? "enabled" : "disabled");
+  LOGI("SENSOR", "Auto-pause %s", enabled ? "enabled" : "disabled");
 }
 
 void toggleAutoPause() {
   autoPauseEnabled = !autoPauseEnabled;
   saveSensorSettings();  // Save to flash
-  Serial.printf("[SENSOR] Auto-pause toggled: %s\n", autoPauseEnabled ? "enabled" : "disabled");
+  LOGI("SENSOR", "Auto-pause toggled: %s", autoPauseEnabled ? "enabled" : "disabled");
 }
 
 bool isFilamentErrorDetected() {
@@ -257,7 +301,7 @@ void resetFilamentSensor() {
   lastMotionPulse = millis();  // Reset motion timer to current time
   lastPosition = "";
   motionDetectedThisPrint = false;  // Reset motion tracking
-  Serial.println("[SENSOR] Sensor state reset (motion timer reset)");
+  LOGD("SENSOR", "Sensor state reset (motion timer reset)");
 }
 
 unsigned long getLastMotionPulse() {
@@ -275,7 +319,7 @@ bool getAutoPauseEnabled() {
 void setMotionTimeout(unsigned long timeout) {
   motionTimeout = timeout;
   saveSensorSettings();  // Save to flash
-  Serial.printf("[SENSOR] Motion timeout set to %lu ms\n", timeout);
+  LOGI("SENSOR", "Motion timeout set to %lu ms", timeout);
 }
 
 unsigned long getMotionTimeout() {
@@ -289,12 +333,12 @@ void setRunoutPinOutput(bool state) {
     if (state) {
       // HIGH = Release pin (floating/high-impedance, pull-up on printer pulls to HIGH)
       pinMode(RUNOUT_PIN, INPUT);
-      Serial.println("[RUNOUT OUTPUT] Pin IO2 released (floating -> HIGH via pull-up)");
+      LOGI("RUNOUT OUTPUT", "Pin IO2 released (floating -> HIGH via pull-up)");
     } else {
       // LOW = Pull to ground (open-drain style)
       pinMode(RUNOUT_PIN, OUTPUT);
       digitalWrite(RUNOUT_PIN, LOW);
-      Serial.println("[RUNOUT OUTPUT] Pin IO2 pulled to GND (LOW)");
+      LOGI("RUNOUT OUTPUT", "Pin IO2 pulled to GND (LOW)");
     }
     lastState = state;
   }
@@ -307,7 +351,7 @@ String getRunoutPinState() {
   String result = "Pin IO2: ";
   result += (currentState == HIGH) ? "HIGH (1)" : "LOW (0)";
 
-  Serial.printf("[RUNOUT STATE] %s\n", result.c_str());
+  LOGD("RUNOUT STATE", "%s", result.c_str());
 
   return result;
 }
@@ -319,10 +363,10 @@ bool getSwitchDirectMode() {
 void setSwitchDirectMode(bool directMode) {
   switchDirectMode = directMode;
   saveSensorSettings();  // Save to flash
-  Serial.printf("[SENSOR] Switch mode set to: %s\n", directMode ? "Direct" : "Pause Command");
+  LOGI("SENSOR", "Switch mode set to: %s", directMode ? "Direct" : "Pause Command");
 }
 
 void toggleSwitchMode() {
   setSwitchDirectMode(!switchDirectMode);
-  Serial.printf("[SENSOR] Switch mode toggled to: %s\n", switchDirectMode ? "Direct" : "Pause Command");
+  LOGI("SENSOR", "Switch mode toggled to: %s", switchDirectMode ? "Direct" : "Pause Command");
 }
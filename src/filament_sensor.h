@@ -18,6 +18,13 @@ void checkFilamentSensor();
 // Interrupt service routine for filament motion
 void filamentMotionISR();
 
+// Interrupt service routine for filament switch changes
+void filamentSwitchISR();
+
+// Interrupts attached and the sensor evaluated by the loop (while printing
+// also motion pulses received)
+bool isFilamentSensorArmed();
+
 // Check if print head is moving
 bool isPrintHeadMoving();
 
@@ -0,0 +1,236 @@
+/*
+ * Heap Monitor Implementation
+ */
+
+#include "heap_monitor.h"
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+static const char* const tagNames[HEAP_TAG_COUNT] = {
+  "other", "websocket", "http", "notify", "sensor", "status"
+};
+
+// Sample rings (written by the esp_timer task only)
+static HeapSample shortRing[HEAP_SHORT_SAMPLES];
+static HeapSample longRing[HEAP_LONG_SAMPLES];
+static volatile int shortCount = 0;
+static volatile int shortHead = 0;  // Next write position
+static volatile int longCount = 0;
+static volatile int longHead = 0;
+
+// Running minimum for the current long-term interval
+static uint32_t windowMinFree = UINT32_MAX;
+static uint32_t windowMinLargest = UINT32_MAX;
+static int windowSamples = 0;
+
+static esp_timer_handle_t sampleTimer = nullptr;
+
+static void pushSample(HeapSample* ring, int size, volatile int& head, volatile int& count,
+                       const HeapSample& sample) {
+  ring[head] = sample;
+  head = (head + 1) % size;
+  if (count < size) {
+    count = count + 1;
+  }
+}
+
+static void sampleHeap(void* arg) {
+  HeapSample sample;
+  sample.uptimeS = millis() / 1000;
+  sample.freeHeap = ESP.getFreeHeap();
+  sample.largestBlock = ESP.getMaxAllocHeap();
+  sample.minFreeHeap = ESP.getMinFreeHeap();
+  pushSample(shortRing, HEAP_SHORT_SAMPLES, shortHead, shortCount, sample);
+
+  // Long-term ring keeps the worst values of each interval
+  if (sample.freeHeap < windowMinFree) windowMinFree = sample.freeHeap;
+  if (sample.largestBlock < windowMinLargest) windowMinLargest = sample.largestBlock;
+
+  if (++windowSamples >= HEAP_LONG_DECIMATION) {
+    HeapSample aggregated = sample;
+    aggregated.freeHeap = windowMinFree;
+    aggregated.largestBlock = windowMinLargest;
+    pushSample(longRing, HEAP_LONG_SAMPLES, longHead, longCount, aggregated);
+
+    windowMinFree = UINT32_MAX;
+    windowMinLargest = UINT32_MAX;
+    windowSamples = 0;
+  }
+}
+
+void setupHeapMonitor() {
+  // First sample right away so the rings are never empty
+  sampleHeap(nullptr);
+
+  esp_timer_create_args_t args = {};
+  args.callback = sampleHeap;
+  args.name = "heapmon";
+  if (esp_timer_create(&args, &sampleTimer) == ESP_OK) {
+    esp_timer_start_periodic(sampleTimer, (uint64_t)HEAP_SAMPLE_INTERVAL_S * 1000000ULL);
+  }
+
+  Serial.printf("[HEAP] Heap monitor initialized (every %d s, allocation hooks %s)\n",
+                HEAP_SAMPLE_INTERVAL_S, heapAllocHooksEnabled() ? "enabled" : "disabled");
+  Serial.printf("[HEAP]   Free: %lu bytes, largest block: %lu bytes\n",
+                (unsigned long)ESP.getFreeHeap(), (unsigned long)ESP.getMaxAllocHeap());
+}
+
+int getHeapSampleCount(bool longTerm) {
+  return longTerm ? longCount : shortCount;
+}
+
+HeapSample getHeapSample(bool longTerm, int index) {
+  const HeapSample* ring = longTerm ? longRing : shortRing;
+  int size = longTerm ? HEAP_LONG_SAMPLES : HEAP_SHORT_SAMPLES;
+  int count = longTerm ? longCount : shortCount;
+  int head = longTerm ? longHead : shortHead;
+
+  if (index < 0 || index >= count) {
+    return HeapSample{};
+  }
+  return ring[(head - count + index + size) % size];
+}
+
+// ========== Allocation Hooks ==========
+
+#ifdef HEAP_ALLOC_HOOKS
+
+#define HEAP_TASK_SLOTS 8
+
+// Current tag per task (small fixed table, scanned on every allocation)
+static TaskHandle_t taskSlots[HEAP_TASK_SLOTS];
+static volatile uint8_t taskTags[HEAP_TASK_SLOTS];
+
+static uint32_t allocCounts[HEAP_TAG_COUNT];
+static uint32_t allocBytes[HEAP_TAG_COUNT];
+static uint32_t freeCounts[HEAP_TAG_COUNT];
+static portMUX_TYPE hookMux = portMUX_INITIALIZER_UNLOCKED;
+
+static IRAM_ATTR HeapTag currentTag() {
+  TaskHandle_t task = xTaskGetCurrentTaskHandle();
+  for (int i = 0; i < HEAP_TASK_SLOTS; i++) {
+    if (taskSlots[i] == task) {
+      return (HeapTag)taskTags[i];
+    }
+  }
+  return HEAP_TAG_OTHER;
+}
+
+static IRAM_ATTR void countAlloc(size_t size) {
+  HeapTag tag = currentTag();
+  portENTER_CRITICAL_SAFE(&hookMux);
+  allocCounts[tag]++;
+  allocBytes[tag] += size;
+  portEXIT_CRITICAL_SAFE(&hookMux);
+}
+
+static IRAM_ATTR void countFree() {
+  HeapTag tag = currentTag();
+  portENTER_CRITICAL_SAFE(&hookMux);
+  freeCounts[tag]++;
+  portEXIT_CRITICAL_SAFE(&hookMux);
+}
+
+extern "C" {
+void* __real_malloc(size_t size);
+void* __real_calloc(size_t count, size_t size);
+void* __real_realloc(void* ptr, size_t size);
+void __real_free(void* ptr);
+
+IRAM_ATTR void* __wrap_malloc(size_t size) {
+  void* ptr = __real_malloc(size);
+  if (ptr) countAlloc(size);
+  return ptr;
+}
+
+IRAM_ATTR void* __wrap_calloc(size_t count, size_t size) {
+  void* ptr = __real_calloc(count, size);
+  if (ptr) countAlloc(count * size);
+  return ptr;
+}
+
+IRAM_ATTR void* __wrap_realloc(void* ptr, size_t size) {
+  void* result = __real_realloc(ptr, size);
+  if (ptr && (result || size == 0)) countFree();
+  if (result && size > 0) countAlloc(size);
+  return result;
+}
+
+IRAM_ATTR void __wrap_free(void* ptr) {
+  if (ptr) countFree();
+  __real_free(ptr);
+}
+}
+
+HeapTagScope::HeapTagScope(HeapTag tag) {
+  TaskHandle_t task = xTaskGetCurrentTaskHandle();
+  previous = HEAP_TAG_OTHER;
+
+  portENTER_CRITICAL(&hookMux);
+  int freeSlot = -1;
+  int slot = -1;
+  for (int i = 0; i < HEAP_TASK_SLOTS; i++) {
+    if (taskSlots[i] == task) {
+      slot = i;
+      break;
+    }
+    if (taskSlots[i] == nullptr && freeSlot < 0) {
+      freeSlot = i;
+    }
+  }
+  if (slot < 0 && freeSlot >= 0) {
+    slot = freeSlot;
+    taskSlots[slot] = task;
+    taskTags[slot] = HEAP_TAG_OTHER;
+  }
+  if (slot >= 0) {
+    previous = (HeapTag)taskTags[slot];
+    taskTags[slot] = tag;
+  }
+  portEXIT_CRITICAL(&hookMux);
+}
+
+HeapTagScope::~HeapTagScope() {
+  TaskHandle_t task = xTaskGetCurrentTaskHandle();
+  for (int i = 0; i < HEAP_TASK_SLOTS; i++) {
+    if (taskSlots[i] == task) {
+      taskTags[i] = previous;
+      break;
+    }
+  }
+}
+
+bool heapAllocHooksEnabled() {
+  return true;
+}
+
+HeapTagStats getHeapTagStats(HeapTag tag) {
+  HeapTagStats stats = {};
+  if (tag < 0 || tag >= HEAP_TAG_COUNT) {
+    return stats;
+  }
+  portENTER_CRITICAL(&hookMux);
+  stats.name = tagNames[tag];
+  stats.allocs = allocCounts[tag];
+  stats.bytes = allocBytes[tag];
+  stats.frees = freeCounts[tag];
+  portEXIT_CRITICAL(&hookMux);
+  return stats;
+}
+
+#else
+
+bool heapAllocHooksEnabled() {
+  return false;
+}
+
+HeapTagStats getHeapTagStats(HeapTag tag) {
+  HeapTagStats stats = {};
+  if (tag >= 0 && tag < HEAP_TAG_COUNT) {
+    stats.name = tagNames[tag];
+  }
+  return stats;
+}
+
+#endif // HEAP_ALLOC_HOOKS
@@ -0,0 +1,75 @@
+/*
+ * Heap Monitor
+ * Background sampling of free heap, largest free block and minimum
+ * free heap into ring buffers, plus optional per-subsystem allocation
+ * counting (build with the *_heaphooks environment)
+ */
+
+#ifndef HEAP_MONITOR_H
+#define HEAP_MONITOR_H
+
+#include <Arduino.h>
+
+// Subsystems allocations are attributed to
+enum HeapTag {
+  HEAP_TAG_OTHER,
+  HEAP_TAG_WEBSOCKET,
+  HEAP_TAG_HTTP,
+  HEAP_TAG_NOTIFY,
+  HEAP_TAG_SENSOR,
+  HEAP_TAG_STATUS,
+  HEAP_TAG_COUNT
+};
+
+// Sampling configuration
+#define HEAP_SAMPLE_INTERVAL_S 10       // Short-term ring resolution
+#define HEAP_SHORT_SAMPLES 90           // 15 minutes
+#define HEAP_LONG_DECIMATION 60         // Short samples per long-term sample (10 minutes)
+#define HEAP_LONG_SAMPLES 144           // 24 hours
+
+// One heap sample
+struct HeapSample {
+  uint32_t uptimeS;       // Seconds since boot
+  uint32_t freeHeap;      // Free heap (minimum over the interval for long-term samples)
+  uint32_t largestBlock;  // Largest free block (minimum over the interval for long-term samples)
+  uint32_t minFreeHeap;   // Minimum free heap since boot
+};
+
+// Allocation counters for one subsystem
+struct HeapTagStats {
+  const char* name;
+  uint32_t allocs;
+  uint32_t bytes;
+  uint32_t frees;
+};
+
+// Initialize heap monitor and start background sampler
+void setupHeapMonitor();
+
+// Number of samples stored in the short-term or long-term ring
+int getHeapSampleCount(bool longTerm);
+
+// Get a sample (index 0 = oldest)
+HeapSample getHeapSample(bool longTerm, int index);
+
+// Whether allocation hooks are compiled in
+bool heapAllocHooksEnabled();
+
+// Get allocation counters for a subsystem
+HeapTagStats getHeapTagStats(HeapTag tag);
+
+// Attribute allocations of the current task to a subsystem while in scope
+#ifdef HEAP_ALLOC_HOOKS
+class HeapTagScope {
+public:
+  explicit HeapTagScope(HeapTag tag);
+  ~HeapTagScope();
+private:
+  HeapTag previous;
+};
+#define HEAP_TAG_SCOPE(tag) HeapTagScope heapTagScope_(tag)
+#else
+#define HEAP_TAG_SCOPE(tag) do {} while (0)
+#endif
+
+#endif // HEAP_MONITOR_H
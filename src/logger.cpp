@@ -0,0 +1,181 @@
+/*
+ * Logger Implementation
+ *
+ * Writers reserve a slot with one atomic increment and publish it by
+ * storing seq + 1 into the slot state; readers copy a slot and check the
+ * state again afterwards (seqlock), so neither side takes a lock. When
+ * writers lap the drain task the oldest messages are counted as dropped.
+ */
+
+#include "logger.h"
+#include <atomic>
+#include <stdarg.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+#define LOG_RING_MASK (LOG_RING_SLOTS - 1)
+#define LOG_STUCK_WAKES 10   // Skip a reserved slot that stays unpublished this many wakes
+
+struct LogSlot {
+  std::atomic<uint32_t> state;   // seq + 1 once published, 0 while being written
+  LogEntry entry;
+};
+
+static LogSlot ring[LOG_RING_SLOTS];
+static std::atomic<uint32_t> nextSeq(0);
+static std::atomic<uint32_t> droppedCount(0);
+static TaskHandle_t drainTask = nullptr;
+
+// Copy a published slot; false if it holds another sequence number or was
+// overwritten during the copy
+static bool readSlot(uint32_t seq, LogEntry& entry) {
+  LogSlot& slot = ring[seq & LOG_RING_MASK];
+  if (slot.state.load(std::memory_order_acquire) != seq + 1) {
+    return false;
+  }
+  entry = slot.entry;
+  std::atomic_thread_fence(std::memory_order_acquire);
+  return slot.state.load(std::memory_order_relaxed) == seq + 1;
+}
+
+void logWrite(uint8_t level, const char* tag, const char* format, ...) {
+  uint32_t seq = nextSeq.fetch_add(1, std::memory_order_relaxed);
+  LogSlot& slot = ring[seq & LOG_RING_MASK];
+
+  slot.state.store(0, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+
+  slot.entry.seq = seq;
+  slot.entry.ms = millis();
+  slot.entry.level = level;
+  slot.entry.tag = tag;
+  slot.entry.id = 0;
+
+  va_list args;
+  va_start(args, format);
+  vsnprintf(slot.entry.text, sizeof(slot.entry.text), format, args);
+  va_end(args);
+
+  slot.state.store(seq + 1, std::memory_order_release);
+
+  if (drainTask) {
+    xTaskNotifyGive(drainTask);
+  }
+}
+
+#ifdef LOG_BINARY
+void logWriteRaw(uint8_t level, uint32_t id, const LogArgs& args) {
+  uint32_t seq = nextSeq.fetch_add(1, std::memory_order_relaxed);
+  LogSlot& slot = ring[seq & LOG_RING_MASK];
+
+  slot.state.store(0, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+
+  slot.entry.seq = seq;
+  slot.entry.ms = millis();
+  slot.entry.level = level;
+  slot.entry.tag = nullptr;
+  slot.entry.id = id;
+  slot.entry.size = args.size;
+  memcpy(slot.entry.text, args.data, args.size);
+
+  slot.state.store(seq + 1, std::memory_order_release);
+
+  if (drainTask) {
+    xTaskNotifyGive(drainTask);
+  }
+}
+
+// CRC-8 (polynomial 0x07) over the frame payload
+static uint8_t frameCrc(uint8_t crc, const uint8_t* data, size_t length) {
+  while (length--) {
+    crc ^= *data++;
+    for (int bit = 0; bit < 8; bit++) {
+      crc = (crc & 0x80) ? (crc << 1) ^ 0x07 : crc << 1;
+    }
+  }
+  return crc;
+}
+
+static void writeFrame(const LogEntry& entry) {
+  uint8_t frame[2 + 8 + LOG_LINE_MAX + 1];
+  frame[0] = LOG_FRAME_START;
+  frame[1] = 8 + entry.size;
+  memcpy(frame + 2, &entry.id, 4);
+  memcpy(frame + 6, &entry.ms, 4);
+  memcpy(frame + 10, entry.text, entry.size);
+  frame[10 + entry.size] = frameCrc(0, frame + 2, 8 + entry.size);
+  Serial.write(frame, 11 + entry.size);
+}
+#endif
+
+static void drainTaskFunc(void* param) {
+  uint32_t drained = 0;
+  uint32_t stuckWakes = 0;
+  LogEntry entry;
+
+  for (;;) {
+    // Writers notify; the timeout picks up slots that were still being written
+    ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(50));
+
+    uint32_t head;
+    while (drained != (head = nextSeq.load(std::memory_order_acquire))) {
+      if (head - drained > LOG_RING_SLOTS) {
+        uint32_t lost = head - drained - LOG_RING_SLOTS;
+        droppedCount.fetch_add(lost, std::memory_order_relaxed);
+        Serial.printf("[LOG] %lu messages dropped\n", (unsigned long)lost);
+        drained = head - LOG_RING_SLOTS;
+      }
+
+      if (!readSlot(drained, entry)) {
+        uint32_t state = ring[drained & LOG_RING_MASK].state.load(std::memory_order_acquire);
+        bool overwritten = state > drained + 1;
+        if (!overwritten && ++stuckWakes < LOG_STUCK_WAKES) {
+          break;   // Still being written - try again on the next wake
+        }
+        droppedCount.fetch_add(1, std::memory_order_relaxed);
+        stuckWakes = 0;
+        drained++;
+        continue;
+      }
+
+      stuckWakes = 0;
+      drained++;
+#ifdef LOG_BINARY
+      writeFrame(entry);
+#else
+      if (entry.level <= LOG_LEVEL_WARN) {
+        Serial.printf("[%s] %s: %s\n", entry.tag, entry.level == LOG_LEVEL_ERROR ? "ERROR" : "WARNING", entry.text);
+      } else {
+        Serial.printf("[%s] %s\n", entry.tag, entry.text);
+      }
+#endif
+    }
+  }
+}
+
+void setupLogger() {
+  if (drainTask) {
+    return;
+  }
+  if (xTaskCreate(drainTaskFunc, "logger", LOG_TASK_STACK, nullptr, LOG_TASK_PRIORITY, &drainTask) != pdPASS) {
+    Serial.println("[LOG] ERROR: Failed to start logger task");
+  }
+}
+
+bool getLogEntry(uint32_t seq, LogEntry& entry) {
+  return readSlot(seq, entry);
+}
+
+uint32_t getLogNextSeq() {
+  return nextSeq.load(std::memory_order_acquire);
+}
+
+uint32_t getLogDroppedCount() {
+  return droppedCount.load(std::memory_order_relaxed);
+}
+
+char getLogLevelChar(uint8_t level) {
+  static const char levels[] = "-EWIDV";
+  return level <= LOG_LEVEL_VERBOSE ? levels[level] : '?';
+}
@@ -0,0 +1,180 @@
+/*
+ * Logger
+ * Leveled log macros with per-module tags. Messages are formatted into a
+ * lock-free RAM ring and written to Serial by a background task, so a
+ * slow serial port never holds up the caller. Calls above LOG_LEVEL
+ * compile to nothing; the ring tail is served at /api/logs.
+ * With -DLOG_BINARY messages are stored and sent tokenized instead
+ * (decoded on the PC by tools/logdecode.py).
+ */
+
+#ifndef LOGGER_H
+#define LOGGER_H
+
+#include <Arduino.h>
+#include <type_traits>
+
+// Levels (LOG_LEVEL is set per build environment, see platformio.ini)
+#define LOG_LEVEL_NONE 0
+#define LOG_LEVEL_ERROR 1
+#define LOG_LEVEL_WARN 2
+#define LOG_LEVEL_INFO 3
+#define LOG_LEVEL_DEBUG 4
+#define LOG_LEVEL_VERBOSE 5
+
+#ifndef LOG_LEVEL
+#define LOG_LEVEL LOG_LEVEL_INFO
+#endif
+
+// ========== Logger Configuration ==========
+#define LOG_RING_SLOTS 64              // Messages kept in RAM (power of two)
+#define LOG_LINE_MAX 128               // Longer messages are truncated
+#define LOG_TASK_STACK 3072
+#define LOG_TASK_PRIORITY 1            // Same as loopTask: drains whenever the loop yields
+
+// One message as stored in the ring
+struct LogEntry {
+  uint32_t seq;                        // Position in the log stream
+  uint32_t ms;                         // millis() when logged
+  uint8_t level;
+  const char* tag;                     // String literal (nullptr in tokenized mode)
+  uint32_t id;                         // Format id in tokenized mode, otherwise 0
+  uint8_t size;                        // Bytes used in text (tokenized mode)
+  char text[LOG_LINE_MAX];             // Message, or packed arguments in tokenized mode
+};
+
+// Format a message into the ring (any task, not from ISRs)
+void logWrite(uint8_t level, const char* tag, const char* format, ...) __attribute__((format(printf, 3, 4)));
+
+#ifdef LOG_BINARY
+// ========== Tokenized Mode ==========
+// Each call site is reduced to a 32-bit id (FNV-1a of level, tag and format,
+// computed by the compiler), the arguments are copied raw. Tag and format
+// never reach flash; tools/logdecode.py rebuilds the table from the sources.
+//
+// Serial frame: 0x1E, length, id (LE), ms (LE), arguments, CRC-8 over id..arguments
+// Arguments: integers 4 bytes (8 for 64 bit), floating point as float,
+// strings as length byte + bytes
+
+#define LOG_FRAME_START 0x1E           // ASCII record separator, never part of text output
+
+constexpr uint32_t logFormatId(uint8_t level, const char* tag, const char* format) {
+  uint32_t hash = 2166136261u;
+  hash = (hash ^ level) * 16777619u;
+  for (; *tag; tag++) {
+    hash = (hash ^ (uint8_t)*tag) * 16777619u;
+  }
+  hash = (hash ^ 0) * 16777619u;
+  for (; *format; format++) {
+    hash = (hash ^ (uint8_t)*format) * 16777619u;
+  }
+  return hash;
+}
+
+// Packed arguments of one message
+struct LogArgs {
+  uint8_t size = 0;
+  uint8_t data[LOG_LINE_MAX];
+
+  void put(const void* src, size_t length) {
+    if (length > sizeof(data) - size) {
+      length = sizeof(data) - size;   // Truncated, the decoder marks missing arguments
+    }
+    memcpy(data + size, src, length);
+    size += length;
+  }
+};
+
+template <typename T>
+inline typename std::enable_if<std::is_integral<T>::value || std::is_enum<T>::value>::type
+logPack(LogArgs& args, T value) {
+  if (sizeof(T) > 4) {
+    uint64_t raw = (uint64_t)value;
+    args.put(&raw, 8);
+  } else {
+    uint32_t raw = (uint32_t)value;
+    args.put(&raw, 4);
+  }
+}
+
+inline void logPack(LogArgs& args, double value) {
+  float raw = (float)value;
+  args.put(&raw, 4);
+}
+
+inline void logPack(LogArgs& args, const char* value) {
+  size_t length = value ? strlen(value) : 0;
+  uint8_t raw = length > 255 ? 255 : length;
+  args.put(&raw, 1);
+  args.put(value, raw);
+}
+
+// Store a packed message in the ring
+void logWriteRaw(uint8_t level, uint32_t id, const LogArgs& args);
+
+template <typename... Args>
+inline void logWriteBinary(uint8_t level, uint32_t id, Args... values) {
+  LogArgs args;
+  (logPack(args, values), ...);
+  logWriteRaw(level, id, args);
+}
+
+// Never called; keeps the printf format check of the text mode
+inline void logFormatCheck(const char* format, ...) __attribute__((format(printf, 1, 2)));
+inline void logFormatCheck(const char* format, ...) {}
+
+#define LOG_EMIT(level, tag, format, ...) do { \
+    if (false) logFormatCheck(format, ##__VA_ARGS__); \
+    logWriteBinary(level, std::integral_constant<uint32_t, logFormatId(level, tag, format)>::value, ##__VA_ARGS__); \
+  } while (0)
+#else
+#define LOG_EMIT(level, tag, format, ...) logWrite(level, tag, format, ##__VA_ARGS__)
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_ERROR
+#define LOGE(tag, format, ...) LOG_EMIT(LOG_LEVEL_ERROR, tag, format, ##__VA_ARGS__)
+#else
+#define LOGE(tag, format, ...) do {} while (0)
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_WARN
+#define LOGW(tag, format, ...) LOG_EMIT(LOG_LEVEL_WARN, tag, format, ##__VA_ARGS__)
+#else
+#define LOGW(tag, format, ...) do {} while (0)
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_INFO
+#define LOGI(tag, format, ...) LOG_EMIT(LOG_LEVEL_INFO, tag, format, ##__VA_ARGS__)
+#else
+#define LOGI(tag, format, ...) do {} while (0)
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_DEBUG
+#define LOGD(tag, format, ...) LOG_EMIT(LOG_LEVEL_DEBUG, tag, format, ##__VA_ARGS__)
+#else
+#define LOGD(tag, format, ...) do {} while (0)
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_VERBOSE
+#define LOGV(tag, format, ...) LOG_EMIT(LOG_LEVEL_VERBOSE, tag, format, ##__VA_ARGS__)
+#else
+#define LOGV(tag, format, ...) do {} while (0)
+#endif
+
+// Start the Serial drain task (call right after Serial.begin())
+void setupLogger();
+
+// Copy the entry with sequence number seq; false if it is not (or no
+// longer) in the ring
+bool getLogEntry(uint32_t seq, LogEntry& entry);
+
+// Sequence number of the next message (entries in the ring: next - LOG_RING_SLOTS .. next - 1)
+uint32_t getLogNextSeq();
+
+// Messages overwritten before they reached Serial
+uint32_t getLogDroppedCount();
+
+// Single-letter level name (E, W, I, D, V)
+char getLogLevelChar(uint8_t level);
+
+#endif // LOGGER_H
@@ -0,0 +1,240 @@
+/*
+ * Main Loop Profiler Implementation
+ */
+
+#include "loop_profiler.h"
+#include <esp_timer.h>
+
+// Log-linear histogram: 4 sub-buckets per power of two, up to 2^27 us (~134 s)
+#define HIST_SUB_BUCKETS 4
+#define HIST_BUCKETS 104
+
+// Stall watchdog period (microseconds)
+#define STALL_CHECK_INTERVAL_US 50000
+
+struct LoopHistogram {
+  uint32_t buckets[HIST_BUCKETS];
+  uint32_t count;
+  uint32_t max;
+  uint64_t total;
+};
+
+static const char* const stageNames[LOOP_STAGE_COUNT + 1] = {
+  "wifi",
+  "websocket",
+  "statusRequest",
+  "ping",
+  "filamentSensor",
+  "statusNotify",
+  "settings",
+  "serial",
+  "otaHealth",
+  "pass"
+};
+
+// Index LOOP_STAGE_COUNT holds the whole-pass histogram
+static LoopHistogram histograms[LOOP_STAGE_COUNT + 1];
+
+// Current pass state (written by loop task, read by stall watchdog)
+static volatile int currentStage = -1;
+static volatile uint32_t stageStartCycles = 0;
+static volatile uint32_t passStartCycles = 0;
+static volatile bool stallReported = false;
+static uint32_t cpuMHz = 160;
+static uint32_t passStageUs[LOOP_STAGE_COUNT];
+
+// Stall tracking
+static volatile uint32_t stallCount = 0;
+static volatile int lastStallStage = -1;
+static volatile uint32_t lastStallUs = 0;
+
+static volatile bool resetRequested = false;
+static esp_timer_handle_t stallTimer = nullptr;
+
+static int bucketIndex(uint32_t us) {
+  if (us < HIST_SUB_BUCKETS) {
+    return us;
+  }
+  int msb = 31 - __builtin_clz(us);
+  int sub = (us >> (msb - 2)) & (HIST_SUB_BUCKETS - 1);
+  int index = (msb - 1) * HIST_SUB_BUCKETS + sub;
+  return index < HIST_BUCKETS ? index : HIST_BUCKETS - 1;
+}
+
+static uint32_t bucketUpperBound(int index) {
+  if (index < HIST_SUB_BUCKETS) {
+    return index;
+  }
+  int msb = index / HIST_SUB_BUCKETS + 1;
+  int sub = index % HIST_SUB_BUCKETS;
+  return ((uint32_t)(HIST_SUB_BUCKETS + sub + 1) << (msb - 2)) - 1;
+}
+
+static void recordSample(LoopHistogram& hist, uint32_t us) {
+  hist.buckets[bucketIndex(us)]++;
+  hist.count++;
+  hist.total += us;
+  if (us > hist.max) {
+    hist.max = us;
+  }
+}
+
+static uint32_t percentile(const LoopHistogram& hist, uint32_t permille) {
+  if (hist.count == 0) {
+    return 0;
+  }
+  uint32_t target = (uint32_t)(((uint64_t)hist.count * permille + 999) / 1000);
+  uint32_t seen = 0;
+  for (int i = 0; i < HIST_BUCKETS; i++) {
+    seen += hist.buckets[i];
+    if (seen >= target) {
+      uint32_t bound = bucketUpperBound(i);
+      return bound < hist.max ? bound : hist.max;
+    }
+  }
+  return hist.max;
+}
+
+static inline uint32_t elapsedUs(uint32_t startCycles) {
+  return (ESP.getCycleCount() - startCycles) / cpuMHz;
+}
+
+// Runs in the esp_timer task: reports a stage that is still running too long
+static void stallWatchdog(void* arg) {
+  int stage = currentStage;
+  if (stage < 0 || stallReported) {
+    return;
+  }
+
+  uint32_t passUs = elapsedUs(passStartCycles);
+  if (passUs > LOOP_STALL_THRESHOLD_US) {
+    stallReported = true;
+    Serial.printf("[LOOPPROF] ⚠️  Loop stalled: stage '%s' running for %lu ms (pass %lu ms)\n",
+                  stageNames[stage], (unsigned long)(elapsedUs(stageStartCycles) / 1000),
+                  (unsigned long)(passUs / 1000));
+  }
+}
+
+void setupLoopProfiler() {
+  memset(histograms, 0, sizeof(histograms));
+
+  esp_timer_create_args_t args = {};
+  args.callback = stallWatchdog;
+  args.name = "loopprof";
+  if (esp_timer_create(&args, &stallTimer) == ESP_OK) {
+    esp_timer_start_periodic(stallTimer, STALL_CHECK_INTERVAL_US);
+  }
+
+  Serial.printf("[LOOPPROF] Loop profiler initialized (stall threshold %d ms)\n",
+                LOOP_STALL_THRESHOLD_US / 1000);
+}
+
+void loopProfilerBeginPass() {
+  if (resetRequested) {
+    memset(histograms, 0, sizeof(histograms));
+    stallCount = 0;
+    lastStallStage = -1;
+    lastStallUs = 0;
+    resetRequested = false;
+  }
+
+  cpuMHz = ESP.getCpuFreqMHz();
+  memset(passStageUs, 0, sizeof(passStageUs));
+  stallReported = false;
+  passStartCycles = ESP.getCycleCount();
+}
+
+void loopProfilerEndPass() {
+  uint32_t passUs = elapsedUs(passStartCycles);
+  currentStage = -1;
+  recordSample(histograms[LOOP_STAGE_COUNT], passUs);
+
+  if (passUs <= LOOP_STALL_THRESHOLD_US) {
+    return;
+  }
+
+  // Attribute the stall to the slowest stage of this pass
+  int slowest = 0;
+  for (int i = 1; i < LOOP_STAGE_COUNT; i++) {
+    if (passStageUs[i] > passStageUs[slowest]) {
+      slowest = i;
+    }
+  }
+
+  stallCount++;
+  lastStallStage = slowest;
+  lastStallUs = passUs;
+
+  Serial.printf("[LOOPPROF] ⚠️  Slow loop pass: %lu ms, slowest stage '%s' (%lu ms)\n",
+                (unsigned long)(passUs / 1000), stageNames[slowest],
+                (unsigned long)(passStageUs[slowest] / 1000));
+}
+
+void loopProfilerBeginStage(LoopStage stage) {
+  stageStartCycles = ESP.getCycleCount();
+  currentStage = stage;
+}
+
+void loopProfilerEndStage() {
+  int stage = currentStage;
+  if (stage < 0) {
+    return;
+  }
+
+  uint32_t us = elapsedUs(stageStartCycles);
+  currentStage = -1;
+  passStageUs[stage] += us;
+  recordSample(histograms[stage], us);
+}
+
+LoopStageStats getLoopStageStats(int stage) {
+  LoopStageStats stats = {};
+  if (stage < 0 || stage > LOOP_STAGE_COUNT) {
+    return stats;
+  }
+
+  const LoopHistogram& hist = histograms[stage];
+  stats.name = stageNames[stage];
+  stats.count = hist.count;
+  stats.p50 = percentile(hist, 500);
+  stats.p99 = percentile(hist, 990);
+  stats.max = hist.max;
+  stats.mean = hist.count > 0 ? (uint32_t)(hist.total / hist.count) : 0;
+  return stats;
+}
+
+uint32_t getLoopStallCount() {
+  return stallCount;
+}
+
+const char* getLastStallStage() {
+  int stage = lastStallStage;
+  return stage >= 0 ? stageNames[stage] : nullptr;
+}
+
+uint32_t getLastStallDuration() {
+  return lastStallUs;
+}
+
+void resetLoopProfiler() {
+  // Applied by the loop task at the start of the next pass
+  resetRequested = true;
+}
+
+void printLoopProfile() {
+  Serial.println("\n--- Loop Profile (µs) ---");
+  Serial.println("Stage             Count        p50        p99        max       mean");
+  for (int i = 0; i <= LOOP_STAGE_COUNT; i++) {
+    LoopStageStats stats = getLoopStageStats(i);
+    Serial.printf("%-15s %8lu %10lu %10lu %10lu %10lu\n", stats.name,
+                  (unsigned long)stats.count, (unsigned long)stats.p50,
+                  (unsigned long)stats.p99, (unsigned long)stats.max,
+                  (unsigned long)stats.mean);
+  }
+  Serial.printf("Stalls (> %d ms): %lu", LOOP_STALL_THRESHOLD_US / 1000, (unsigned long)stallCount);
+  const char* stage = getLastStallStage();
+  if (stage) {
+    Serial.printf(", last in '%s' (%lu ms)", stage, (unsigned long)(lastStallUs / 1000));
+  }
+  Serial.println();
+}
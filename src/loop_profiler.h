@@ -0,0 +1,68 @@
+/*
+ * Main Loop Profiler
+ * Per-stage cycle-counter timing with constant-memory histograms
+ * and a stall detector for slow loop passes
+ */
+
+#ifndef LOOP_PROFILER_H
+#define LOOP_PROFILER_H
+
+#include <Arduino.h>
+
+// Instrumented stages of loop()
+enum LoopStage {
+  LOOP_STAGE_WIFI,
+  LOOP_STAGE_WEBSOCKET,
+  LOOP_STAGE_STATUS_REQUEST,
+  LOOP_STAGE_PING,
+  LOOP_STAGE_FILAMENT_SENSOR,
+  LOOP_STAGE_STATUS_NOTIFY,
+  LOOP_STAGE_SETTINGS,
+  LOOP_STAGE_SERIAL,
+  LOOP_STAGE_OTA_HEALTH,
+  LOOP_STAGE_COUNT
+};
+
+// A loop pass longer than this is reported as a stall (microseconds)
+#define LOOP_STALL_THRESHOLD_US 100000
+
+// Summary of one histogram (all times in microseconds)
+struct LoopStageStats {
+  const char* name;
+  uint32_t count;
+  uint32_t p50;
+  uint32_t p99;
+  uint32_t max;
+  uint32_t mean;
+};
+
+// Initialize profiler and start the stall watchdog
+void setupLoopProfiler();
+
+// Mark start/end of one loop() pass
+void loopProfilerBeginPass();
+void loopProfilerEndPass();
+
+// Mark start/end of a stage inside the current pass
+void loopProfilerBeginStage(LoopStage stage);
+void loopProfilerEndStage();
+
+// Get statistics for a stage (LOOP_STAGE_COUNT = whole pass)
+LoopStageStats getLoopStageStats(int stage);
+
+// Number of stalls detected since boot/reset
+uint32_t getLoopStallCount();
+
+// Stage that was running during the most recent stall (nullptr if none)
+const char* getLastStallStage();
+
+// Duration of the most recent stalled pass (microseconds)
+uint32_t getLastStallDuration();
+
+// Clear all histograms and stall counters
+void resetLoopProfiler();
+
+// Print profile table to Serial
+void printLoopProfile();
+
+#endif // LOOP_PROFILER_H
@@ -16,6 +16,18 @@
 #include "filament_sensor.h"
 #include "ota_update.h"
 #include "callmebot.h"
+#include "notifier.h"
+#include "notification_sinks.h"
+#include "mqtt_client.h"
+#include "settings_store.h"
+#include "loop_profiler.h"
+#include "heap_monitor.h"
+#include "serial_config.h"
+#include "boot_profiler.h"
+#include "warm_restart.h"
+#include "power_manager.h"
+#include "ota_health.h"
+#include "logger.h"
 
 // Timing variables
 unsigned long lastStatusRequest = 0;
@@ -24,7 +36,31 @@ bool inSetupMode = false;
 
 void setup() {
   Serial.begin(115200);
-  delay(1000);
+  setupLogger();
+  bootProfilerBegin();
+#if BOOT_SERIAL_WAIT_MS > 0
+  delay(BOOT_SERIAL_WAIT_MS);
+#endif
+
+  // Load all persistent settings (one NVS blob)
+  bootPhase("settings");
+  setupSettingsStore();
+
+  // A new image on trial counts this boot (rolls back after a crash loop)
+  bootPhase("otaHealth");
+  setupOTAHealthGate();
+
+  // Continue a running print after a warm restart (OTA, watchdog, restart)
+  bootPhase("warmRestart");
+  setupWarmRestart();
+  restorePrintStatus();
+
+  // Arm the filament sensor first: drive the runout pin before anything slow runs
+  bootPhase("sensor");
+  setupFilamentSensor();
+  checkFilamentSensor();
+  bootProfilerMark(BOOT_MARK_SENSOR_ARMED);
+
   Serial.println("\n\n=================================");
   Serial.println("Centauri Carbon Monitor - ESP32");
   Serial.println("With Filament Runout Detection");
@@ -32,27 +68,52 @@ void setup() {
   Serial.println("=================================\n");
 
   // Initialize configuration manager
+  bootPhase("config");
   initConfigManager();
 
   // Initialize OTA update system
+  bootPhase("ota");
   setupOTA();
 
-  // Initialize filament sensor
-  setupFilamentSensor();
-
   // Initialize CallMeBot notifications
+  bootPhase("callmebot");
   setupCallMeBot();
 
+  // Start MQTT status publishing (own task)
+  bootPhase("mqtt");
+  setupMqttClient();
+
+  // Initialize webhook/ntfy/MQTT notification sinks (MQTT uses the status client)
+  bootPhase("sinks");
+  setupNotificationSinks();
+
+  // Start background notification dispatcher
+  bootPhase("notifier");
+  setupNotifier();
+
+  // Idle power saving (frequency scaling, modem sleep, waiting loop)
+  bootPhase("power");
+  setupPowerManager();
+
+  // Initialize main loop profiler
+  bootPhase("profilers");
+  setupLoopProfiler();
+
+  // Start background heap sampling
+  setupHeapMonitor();
+
   // Check if system is configured
   if (!isConfigured()) {
     Serial.println("[MAIN] System not configured!");
     Serial.println("[MAIN] Starting setup portal...");
 
     // Start Access Point for initial setup
+    bootPhase("portal");
     startConfigPortal();
     inSetupMode = true;
 
     // Start web server for setup portal
+    bootPhase("webServer");
     setupWebServer();
 
     Serial.println("[MAIN] Setup portal ready!");
@@ -60,49 +121,91 @@ void setup() {
   } else {
     Serial.println("[MAIN] System configured, starting normal operation...");
 
-    // Connect to WiFi
-    connectWiFi();
-
-    // Only setup WebSocket and normal web server if WiFi connected
-    if (isWiFiConnected()) {
-      setupWebSocket();
-      setupWebServer();
-      Serial.println("[MAIN] System ready!");
-    } else {
-      Serial.println("[MAIN] WiFi connection failed! Starting setup portal...");
-      startConfigPortal();
-      inSetupMode = true;
-      setupWebServer();
-    }
+    // Connect to WiFi in the background - the sensor runs from the first loop
+    bootPhase("wifi");
+    setupWiFiManager();
+
+    // Web server and WebSocket client start right away and work once the link is up
+    bootPhase("webSocket");
+    setupWebSocket();
+    bootPhase("webServer");
+    setupWebServer();
+    Serial.println("[MAIN] System ready!");
   }
+
+  bootProfilerEnd();
 }
 
 void loop() {
   // If in setup mode, just wait for configuration
   if (inSetupMode) {
+    checkSerialConfig();
+    handleOTAHealthGate();
+    handlePowerManager();
     delay(100);
     return;
   }
 
   // Normal operation
+  loopProfilerBeginPass();
+
+  // Keep the WiFi connection up (non-blocking)
+  loopProfilerBeginStage(LOOP_STAGE_WIFI);
+  handleWiFiManager();
+  loopProfilerEndStage();
+
+  bool online = isWiFiConnected();
+
   // Process WebSocket communication
-  processWebSocket();
+  if (online) {
+    loopProfilerBeginStage(LOOP_STAGE_WEBSOCKET);
+    processWebSocket();
+    loopProfilerEndStage();
+  }
 
   // Send periodic status requests
-  if (millis() - lastStatusRequest > STATUS_INTERVAL) {
+  if (online && millis() - lastStatusRequest > STATUS_INTERVAL) {
+    loopProfilerBeginStage(LOOP_STAGE_STATUS_REQUEST);
     requestStatus();
+    loopProfilerEndStage();
     lastStatusRequest = millis();
   }
 
   // Send periodic ping
-  if (millis() - lastPing > PING_INTERVAL) {
+  if (online && millis() - lastPing > PING_INTERVAL) {
+    loopProfilerBeginStage(LOOP_STAGE_PING);
     sendPing();
+    loopProfilerEndStage();
     lastPing = millis();
   }
 
-  // Check filament sensor
+  // Check filament sensor (also while offline)
+  loopProfilerBeginStage(LOOP_STAGE_FILAMENT_SENSOR);
   checkFilamentSensor();
+  loopProfilerEndStage();
 
   // Check for status changes and send notifications
+  loopProfilerBeginStage(LOOP_STAGE_STATUS_NOTIFY);
   checkStatusNotifications();
+  loopProfilerEndStage();
+
+  // Commit debounced settings changes
+  loopProfilerBeginStage(LOOP_STAGE_SETTINGS);
+  handleSettingsStore();
+  loopProfilerEndStage();
+
+  // Handle serial configuration/diagnostic commands
+  loopProfilerBeginStage(LOOP_STAGE_SERIAL);
+  checkSerialConfig();
+  loopProfilerEndStage();
+
+  // Confirm a freshly updated image or roll it back
+  loopProfilerBeginStage(LOOP_STAGE_OTA_HEALTH);
+  handleOTAHealthGate();
+  loopProfilerEndStage();
+
+  loopProfilerEndPass();
+
+  // Scale down and wait for the next event while the printer is idle
+  handlePowerManager();
 }
@@ -0,0 +1,192 @@
+/*
+ * Metrics Module Implementation
+ */
+
+#include "metrics.h"
+#include "settings_store.h"
+#include "wifi_manager.h"
+#include "boot_profiler.h"
+#include "power_manager.h"
+#include "ota_health.h"
+#include "logger.h"
+
+#define METRIC_PREFIX "centauri_"
+
+std::atomic<uint32_t> metricCounters[METRIC_COUNTER_COUNT];
+
+// Name and help text for each domain counter (same order as MetricCounter)
+static const struct {
+  const char* name;
+  const char* help;
+} counterInfo[METRIC_COUNTER_COUNT] = {
+  { "motion_pulses_total",      "Filament motion sensor pulses" },
+  { "jam_events_total",         "Filament jams detected" },
+  { "runout_events_total",      "Filament runouts detected" },
+  { "auto_pauses_total",        "Pause commands sent by the filament sensor" },
+  { "ws_reconnects_total",      "WebSocket reconnects to the printer" },
+  { "ws_frames_parsed_total",   "WebSocket frames parsed successfully" },
+  { "ws_parse_errors_total",    "WebSocket frames that failed to parse" },
+  { "callmebot_sent_total",     "CallMeBot notifications sent" },
+  { "callmebot_failed_total",   "CallMeBot notifications that failed" },
+  { "notify_retries_total",     "Notification delivery retries" },
+  { "notify_dropped_total",     "Notifications dropped (queue full or retries exhausted)" },
+  { "notify_coalesced_total",   "Notifications merged into a digest" },
+  { "sink_sent_total",          "Batches delivered via webhook, ntfy or MQTT" },
+  { "sink_failed_total",        "Batches that failed via webhook, ntfy or MQTT" },
+  { "mqtt_published_total",     "MQTT status and discovery messages published" },
+  { "mqtt_reconnects_total",    "MQTT status client reconnects to the broker" },
+  { "settings_changes_total",   "Settings updates (any section)" },
+  { "settings_commits_total",   "Settings blob writes to NVS" },
+  { "wifi_disconnects_total",   "WiFi links lost after being connected" },
+  { "wifi_connect_failures_total", "WiFi connection attempts that ended in backoff" },
+  { "http_overloaded_total",    "HTTP requests rejected with 503 (concurrency limit)" },
+  { "http_rate_limited_total",  "HTTP requests rejected with 429 (per-client rate limit)" },
+};
+
+// HTTP latency bucket upper bounds
+static const uint32_t httpBucketUs[METRICS_HTTP_BUCKET_COUNT] = {
+  1000, 5000, 10000, 25000, 50000, 100000, 250000, 500000, 1000000, 2500000
+};
+static const char* const httpBucketLabel[METRICS_HTTP_BUCKET_COUNT] = {
+  "0.001", "0.005", "0.01", "0.025", "0.05", "0.1", "0.25", "0.5", "1", "2.5"
+};
+
+// Per-route HTTP statistics
+struct HttpRouteMetrics {
+  const char* method;
+  const char* path;
+  std::atomic<uint32_t> count;
+  std::atomic<uint32_t> buckets[METRICS_HTTP_BUCKET_COUNT];  // Non-cumulative
+  std::atomic<uint64_t> sumUs;
+};
+
+static HttpRouteMetrics httpRoutes[METRICS_MAX_HTTP_ROUTES];
+static int httpRouteCount = 0;
+
+int metricsRegisterHttpRoute(const char* method, const char* path) {
+  if (httpRouteCount >= METRICS_MAX_HTTP_ROUTES) {
+    Serial.printf("[METRICS] Route table full, not tracking %s %s\n", method, path);
+    return -1;
+  }
+
+  HttpRouteMetrics& route = httpRoutes[httpRouteCount];
+  route.method = method;
+  route.path = path;
+  return httpRouteCount++;
+}
+
+void metricsRecordHttpRequest(int slot, uint32_t latencyUs) {
+  if (slot < 0 || slot >= httpRouteCount) {
+    return;
+  }
+
+  HttpRouteMetrics& route = httpRoutes[slot];
+  route.count.fetch_add(1, std::memory_order_relaxed);
+  route.sumUs.fetch_add(latencyUs, std::memory_order_relaxed);
+
+  for (int i = 0; i < METRICS_HTTP_BUCKET_COUNT; i++) {
+    if (latencyUs <= httpBucketUs[i]) {
+      route.buckets[i].fetch_add(1, std::memory_order_relaxed);
+      break;
+    }
+  }
+}
+
+static void writeHeader(Print& out, const char* name, const char* help, const char* type) {
+  out.printf("# HELP " METRIC_PREFIX "%s %s\n", name, help);
+  out.printf("# TYPE " METRIC_PREFIX "%s %s\n", name, type);
+}
+
+static void writeGauge(Print& out, const char* name, const char* help, unsigned long value) {
+  writeHeader(out, name, help, "gauge");
+  out.printf(METRIC_PREFIX "%s %lu\n", name, value);
+}
+
+void writeMetrics(Print& out) {
+  // Domain counters
+  for (int i = 0; i < METRIC_COUNTER_COUNT; i++) {
+    writeHeader(out, counterInfo[i].name, counterInfo[i].help, "counter");
+    out.printf(METRIC_PREFIX "%s %lu\n", counterInfo[i].name,
+               (unsigned long)metricCounters[i].load(std::memory_order_relaxed));
+  }
+
+  // System gauges
+  writeGauge(out, "uptime_seconds", "Seconds since boot", millis() / 1000);
+  writeGauge(out, "heap_free_bytes", "Free heap", ESP.getFreeHeap());
+  writeGauge(out, "heap_largest_free_block_bytes", "Largest allocatable heap block", ESP.getMaxAllocHeap());
+  writeGauge(out, "heap_min_free_bytes", "Minimum free heap since boot", ESP.getMinFreeHeap());
+
+  // Power
+  writeGauge(out, "cpu_frequency_mhz", "Current CPU frequency", getCpuFrequencyMhz());
+  writeGauge(out, "power_idle", "1 while the power manager is in idle mode",
+             getPowerMode() == POWER_MODE_IDLE ? 1 : 0);
+  writeGauge(out, "power_idle_seconds", "Seconds spent in idle mode since boot", getPowerIdleSeconds());
+
+  // Boot timeline (0 = milestone not reached yet)
+  const BootTimeline& boot = getBootTimeline();
+  writeGauge(out, "boot_count", "Boots since power-on", boot.bootCount);
+  writeGauge(out, "boot_sensor_armed_us", "Microseconds from boot until the filament sensor was armed",
+             boot.marks[BOOT_MARK_SENSOR_ARMED]);
+  writeGauge(out, "boot_setup_us", "Microseconds from boot until setup() returned",
+             boot.marks[BOOT_MARK_SETUP_DONE]);
+
+  // WiFi link
+  writeGauge(out, "wifi_connected", "1 if the WiFi station is connected", isWiFiConnected() ? 1 : 0);
+  writeHeader(out, "wifi_rssi_dbm", "WiFi signal strength (0 if not connected)", "gauge");
+  out.printf(METRIC_PREFIX "wifi_rssi_dbm %d\n", getWiFiRssi());
+  writeGauge(out, "wifi_link_uptime_seconds", "Seconds since the current WiFi link came up",
+             getWiFiLinkUptime() / 1000);
+  writeGauge(out, "wifi_last_connect_ms", "Duration of the last successful WiFi connect",
+             getWiFiLastConnectTime());
+
+  // OTA health gate
+  writeGauge(out, "ota_pending_verify", "1 while a new firmware image is on trial",
+             getOTAHealthState() == OTA_HEALTH_PENDING ? 1 : 0);
+
+  // Log ring
+  writeGauge(out, "log_dropped", "Log messages overwritten before they reached Serial", getLogDroppedCount());
+
+  // NVS wear
+  SettingsStats settings = getSettingsStats();
+  writeGauge(out, "settings_lifetime_commits", "Settings blob writes over the device lifetime",
+             settings.lifetimeCommits);
+  writeGauge(out, "settings_blob_bytes", "Bytes written per settings commit", settings.blobSize);
+  writeGauge(out, "settings_pending", "1 if settings changes are waiting for the debounced commit",
+             settings.pending ? 1 : 0);
+  writeHeader(out, "settings_section_changes_total", "Settings updates per section", "counter");
+  for (int i = 0; i < SETTINGS_SECTION_COUNT; i++) {
+    out.printf(METRIC_PREFIX "settings_section_changes_total{section=\"%s\"} %lu\n",
+               getSettingsSectionName((SettingsSection)i), (unsigned long)settings.sectionChanges[i]);
+  }
+
+  // HTTP request counts
+  writeHeader(out, "http_requests_total", "HTTP requests handled per route", "counter");
+  for (int r = 0; r < httpRouteCount; r++) {
+    const HttpRouteMetrics& route = httpRoutes[r];
+    out.printf(METRIC_PREFIX "http_requests_total{method=\"%s\",route=\"%s\"} %lu\n",
+               route.method, route.path, (unsigned long)route.count.load(std::memory_order_relaxed));
+  }
+
+  // HTTP handler latency histograms
+  writeHeader(out, "http_request_duration_seconds", "HTTP handler latency per route", "histogram");
+  for (int r = 0; r < httpRouteCount; r++) {
+    const HttpRouteMetrics& route = httpRoutes[r];
+    uint32_t cumulative = 0;
+
+    for (int b = 0; b < METRICS_HTTP_BUCKET_COUNT; b++) {
+      cumulative += route.buckets[b].load(std::memory_order_relaxed);
+      out.printf(METRIC_PREFIX "http_request_duration_seconds_bucket{method=\"%s\",route=\"%s\",le=\"%s\"} %lu\n",
+                 route.method, route.path, httpBucketLabel[b], (unsigned long)cumulative);
+    }
+
+    uint32_t count = route.count.load(std::memory_order_relaxed);
+    uint64_t sumUs = route.sumUs.load(std::memory_order_relaxed);
+    out.printf(METRIC_PREFIX "http_request_duration_seconds_bucket{method=\"%s\",route=\"%s\",le=\"+Inf\"} %lu\n",
+               route.method, route.path, (unsigned long)count);
+    out.printf(METRIC_PREFIX "http_request_duration_seconds_sum{method=\"%s\",route=\"%s\"} %lu.%06lu\n",
+               route.method, route.path,
+               (unsigned long)(sumUs / 1000000), (unsigned long)(sumUs % 1000000));
+    out.printf(METRIC_PREFIX "http_request_duration_seconds_count{method=\"%s\",route=\"%s\"} %lu\n",
+               route.method, route.path, (unsigned long)count);
+  }
+}
@@ -0,0 +1,67 @@
+/*
+ * Metrics Module
+ * Preallocated counters and gauges, exported in Prometheus text format
+ */
+
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <Arduino.h>
+#include <atomic>
+
+// Domain counters (monotonic since boot)
+enum MetricCounter {
+  METRIC_MOTION_PULSES,
+  METRIC_JAM_EVENTS,
+  METRIC_RUNOUT_EVENTS,
+  METRIC_AUTO_PAUSES,
+  METRIC_WS_RECONNECTS,
+  METRIC_WS_FRAMES_PARSED,
+  METRIC_WS_PARSE_ERRORS,
+  METRIC_CALLMEBOT_SENT,
+  METRIC_CALLMEBOT_FAILED,
+  METRIC_NOTIFY_RETRIES,
+  METRIC_NOTIFY_DROPPED,
+  METRIC_NOTIFY_COALESCED,
+  METRIC_SINK_SENT,
+  METRIC_SINK_FAILED,
+  METRIC_MQTT_PUBLISHED,
+  METRIC_MQTT_RECONNECTS,
+  METRIC_SETTINGS_CHANGES,
+  METRIC_SETTINGS_COMMITS,
+  METRIC_WIFI_DISCONNECTS,
+  METRIC_WIFI_CONNECT_FAILURES,
+  METRIC_HTTP_OVERLOADED,
+  METRIC_HTTP_RATE_LIMITED,
+  METRIC_COUNTER_COUNT
+};
+
+// Maximum number of HTTP routes tracked individually
+#define METRICS_MAX_HTTP_ROUTES 32
+
+// Number of finite HTTP latency buckets (+Inf is implicit)
+#define METRICS_HTTP_BUCKET_COUNT 10
+
+// Counter storage (use metricsIncrement() instead of accessing directly)
+extern std::atomic<uint32_t> metricCounters[METRIC_COUNTER_COUNT];
+
+// Increment a domain counter (safe from ISRs and any task)
+inline __attribute__((always_inline)) void metricsIncrement(MetricCounter counter) {
+  metricCounters[counter].fetch_add(1, std::memory_order_relaxed);
+}
+
+// Read a domain counter
+inline uint32_t metricsGet(MetricCounter counter) {
+  return metricCounters[counter].load(std::memory_order_relaxed);
+}
+
+// Register an HTTP route, returns its slot (-1 if the table is full)
+int metricsRegisterHttpRoute(const char* method, const char* path);
+
+// Record one handled request on a route slot
+void metricsRecordHttpRequest(int slot, uint32_t latencyUs);
+
+// Write all metrics in Prometheus text exposition format
+void writeMetrics(Print& out);
+
+#endif // METRICS_H
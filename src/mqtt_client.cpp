@@ -0,0 +1,445 @@
+/*
+ * MQTT Status Client Implementation
+ *
+ * Topics (base = getMqttBaseTopic()):
+ *   <base>/availability    online/offline (retained, offline is the last will)
+ *   <base>/state/<field>   current value (retained, published on change)
+ *   <base>/command         pause | resume | toggleLight
+ *
+ * Connecting, publishing and the command callback all run in the MQTT
+ * task; the printer controls are called from there like from the web
+ * server's handlers. PubSubClient is not thread-safe, so each pass holds
+ * sessionMutex and publishMqttMessage() (notifier task) takes it too.
+ */
+
+#include "mqtt_client.h"
+#include "wifi_manager.h"
+#include "config.h"
+#include "config_manager.h"
+#include "printer_status.h"
+#include "printer_control.h"
+#include "filament_sensor.h"
+#include "metrics.h"
+#include "settings_store.h"
+#include <WiFi.h>
+#include <PubSubClient.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <freertos/semphr.h>
+#include <ArduinoJson.h>
+
+static WiFiClient mqttSocket;
+static PubSubClient mqtt(mqttSocket);
+static SemaphoreHandle_t sessionMutex = nullptr;   // Guards mqtt (MQTT and notifier task)
+
+// Settings: written by the web server, applied in the MQTT task
+static MqttConfig activeConfig;
+static MqttConfig pendingConfig;
+static volatile bool configPending = false;
+static portMUX_TYPE configMux = portMUX_INITIALIZER_UNLOCKED;
+
+// Connection state (MQTT task only)
+static TaskHandle_t mqttTask = nullptr;
+static char baseTopic[80];
+static unsigned long nextConnectMs = 0;
+static unsigned long reconnectDelay = MQTT_RECONNECT_MIN_MS;
+static bool connectedOnce = false;
+static int discoveryIndex = 0;     // Next discovery payload to publish
+static unsigned long lastStateCheck = 0;
+static bool stateBacklog = false;  // Changed fields left over from the last pass
+static volatile bool sessionUp = false;  // Readable from other tasks
+
+// ========== Published Fields ==========
+
+struct StatusField {
+  const char* key;           // Topic suffix and unique_id suffix
+  const char* name;          // Home Assistant entity name
+  const char* component;     // Home Assistant platform
+  const char* unit;          // nullptr if none
+  const char* deviceClass;   // nullptr if none
+  uint8_t decimals;          // Numeric fields
+  float deadband;            // Minimum change before a number is republished
+  float (*number)();         // Numeric fields
+  const char* (*text)();     // Text and binary fields (binary: "ON"/"OFF")
+};
+
+static const char* onOff(bool value) {
+  return value ? "ON" : "OFF";
+}
+
+static const StatusField fields[] = {
+  { "status", "Status", "sensor", nullptr, nullptr, 0, 0, nullptr,
+    []() { return getStatusText(printerStatus.printStatus); } },
+  { "progress", "Progress", "sensor", "%", nullptr, 0, 1, []() { return (float)printerStatus.progress; }, nullptr },
+  { "layer", "Layer", "sensor", nullptr, nullptr, 0, 1, []() { return (float)printerStatus.currentLayer; }, nullptr },
+  { "total_layers", "Total layers", "sensor", nullptr, nullptr, 0, 1,
+    []() { return (float)printerStatus.totalLayers; }, nullptr },
+  { "nozzle_temp", "Nozzle temperature", "sensor", "°C", "temperature", 1, 0.5f,
+    []() { return printerStatus.nozzleTemp; }, nullptr },
+  { "nozzle_target", "Nozzle target", "sensor", "°C", "temperature", 0, 1,
+    []() { return printerStatus.nozzleTargetTemp; }, nullptr },
+  { "bed_temp", "Bed temperature", "sensor", "°C", "temperature", 1, 0.5f,
+    []() { return printerStatus.bedTemp; }, nullptr },
+  { "bed_target", "Bed target", "sensor", "°C", "temperature", 0, 1,
+    []() { return printerStatus.bedTargetTemp; }, nullptr },
+  { "chamber_temp", "Chamber temperature", "sensor", "°C", "temperature", 1, 0.5f,
+    []() { return printerStatus.chamberTemp; }, nullptr },
+  { "print_speed", "Print speed", "sensor", "%", nullptr, 0, 1, []() { return (float)printerStatus.printSpeed; }, nullptr },
+  { "model_fan", "Model fan", "sensor", "%", nullptr, 0, 1, []() { return (float)printerStatus.modelFan; }, nullptr },
+  { "filename", "File", "sensor", nullptr, nullptr, 0, 0, nullptr,
+    []() { return printerStatus.filename.c_str(); } },
+  { "light", "Light", "binary_sensor", nullptr, "light", 0, 0, nullptr,
+    []() { return onOff(printerStatus.lightOn); } },
+  { "filament_error", "Filament error", "binary_sensor", nullptr, "problem", 0, 0, nullptr,
+    []() { return onOff(isFilamentErrorDetected()); } },
+  { "filament_present", "Filament present", "binary_sensor", nullptr, nullptr, 0, 0, nullptr,
+    []() { return onOff(digitalRead(SENSOR_SWITCH) == HIGH); } },
+  { "auto_pause", "Auto-pause", "binary_sensor", nullptr, nullptr, 0, 0, nullptr,
+    []() { return onOff(getAutoPauseEnabled()); } },
+};
+
+#define FIELD_COUNT (sizeof(fields) / sizeof(fields[0]))
+
+// Buttons announced for the command topic
+static const struct {
+  const char* command;
+  const char* name;
+} buttons[] = {
+  { "pause", "Pause print" },
+  { "resume", "Resume print" },
+  { "toggleLight", "Toggle light" },
+};
+
+#define BUTTON_COUNT (sizeof(buttons) / sizeof(buttons[0]))
+
+// Last published value per field
+static bool published[FIELD_COUNT];  // Since the current session started
+static char lastValue[FIELD_COUNT][MQTT_VALUE_SIZE];
+static float lastNumber[FIELD_COUNT];
+
+// ========== Helpers ==========
+
+static bool publish(const char* suffix, const char* payload, bool retained) {
+  char topic[128];
+  snprintf(topic, sizeof(topic), "%s/%s", baseTopic, suffix);
+  if (!mqtt.publish(topic, payload, retained)) {
+    return false;
+  }
+  metricsIncrement(METRIC_MQTT_PUBLISHED);
+  return true;
+}
+
+static void addDevice(JsonDocument& doc) {
+  JsonObject device = doc["device"].to<JsonObject>();
+  device["identifiers"].to<JsonArray>().add(getDeviceId());
+  device["name"] = "Centauri Carbon Monitor";
+  device["manufacturer"] = "Elegoo";
+  device["model"] = "Centauri Carbon";
+}
+
+// Publish one discovery payload (fields first, then buttons)
+static bool publishDiscovery(int index) {
+  JsonDocument doc;
+  char topic[160];
+  char uniqueId[64];
+  char availability[96];
+  snprintf(availability, sizeof(availability), "%s/availability", baseTopic);
+
+  const char* component;
+  const char* key;
+
+  if (index < (int)FIELD_COUNT) {
+    const StatusField& field = fields[index];
+    char stateTopic[128];
+    snprintf(stateTopic, sizeof(stateTopic), "%s/state/%s", baseTopic, field.key);
+    component = field.component;
+    key = field.key;
+
+    doc["name"] = field.name;
+    doc["state_topic"] = stateTopic;
+    if (field.unit) doc["unit_of_measurement"] = field.unit;
+    if (field.deviceClass) doc["device_class"] = field.deviceClass;
+    if (field.number) doc["state_class"] = "measurement";
+  } else {
+    int button = index - FIELD_COUNT;
+    char commandTopic[96];
+    snprintf(commandTopic, sizeof(commandTopic), "%s/command", baseTopic);
+    component = "button";
+    key = buttons[button].command;
+
+    doc["name"] = buttons[button].name;
+    doc["command_topic"] = commandTopic;
+    doc["payload_press"] = buttons[button].command;
+  }
+
+  snprintf(uniqueId, sizeof(uniqueId), "%s_%s", getDeviceId(), key);
+  doc["unique_id"] = uniqueId;
+  doc["availability_topic"] = availability;
+  addDevice(doc);
+
+  char payload[MQTT_DISCOVERY_SIZE];
+  size_t length = serializeJson(doc, payload, sizeof(payload));
+  if (length >= sizeof(payload) - 1) {
+    Serial.printf("[MQTT] ⚠️ Discovery payload for %s too large\n", key);
+    return true;  // Skip it, retrying would not help
+  }
+
+  snprintf(topic, sizeof(topic), "%s/%s/%s/%s/config",
+           activeConfig.discoveryPrefix, component, getDeviceId(), key);
+  if (!mqtt.publish(topic, payload, true)) {
+    return false;
+  }
+  metricsIncrement(METRIC_MQTT_PUBLISHED);
+  return true;
+}
+
+// Format a field; returns false if it has not changed since the last publish
+static bool formatChangedField(int index, char* out, size_t size) {
+  const StatusField& field = fields[index];
+
+  if (field.number) {
+    float value = field.number();
+    if (published[index] && fabsf(value - lastNumber[index]) < field.deadband) {
+      return false;
+    }
+    snprintf(out, size, "%.*f", field.decimals, value);
+  } else {
+    const char* text = field.text();
+    strlcpy(out, text ? text : "", size);
+  }
+
+  return !published[index] || strcmp(out, lastValue[index]) != 0;
+}
+
+// Publish changed fields within the per-pass budget
+static void publishChangedFields(int& budget) {
+  char value[MQTT_VALUE_SIZE];
+  char suffix[48];
+  stateBacklog = false;
+
+  for (int i = 0; i < (int)FIELD_COUNT; i++) {
+    if (!formatChangedField(i, value, sizeof(value))) {
+      continue;
+    }
+    if (budget <= 0) {
+      stateBacklog = true;
+      return;
+    }
+
+    snprintf(suffix, sizeof(suffix), "state/%s", fields[i].key);
+    if (!publish(suffix, value, true)) {
+      return;
+    }
+    budget--;
+    published[i] = true;
+    strlcpy(lastValue[i], value, sizeof(lastValue[i]));
+    if (fields[i].number) {
+      lastNumber[i] = fields[i].number();
+    }
+  }
+}
+
+static void onMessage(char* topic, byte* payload, unsigned int length) {
+  char command[32];
+  length = min(length, (unsigned int)sizeof(command) - 1);
+  memcpy(command, payload, length);
+  command[length] = '\0';
+
+  Serial.printf("[MQTT] Command: %s\n", command);
+
+  if (strcmp(command, "pause") == 0) {
+    pausePrint();
+  } else if (strcmp(command, "resume") == 0) {
+    resumePrint();
+  } else if (strcmp(command, "toggleLight") == 0) {
+    toggleLight();
+  } else {
+    Serial.printf("[MQTT] ⚠️ Unknown command: %s\n", command);
+  }
+}
+
+static void applyConfig() {
+  if (mqtt.connected()) {
+    publish("availability", "offline", true);
+    mqtt.disconnect();
+  }
+
+  portENTER_CRITICAL(&configMux);
+  activeConfig = pendingConfig;
+  configPending = false;
+  portEXIT_CRITICAL(&configMux);
+
+  if (activeConfig.baseTopic[0]) {
+    strlcpy(baseTopic, activeConfig.baseTopic, sizeof(baseTopic));
+  } else {
+    snprintf(baseTopic, sizeof(baseTopic), "centauri/%s", getDeviceId());
+  }
+
+  mqtt.setServer(activeConfig.host, activeConfig.port ? activeConfig.port : MQTT_DEFAULT_PORT);
+  nextConnectMs = 0;
+  reconnectDelay = MQTT_RECONNECT_MIN_MS;
+}
+
+static bool connectBroker() {
+  char willTopic[96];
+  snprintf(willTopic, sizeof(willTopic), "%s/availability", baseTopic);
+
+  const char* user = activeConfig.user[0] ? activeConfig.user : nullptr;
+  const char* password = activeConfig.password[0] ? activeConfig.password : nullptr;
+
+  if (!mqtt.connect(getDeviceId(), user, password, willTopic, 1, true, "offline")) {
+    Serial.printf("[MQTT] ❌ Connect to %s failed (state %d), retry in %lu s\n",
+                  activeConfig.host, mqtt.state(), reconnectDelay / 1000);
+    return false;
+  }
+
+  if (connectedOnce) {
+    metricsIncrement(METRIC_MQTT_RECONNECTS);
+  }
+  connectedOnce = true;
+  Serial.printf("[MQTT] ✓ Connected to %s, base topic %s\n", activeConfig.host, baseTopic);
+
+  char commandTopic[96];
+  snprintf(commandTopic, sizeof(commandTopic), "%s/command", baseTopic);
+  mqtt.subscribe(commandTopic);
+  publish("availability", "online", true);
+
+  // Republish everything on each new session
+  memset(published, 0, sizeof(published));
+  discoveryIndex = activeConfig.discoveryPrefix[0] ? 0 : FIELD_COUNT + BUTTON_COUNT;
+  stateBacklog = true;
+  return true;
+}
+
+// Connect, publish changes and handle commands
+static void handleMqttSession() {
+  if (configPending) {
+    applyConfig();
+  }
+  if (!activeConfig.enabled || activeConfig.host[0] == '\0' || !isWiFiConnected()) {
+    sessionUp = false;
+    return;
+  }
+
+  sessionUp = mqtt.connected();
+  if (!sessionUp) {
+    if ((long)(millis() - nextConnectMs) < 0) {
+      return;
+    }
+    if (!connectBroker()) {
+      nextConnectMs = millis() + reconnectDelay;
+      reconnectDelay = min(reconnectDelay * 2, (unsigned long)MQTT_RECONNECT_MAX_MS);
+      return;
+    }
+    reconnectDelay = MQTT_RECONNECT_MIN_MS;
+    sessionUp = true;
+  }
+
+  mqtt.loop();
+
+  int budget = MQTT_PUBLISH_BUDGET;
+
+  // Discovery first, a few payloads per pass
+  while (budget > 0 && discoveryIndex < (int)(FIELD_COUNT + BUTTON_COUNT)) {
+    if (!publishDiscovery(discoveryIndex)) {
+      return;
+    }
+    discoveryIndex++;
+    budget--;
+  }
+
+  if (budget > 0 && (stateBacklog || millis() - lastStateCheck >= MQTT_STATE_INTERVAL_MS)) {
+    lastStateCheck = millis();
+    publishChangedFields(budget);
+  }
+}
+
+static void mqttClientTask(void* arg) {
+  for (;;) {
+    xSemaphoreTake(sessionMutex, portMAX_DELAY);
+    handleMqttSession();
+    xSemaphoreGive(sessionMutex);
+    vTaskDelay(pdMS_TO_TICKS(MQTT_TASK_INTERVAL_MS));
+  }
+}
+
+// ========== Public API ==========
+
+void setupMqttClient() {
+  MqttConfig config = getSettings().mqtt;
+
+  mqtt.setBufferSize(MQTT_BUFFER_SIZE);
+  mqtt.setKeepAlive(MQTT_KEEPALIVE_S);
+  mqtt.setSocketTimeout(MQTT_SOCKET_TIMEOUT_S);
+  mqtt.setCallback(onMessage);
+
+  pendingConfig = config;
+  applyConfig();
+
+  sessionMutex = xSemaphoreCreateMutex();
+  if (!sessionMutex) {
+    Serial.println("[MQTT] ERROR: Failed to create session mutex");
+    return;
+  }
+  if (xTaskCreate(mqttClientTask, "mqtt", MQTT_TASK_STACK, nullptr,
+                  MQTT_TASK_PRIORITY, &mqttTask) != pdPASS) {
+    Serial.println("[MQTT] ERROR: Failed to start MQTT task");
+    return;
+  }
+
+  Serial.println("[MQTT] Module initialized");
+  Serial.printf("[MQTT]   Enabled: %s\n", config.enabled ? "Yes" : "No");
+  Serial.printf("[MQTT]   Broker: %s:%u\n", config.host[0] ? config.host : "(not set)", config.port);
+  Serial.printf("[MQTT]   Base topic: %s\n", baseTopic);
+}
+
+MqttConfig getMqttConfig() {
+  portENTER_CRITICAL(&configMux);
+  MqttConfig config = configPending ? pendingConfig : activeConfig;
+  portEXIT_CRITICAL(&configMux);
+  return config;
+}
+
+void setMqttConfig(const MqttConfig& config) {
+  Settings& settings = beginSettingsUpdate();
+  settings.mqtt = config;
+  endSettingsUpdate(SETTINGS_MQTT);
+
+  portENTER_CRITICAL(&configMux);
+  pendingConfig = config;
+  configPending = true;
+  portEXIT_CRITICAL(&configMux);
+
+  Serial.printf("[MQTT] Settings updated (enabled: %s, broker: %s:%u)\n",
+                config.enabled ? "Yes" : "No", config.host, config.port);
+}
+
+bool isMqttEnabled() {
+  MqttConfig config = getMqttConfig();
+  return config.enabled && config.host[0] != '\0';
+}
+
+bool isMqttConnected() {
+  return sessionUp;
+}
+
+bool publishMqttMessage(const char* topic, const char* payload) {
+  // Connect attempts also hold the mutex; do not wait for those
+  if (!sessionUp || !sessionMutex) {
+    return false;
+  }
+  if (xSemaphoreTake(sessionMutex, pdMS_TO_TICKS(MQTT_PUBLISH_WAIT_MS)) != pdTRUE) {
+    return false;
+  }
+  bool ok = mqtt.connected() && mqtt.publish(topic, payload);
+  xSemaphoreGive(sessionMutex);
+
+  if (ok) {
+    metricsIncrement(METRIC_MQTT_PUBLISHED);
+  }
+  return ok;
+}
+
+const char* getMqttBaseTopic() {
+  return baseTopic;
+}
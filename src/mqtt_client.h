@@ -0,0 +1,60 @@
+/*
+ * MQTT Status Client
+ * Publishes printer and sensor state as retained per-field topics (only
+ * when a value changes), announces the entities via Home Assistant MQTT
+ * discovery and maps a command topic onto the printer controls. The
+ * MQTT notification sink publishes over the same session. Runs in its
+ * own task at loopTask priority, so a broker that is down (DNS and TCP
+ * connect can take seconds) never stalls the main loop.
+ */
+
+#ifndef MQTT_CLIENT_H
+#define MQTT_CLIENT_H
+
+#include <Arduino.h>
+
+// ========== MQTT Configuration ==========
+#define MQTT_DEFAULT_PORT 1883
+#define MQTT_KEEPALIVE_S 30
+#define MQTT_SOCKET_TIMEOUT_S 2          // Wait for CONNACK and other broker replies (not the TCP connect)
+#define MQTT_BUFFER_SIZE 1536            // Largest packet: a full notification digest as JSON
+#define MQTT_DISCOVERY_SIZE 576          // Largest discovery payload
+#define MQTT_PUBLISH_WAIT_MS 1000        // Other tasks wait this long for the session
+#define MQTT_TASK_STACK 6144
+#define MQTT_TASK_PRIORITY 1             // Same as loopTask and the notifier
+#define MQTT_TASK_INTERVAL_MS 50         // Pause between passes (command latency)
+#define MQTT_RECONNECT_MIN_MS 2000       // First reconnect delay, doubled up to the max
+#define MQTT_RECONNECT_MAX_MS 60000
+#define MQTT_STATE_INTERVAL_MS 500       // How often fields are compared
+#define MQTT_PUBLISH_BUDGET 4            // Publishes per pass (spreads discovery/initial state)
+#define MQTT_VALUE_SIZE 96               // Longest published value (filename) incl. terminator
+
+struct MqttConfig {
+  bool enabled;
+  char host[64];              // Broker host or IP
+  uint16_t port;
+  char user[32];              // Optional
+  char password[64];          // Optional
+  char baseTopic[64];         // Empty = "centauri/<device id>"
+  char discoveryPrefix[32];   // Empty = no Home Assistant discovery
+};
+
+// Load settings and start the MQTT task (call once during setup)
+void setupMqttClient();
+
+// Get/Set settings (saved to flash, applied on the task's next pass)
+MqttConfig getMqttConfig();
+void setMqttConfig(const MqttConfig& config);
+
+// Broker session state
+bool isMqttEnabled();     // Switched on and a broker is set
+bool isMqttConnected();
+
+// Publish on the status client's session from another task (not
+// retained); false if the session is down or stays busy
+bool publishMqttMessage(const char* topic, const char* payload);
+
+// Effective base topic
+const char* getMqttBaseTopic();
+
+#endif // MQTT_CLIENT_H
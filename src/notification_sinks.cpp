@@ -0,0 +1,306 @@
+/*
+ * Notification Sinks Implementation
+ *
+ * send() and poll() run in the notifier task only. Settings written from
+ * the web server are copied into the active configuration under a
+ * spinlock and picked up (with a reconnect) on the next send or poll.
+ */
+
+#include "notification_sinks.h"
+#include "notifier.h"
+#include "metrics.h"
+#include "config_manager.h"
+#include "settings_store.h"
+#include "heap_monitor.h"
+#include "mqtt_client.h"
+#include <WiFi.h>
+#include <WiFiClientSecure.h>
+#include <HTTPClient.h>
+#include <ArduinoJson.h>
+
+// Configuration shared with the web server
+static NotificationSinkConfig activeConfig;
+static volatile uint32_t configVersion = 0;
+static portMUX_TYPE configMux = portMUX_INITIALIZER_UNLOCKED;
+
+// Copy used by the notifier task
+static NotificationSinkConfig sinkConfig;
+
+// Returns true if the configuration changed since the calling sink last
+// applied it. Each sink passes its own version so every one of them
+// sees the change and drops its connection.
+static bool refreshConfig(uint32_t& appliedVersion) {
+  if (appliedVersion == configVersion) {
+    return false;
+  }
+  portENTER_CRITICAL(&configMux);
+  sinkConfig = activeConfig;
+  appliedVersion = configVersion;
+  portEXIT_CRITICAL(&configMux);
+  return true;
+}
+
+// ========== Persistent HTTP ==========
+
+// One keep-alive connection per backend. The plain or TLS client is
+// picked from the URL scheme; the connection is dropped when the URL
+// changes so it is never reused for another host.
+class PersistentHttp {
+public:
+  void configure() {
+    secureClient.setInsecure();  // On-prem servers usually run self-signed certificates
+    http.setReuse(true);
+    http.setConnectTimeout(SINK_HTTP_CONNECT_TIMEOUT);
+    http.setTimeout(SINK_HTTP_RESPONSE_TIMEOUT);
+  }
+
+  void close() {
+    http.end();
+    plainClient.stop();
+    secureClient.stop();
+  }
+
+  bool begin(const char* url) {
+    bool secure = strncmp(url, "https://", 8) == 0;
+    WiFiClient& client = secure ? (WiFiClient&)secureClient : plainClient;
+    return http.begin(client, url);
+  }
+
+  HTTPClient http;
+
+private:
+  WiFiClient plainClient;
+  WiFiClientSecure secureClient;
+};
+
+// Map an HTTP status to a delivery result (4xx except 408/429 is not retried)
+static NotifyResult httpResult(const char* sink, HTTPClient& http, int code) {
+  if (code >= 200 && code < 300) {
+    metricsIncrement(METRIC_SINK_SENT);
+    Serial.printf("[SINK] ✅ %s delivered (%d)\n", sink, code);
+    return NOTIFY_SENT;
+  }
+
+  metricsIncrement(METRIC_SINK_FAILED);
+  if (code <= 0) {
+    Serial.printf("[SINK] ❌ %s request failed: %s\n", sink, http.errorToString(code).c_str());
+    return NOTIFY_FAILED;
+  }
+
+  Serial.printf("[SINK] ❌ %s server returned %d\n", sink, code);
+  if (code >= 400 && code < 500 && code != 408 && code != 429) {
+    return NOTIFY_SKIPPED;
+  }
+  return NOTIFY_FAILED;
+}
+
+// ========== Webhook ==========
+
+// POSTs {"device", "priority", "uptime", "messages": [...]} as JSON
+class WebhookSink : public NotificationSink {
+public:
+  const char* name() const override { return "webhook"; }
+  bool isEnabled() const override { return activeConfig.webhookUrl[0] != '\0'; }
+
+  NotifyResult send(const char* const* messages, int count, NotificationPriority priority) override {
+    HEAP_TAG_SCOPE(HEAP_TAG_NOTIFY);
+    if (refreshConfig(appliedVersion)) {
+      connection.close();
+    }
+    if (sinkConfig.webhookUrl[0] == '\0') {
+      return NOTIFY_SKIPPED;
+    }
+
+    JsonDocument doc;
+    doc["device"] = getDeviceId();
+    doc["priority"] = notificationPriorityName(priority);
+    doc["uptime"] = millis() / 1000;
+    JsonArray list = doc["messages"].to<JsonArray>();
+    for (int i = 0; i < count; i++) {
+      list.add(messages[i]);
+    }
+    String body;
+    serializeJson(doc, body);
+
+    if (!connection.begin(sinkConfig.webhookUrl)) {
+      Serial.println("[SINK] ❌ webhook URL invalid");
+      return NOTIFY_SKIPPED;
+    }
+    connection.http.addHeader("Content-Type", "application/json");
+    int code = connection.http.POST(body);
+    NotifyResult result = httpResult(name(), connection.http, code);
+    connection.http.end();  // Keeps the socket open (setReuse)
+    return result;
+  }
+
+  void poll() override {
+    if (refreshConfig(appliedVersion)) {
+      connection.close();
+    }
+  }
+
+  PersistentHttp connection;
+
+private:
+  uint32_t appliedVersion = 0;
+};
+
+// ========== ntfy ==========
+
+// POSTs the batch as one text message to an ntfy topic URL
+class NtfySink : public NotificationSink {
+public:
+  const char* name() const override { return "ntfy"; }
+  bool isEnabled() const override { return activeConfig.ntfyUrl[0] != '\0'; }
+
+  NotifyResult send(const char* const* messages, int count, NotificationPriority priority) override {
+    HEAP_TAG_SCOPE(HEAP_TAG_NOTIFY);
+    if (refreshConfig(appliedVersion)) {
+      connection.close();
+    }
+    if (sinkConfig.ntfyUrl[0] == '\0') {
+      return NOTIFY_SKIPPED;
+    }
+
+    formatNotificationBatch(messages, count, text, sizeof(text));
+
+    if (!connection.begin(sinkConfig.ntfyUrl)) {
+      Serial.println("[SINK] ❌ ntfy URL invalid");
+      return NOTIFY_SKIPPED;
+    }
+    connection.http.addHeader("Content-Type", "text/plain; charset=utf-8");
+    connection.http.addHeader("Title", "Centauri Carbon Monitor");
+    connection.http.addHeader("Priority", ntfyPriority(priority));
+    if (priority == NOTIFY_PRIORITY_CRITICAL) {
+      connection.http.addHeader("Tags", "rotating_light");
+    }
+    if (sinkConfig.ntfyToken[0] != '\0') {
+      connection.http.addHeader("Authorization", String("Bearer ") + sinkConfig.ntfyToken);
+    }
+
+    int code = connection.http.POST((uint8_t*)text, strlen(text));
+    NotifyResult result = httpResult(name(), connection.http, code);
+    connection.http.end();
+    return result;
+  }
+
+  void poll() override {
+    if (refreshConfig(appliedVersion)) {
+      connection.close();
+    }
+  }
+
+  PersistentHttp connection;
+
+private:
+  static const char* ntfyPriority(NotificationPriority priority) {
+    switch (priority) {
+      case NOTIFY_PRIORITY_CRITICAL: return "urgent";
+      case NOTIFY_PRIORITY_NORMAL: return "default";
+      default: return "low";
+    }
+  }
+
+  char text[NOTIFY_DIGEST_SIZE + 64];
+  uint32_t appliedVersion = 0;
+};
+
+// ========== MQTT ==========
+
+// Publishes the batch as one JSON payload over the MQTT status client's
+// session (same broker, same settings). Active while that client is
+// enabled and a topic is set.
+class MqttSink : public NotificationSink {
+public:
+  const char* name() const override { return "mqtt"; }
+  bool isEnabled() const override { return activeConfig.mqttTopic[0] != '\0' && isMqttEnabled(); }
+
+  NotifyResult send(const char* const* messages, int count, NotificationPriority priority) override {
+    HEAP_TAG_SCOPE(HEAP_TAG_NOTIFY);
+    refreshConfig(appliedVersion);
+    if (sinkConfig.mqttTopic[0] == '\0' || !isMqttEnabled()) {
+      return NOTIFY_SKIPPED;
+    }
+
+    JsonDocument doc;
+    doc["device"] = getDeviceId();
+    doc["priority"] = notificationPriorityName(priority);
+    doc["uptime"] = millis() / 1000;
+    JsonArray list = doc["messages"].to<JsonArray>();
+    for (int i = 0; i < count; i++) {
+      list.add(messages[i]);
+    }
+    String payload;
+    serializeJson(doc, payload);
+
+    if (!publishMqttMessage(sinkConfig.mqttTopic, payload.c_str())) {
+      Serial.printf("[SINK] ❌ mqtt publish failed (%s)\n", isMqttConnected() ? "busy" : "not connected");
+      metricsIncrement(METRIC_SINK_FAILED);
+      return NOTIFY_FAILED;
+    }
+
+    metricsIncrement(METRIC_SINK_SENT);
+    Serial.printf("[SINK] ✅ mqtt published to %s\n", sinkConfig.mqttTopic);
+    return NOTIFY_SENT;
+  }
+
+private:
+  uint32_t appliedVersion = 0;
+};
+
+static WebhookSink webhookSink;
+static NtfySink ntfySink;
+static MqttSink mqttSink;
+
+void setupNotificationSinks() {
+  NotificationSinkConfig config = getSettings().sinks;
+
+  portENTER_CRITICAL(&configMux);
+  activeConfig = config;
+  configVersion = configVersion + 1;
+  portEXIT_CRITICAL(&configMux);
+
+  webhookSink.connection.configure();
+  ntfySink.connection.configure();
+
+  registerNotificationSink(&webhookSink);
+  registerNotificationSink(&ntfySink);
+  registerNotificationSink(&mqttSink);
+
+  Serial.println("[SINK] Notification sinks initialized");
+  Serial.printf("[SINK]   Webhook: %s\n", config.webhookUrl[0] ? config.webhookUrl : "(disabled)");
+  Serial.printf("[SINK]   ntfy: %s\n", config.ntfyUrl[0] ? config.ntfyUrl : "(disabled)");
+  Serial.printf("[SINK]   MQTT: %s\n", config.mqttTopic[0] ? config.mqttTopic : "(disabled)");
+}
+
+NotificationSinkConfig getNotificationSinkConfig() {
+  portENTER_CRITICAL(&configMux);
+  NotificationSinkConfig config = activeConfig;
+  portEXIT_CRITICAL(&configMux);
+  return config;
+}
+
+void setNotificationSinkConfig(const NotificationSinkConfig& config) {
+  Settings& settings = beginSettingsUpdate();
+  settings.sinks = config;
+  endSettingsUpdate(SETTINGS_NOTIFY);
+
+  portENTER_CRITICAL(&configMux);
+  activeConfig = config;
+  configVersion = configVersion + 1;
+  portEXIT_CRITICAL(&configMux);
+
+  Serial.println("[SINK] Settings updated");
+}
+
+bool isWebhookSinkEnabled() {
+  return webhookSink.isEnabled();
+}
+
+bool isNtfySinkEnabled() {
+  return ntfySink.isEnabled();
+}
+
+bool isMqttSinkEnabled() {
+  return mqttSink.isEnabled();
+}
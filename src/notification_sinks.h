@@ -0,0 +1,37 @@
+/*
+ * Notification Sinks
+ * Self-hosted notification backends: generic webhook (JSON POST),
+ * ntfy-compatible HTTP push and MQTT publish. The HTTP backends keep
+ * their connection open between batches; MQTT publishes over the
+ * session of the MQTT status client.
+ */
+
+#ifndef NOTIFICATION_SINKS_H
+#define NOTIFICATION_SINKS_H
+
+#include <Arduino.h>
+
+// ========== Sink Configuration ==========
+#define SINK_HTTP_CONNECT_TIMEOUT 3000   // ms, local servers answer fast
+#define SINK_HTTP_RESPONSE_TIMEOUT 5000  // ms
+
+struct NotificationSinkConfig {
+  char webhookUrl[128];    // http(s)://host[:port]/path - empty = disabled
+  char ntfyUrl[128];       // http(s)://host[:port]/topic - empty = disabled
+  char ntfyToken[64];      // Optional access token (Bearer)
+  char mqttTopic[64];      // Topic for notification payloads - empty = disabled
+};
+
+// Load settings and register the sinks with the dispatcher
+void setupNotificationSinks();
+
+// Get/Set sink settings (saved to flash, applied on the next delivery)
+NotificationSinkConfig getNotificationSinkConfig();
+void setNotificationSinkConfig(const NotificationSinkConfig& config);
+
+// Current enabled state per backend
+bool isWebhookSinkEnabled();
+bool isNtfySinkEnabled();
+bool isMqttSinkEnabled();
+
+#endif // NOTIFICATION_SINKS_H
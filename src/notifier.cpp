@@ -0,0 +1,511 @@
+/*
+ * Notification Dispatcher Implementation
+ */
+
+#include "notifier.h"
+#include "metrics.h"
+#include "trace.h"
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include <freertos/task.h>
+
+struct QueuedNotification {
+  uint8_t priority;
+  char text[NOTIFY_MESSAGE_SIZE];
+};
+
+static QueueHandle_t criticalQueue = nullptr;
+static QueueHandle_t eventQueue = nullptr;
+static TaskHandle_t notifyTask = nullptr;
+
+// Critical messages that arrived while the critical queue was full
+static uint32_t criticalCoalesced = 0;
+static portMUX_TYPE coalesceMux = portMUX_INITIALIZER_UNLOCKED;
+
+// Registered backends
+static NotificationSink* sinks[NOTIFY_MAX_SINKS];
+static int sinkCount = 0;
+
+// Alarms being delivered, oldest first (dispatcher task only). Every sink
+// works through them in order on its own retry schedule, so a failing
+// sink never holds up the others.
+struct CriticalSlot {
+  QueuedNotification item;
+  uint32_t pending;  // Sinks that still need the message
+};
+static CriticalSlot criticalSlots[NOTIFY_QUEUE_LENGTH];
+static int criticalHead = 0;
+static volatile int criticalCount = 0;
+
+// Per-sink critical retry state (dispatcher task only)
+static int sinkAttempts[NOTIFY_MAX_SINKS];
+static unsigned long sinkRetryMs[NOTIFY_MAX_SINKS];
+static uint32_t sinkMissed[NOTIFY_MAX_SINKS];  // Alarms given up before this sink had them
+
+// Pending digest (dispatcher task only). Messages are stored back to back
+// in digestText, each with its own terminator.
+static char digestText[NOTIFY_DIGEST_SIZE];
+static const char* digestMessages[NOTIFY_DIGEST_MESSAGES + 1];
+static char overflowNote[32];
+static size_t digestLength = 0;
+static volatile int digestCount = 0;
+static int digestStored = 0;
+static bool digestHasNormal = false;
+static unsigned long digestFirstMs = 0;
+static int digestAttempts = 0;
+static unsigned long digestFirstAttemptMs = 0;
+static unsigned long digestRetryMs = 0;
+static uint32_t digestPending = 0;  // Sinks that still need the digest
+
+// Cooldown tracking
+static bool sentOnce = false;
+static unsigned long lastSendMs = 0;
+
+static uint32_t allSinksMask() {
+  return sinkCount >= 32 ? 0xFFFFFFFFu : (1u << sinkCount) - 1;
+}
+
+static NotifyResult sendViaSink(int index, const char* const* messages, int count,
+                                NotificationPriority priority) {
+  TRACE_BEGIN(span, "notify", sinks[index]->name());
+  NotifyResult result = sinks[index]->send(messages, count, priority);
+  TRACE_END(span);
+  if (result == NOTIFY_FAILED) {
+    Serial.printf("[NOTIFY] ❌ Delivery via %s failed\n", sinks[index]->name());
+  }
+  return result;
+}
+
+// Hand a batch to every sink in the pending mask. Sinks that delivered
+// (or skipped on purpose) are removed from the mask. Returns true if any
+// sink actually sent the batch.
+static bool deliverToSinks(const char* const* messages, int count, NotificationPriority priority,
+                           uint32_t& pending) {
+  bool sent = false;
+
+  for (int i = 0; i < sinkCount; i++) {
+    uint32_t bit = 1u << i;
+    if (!(pending & bit)) {
+      continue;
+    }
+    if (!sinks[i]->isEnabled()) {
+      pending &= ~bit;
+      continue;
+    }
+
+    NotifyResult result = sendViaSink(i, messages, count, priority);
+    if (result == NOTIFY_FAILED) {
+      continue;
+    }
+    pending &= ~bit;
+    if (result == NOTIFY_SENT) {
+      sent = true;
+    }
+  }
+  return sent;
+}
+
+static void markSent() {
+  sentOnce = true;
+  lastSendMs = millis();
+}
+
+static CriticalSlot& criticalSlot(int n) {
+  return criticalSlots[(criticalHead + n) % NOTIFY_QUEUE_LENGTH];
+}
+
+static void appendAlarmNote(char* text, size_t size, uint32_t count) {
+  char note[40];
+  snprintf(note, sizeof(note), "\n\n(+%lu weitere Alarme)", (unsigned long)count);
+  size_t room = size - strlen(note) - 1;
+  size_t length = min(strlen(text), room);
+  memcpy(text + length, note, strlen(note) + 1);
+}
+
+// Move the next alarm from the queue into a free slot. Alarms coalesced
+// while the queue was full are noted on the last one queued before them.
+static bool takeCritical() {
+  if (criticalCount >= NOTIFY_QUEUE_LENGTH) {
+    return false;
+  }
+  CriticalSlot& slot = criticalSlot(criticalCount);
+  if (xQueueReceive(criticalQueue, &slot.item, 0) != pdTRUE) {
+    return false;
+  }
+
+  if (uxQueueMessagesWaiting(criticalQueue) == 0) {
+    portENTER_CRITICAL(&coalesceMux);
+    uint32_t coalesced = criticalCoalesced;
+    criticalCoalesced = 0;
+    portEXIT_CRITICAL(&coalesceMux);
+
+    if (coalesced > 0) {
+      appendAlarmNote(slot.item.text, sizeof(slot.item.text), coalesced);
+    }
+  }
+
+  slot.pending = allSinksMask();
+  criticalCount = criticalCount + 1;
+  return true;
+}
+
+// Every sink that is not waiting for a retry sends the alarms it still
+// needs, oldest first. A failure only puts that sink into backoff (capped
+// at NOTIFY_CRITICAL_RETRY_MAX_MS); it is never given up on while enabled.
+static void deliverCritical() {
+  for (int i = 0; i < sinkCount; i++) {
+    uint32_t bit = 1u << i;
+    if (!sinks[i]->isEnabled()) {
+      for (int n = 0; n < criticalCount; n++) {
+        criticalSlot(n).pending &= ~bit;
+      }
+      sinkAttempts[i] = 0;
+      sinkMissed[i] = 0;
+      continue;
+    }
+    if (sinkAttempts[i] > 0 && (long)(sinkRetryMs[i] - millis()) > 0) {
+      continue;
+    }
+
+    for (int n = 0; n < criticalCount; n++) {
+      CriticalSlot& slot = criticalSlot(n);
+      if (!(slot.pending & bit)) {
+        continue;
+      }
+
+      char text[NOTIFY_MESSAGE_SIZE];
+      const char* message = slot.item.text;
+      if (sinkMissed[i] > 0) {
+        memcpy(text, slot.item.text, sizeof(text));
+        appendAlarmNote(text, sizeof(text), sinkMissed[i]);
+        message = text;
+      }
+
+      NotifyResult result = sendViaSink(i, &message, 1, NOTIFY_PRIORITY_CRITICAL);
+      if (result == NOTIFY_FAILED) {
+        sinkAttempts[i]++;
+        unsigned long backoff = NOTIFY_CRITICAL_RETRY_MAX_MS;
+        if (sinkAttempts[i] < 16) {
+          backoff = min((unsigned long)NOTIFY_RETRY_BASE_MS << (sinkAttempts[i] - 1),
+                        (unsigned long)NOTIFY_CRITICAL_RETRY_MAX_MS);
+        }
+        Serial.printf("[NOTIFY] Critical attempt %d via %s failed, retrying in %lu ms\n",
+                      sinkAttempts[i], sinks[i]->name(), backoff);
+        metricsIncrement(METRIC_NOTIFY_RETRIES);
+        sinkRetryMs[i] = millis() + backoff;
+        break;
+      }
+
+      slot.pending &= ~bit;
+      sinkAttempts[i] = 0;
+      sinkMissed[i] = 0;
+      if (result == NOTIFY_SENT) {
+        markSent();
+      }
+    }
+  }
+}
+
+// Free the slots of alarms that every sink has
+static void releaseCritical() {
+  while (criticalCount > 0 && criticalSlot(0).pending == 0) {
+    criticalHead = (criticalHead + 1) % NOTIFY_QUEUE_LENGTH;
+    criticalCount = criticalCount - 1;
+  }
+}
+
+// All slots are held by sinks that keep failing and another alarm is
+// waiting: give up the oldest one for those sinks. They get a note on
+// their next alarm instead; the other sinks have delivered it already.
+static void evictCritical() {
+  const CriticalSlot& slot = criticalSlot(0);
+  for (int i = 0; i < sinkCount; i++) {
+    if (slot.pending & (1u << i)) {
+      sinkMissed[i]++;
+    }
+  }
+  Serial.println("[NOTIFY] Alarm backlog full, oldest alarm coalesced for failing sinks");
+  metricsIncrement(METRIC_NOTIFY_COALESCED);
+  criticalHead = (criticalHead + 1) % NOTIFY_QUEUE_LENGTH;
+  criticalCount = criticalCount - 1;
+}
+
+static void clearDigest() {
+  digestLength = 0;
+  digestCount = 0;
+  digestStored = 0;
+  digestHasNormal = false;
+  digestAttempts = 0;
+  digestPending = 0;
+}
+
+static void appendToDigest(const QueuedNotification& item) {
+  size_t length = strlen(item.text);
+
+  if (digestCount == 0) {
+    digestFirstMs = millis();
+  } else {
+    metricsIncrement(METRIC_NOTIFY_COALESCED);
+  }
+
+  if (digestStored < NOTIFY_DIGEST_MESSAGES && digestLength + length + 1 <= sizeof(digestText)) {
+    memcpy(digestText + digestLength, item.text, length + 1);
+    digestMessages[digestStored++] = digestText + digestLength;
+    digestLength += length + 1;
+  }
+  // Messages that did not fit are summarized as "+N weitere" when the digest is sent
+
+  digestCount = digestCount + 1;
+  if (item.priority == NOTIFY_PRIORITY_NORMAL) {
+    digestHasNormal = true;
+  }
+}
+
+// Time at which the pending digest may be sent
+static unsigned long digestDueMs() {
+  unsigned long due = digestFirstMs + (digestHasNormal ? NOTIFY_NORMAL_WINDOW_MS : NOTIFY_INFO_WINDOW_MS);
+
+  if (sentOnce && (long)(lastSendMs + NOTIFY_COOLDOWN_MS - due) > 0) {
+    due = lastSendMs + NOTIFY_COOLDOWN_MS;
+  }
+  if (digestAttempts > 0 && (long)(digestRetryMs - due) > 0) {
+    due = digestRetryMs;
+  }
+  return due;
+}
+
+static void sendDigest() {
+  int count = digestStored;
+  int overflow = digestCount - digestStored;
+  if (overflow > 0) {
+    snprintf(overflowNote, sizeof(overflowNote), "(+%d weitere)", overflow);
+    digestMessages[count++] = overflowNote;
+  }
+
+  unsigned long now = millis();
+  if (digestAttempts == 0) {
+    digestFirstAttemptMs = now;
+    digestPending = allSinksMask();
+  }
+
+  NotificationPriority priority = digestHasNormal ? NOTIFY_PRIORITY_NORMAL : NOTIFY_PRIORITY_INFO;
+  if (deliverToSinks(digestMessages, count, priority, digestPending)) {
+    markSent();
+  }
+
+  if (digestPending != 0) {
+    digestAttempts++;
+    unsigned long backoff = (unsigned long)NOTIFY_RETRY_BASE_MS << (digestAttempts - 1);
+
+    if (digestAttempts >= NOTIFY_MAX_ATTEMPTS || now - digestFirstAttemptMs + backoff > NOTIFY_TIME_BUDGET_MS) {
+      Serial.printf("[NOTIFY] ❌ Giving up on digest (%d messages) after %d attempts\n",
+                    digestCount, digestAttempts);
+      metricsIncrement(METRIC_NOTIFY_DROPPED);
+      clearDigest();
+      return;
+    }
+
+    Serial.printf("[NOTIFY] Digest attempt %d failed, retrying in %lu ms\n", digestAttempts, backoff);
+    metricsIncrement(METRIC_NOTIFY_RETRIES);
+    digestRetryMs = now + backoff;
+    return;
+  }
+
+  clearDigest();
+}
+
+static void pollSinks() {
+  for (int i = 0; i < sinkCount; i++) {
+    if (sinks[i]->isEnabled()) {
+      sinks[i]->poll();
+    }
+  }
+}
+
+static void notifierTask(void* arg) {
+  static QueuedNotification item;
+
+  for (;;) {
+    // Wake up at least every poll interval for sink keep-alives
+    long remaining = NOTIFY_POLL_INTERVAL_MS;
+    if (digestCount > 0) {
+      remaining = min(remaining, (long)(digestDueMs() - millis()));
+    }
+    if (criticalCount > 0) {
+      for (int i = 0; i < sinkCount; i++) {
+        if (sinkAttempts[i] > 0) {
+          remaining = min(remaining, (long)(sinkRetryMs[i] - millis()));
+        }
+      }
+    }
+    ulTaskNotifyTake(pdTRUE, remaining > 0 ? pdMS_TO_TICKS(remaining) : 0);
+
+    // Alarms first, in order per sink. Sinks in backoff keep their
+    // alarms; events keep being collected.
+    for (;;) {
+      while (takeCritical()) {
+      }
+      deliverCritical();
+      releaseCritical();
+      if (uxQueueMessagesWaiting(criticalQueue) == 0) {
+        break;
+      }
+      if (criticalCount == NOTIFY_QUEUE_LENGTH) {
+        evictCritical();
+      }
+    }
+
+    // Everything else is collected into the digest
+    while (xQueueReceive(eventQueue, &item, 0) == pdTRUE) {
+      appendToDigest(item);
+    }
+
+    if (digestCount > 0 && (long)(digestDueMs() - millis()) <= 0) {
+      sendDigest();
+    }
+
+    pollSinks();
+  }
+}
+
+void setupNotifier() {
+  criticalQueue = xQueueCreate(NOTIFY_QUEUE_LENGTH, sizeof(QueuedNotification));
+  eventQueue = xQueueCreate(NOTIFY_QUEUE_LENGTH, sizeof(QueuedNotification));
+  if (!criticalQueue || !eventQueue) {
+    Serial.println("[NOTIFY] ERROR: Failed to create notification queues");
+    return;
+  }
+
+  if (xTaskCreate(notifierTask, "notifier", NOTIFY_TASK_STACK, nullptr,
+                  NOTIFY_TASK_PRIORITY, &notifyTask) != pdPASS) {
+    Serial.println("[NOTIFY] ERROR: Failed to start notification task");
+    return;
+  }
+
+  Serial.printf("[NOTIFY] Dispatcher started (queue %d, cooldown %d s, digest window %d s)\n",
+                NOTIFY_QUEUE_LENGTH, NOTIFY_COOLDOWN_MS / 1000, NOTIFY_NORMAL_WINDOW_MS / 1000);
+  for (int i = 0; i < sinkCount; i++) {
+    Serial.printf("[NOTIFY]   Sink %s: %s\n", sinks[i]->name(), sinks[i]->isEnabled() ? "enabled" : "disabled");
+  }
+}
+
+bool registerNotificationSink(NotificationSink* sink) {
+  if (sinkCount >= NOTIFY_MAX_SINKS) {
+    Serial.printf("[NOTIFY] ERROR: Too many sinks, %s not registered\n", sink->name());
+    return false;
+  }
+  sinks[sinkCount++] = sink;
+  return true;
+}
+
+bool anyNotificationSinkEnabled() {
+  for (int i = 0; i < sinkCount; i++) {
+    if (sinks[i]->isEnabled()) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool queueNotification(const char* message, NotificationPriority priority) {
+  if (!anyNotificationSinkEnabled()) {
+    Serial.println("[NOTIFY] No notification backend enabled");
+    return false;
+  }
+
+  QueueHandle_t queue = (priority == NOTIFY_PRIORITY_CRITICAL) ? criticalQueue : eventQueue;
+  if (!queue || !notifyTask) {
+    return false;
+  }
+
+  QueuedNotification item;
+  item.priority = priority;
+  strncpy(item.text, message, sizeof(item.text) - 1);
+  item.text[sizeof(item.text) - 1] = '\0';
+
+  if (xQueueSend(queue, &item, 0) != pdTRUE) {
+    if (priority == NOTIFY_PRIORITY_CRITICAL) {
+      // Never evict an unsent alarm; the newest is counted and noted instead
+      portENTER_CRITICAL(&coalesceMux);
+      criticalCoalesced++;
+      portEXIT_CRITICAL(&coalesceMux);
+      metricsIncrement(METRIC_NOTIFY_COALESCED);
+      Serial.println("[NOTIFY] Critical queue full, alarm coalesced");
+      xTaskNotifyGive(notifyTask);
+      return true;
+    }
+
+    // Queue full: drop the oldest message, the newest is more relevant
+    QueuedNotification dropped;
+    xQueueReceive(queue, &dropped, 0);
+    metricsIncrement(METRIC_NOTIFY_DROPPED);
+    Serial.println("[NOTIFY] Queue full, dropped oldest message");
+
+    if (xQueueSend(queue, &item, 0) != pdTRUE) {
+      return false;
+    }
+  }
+
+  xTaskNotifyGive(notifyTask);
+  return true;
+}
+
+int getNotificationQueueDepth() {
+  if (!criticalQueue || !eventQueue) {
+    return 0;
+  }
+  return uxQueueMessagesWaiting(criticalQueue) + uxQueueMessagesWaiting(eventQueue) + digestCount +
+         criticalCount;
+}
+
+void formatNotificationBatch(const char* const* messages, int count, char* out, size_t outSize) {
+  size_t used = 0;
+  out[0] = '\0';
+
+  if (count > 1) {
+    int written = snprintf(out, outSize, "📋 %d Meldungen", count);
+    used = written > 0 ? min((size_t)written, outSize - 1) : 0;
+  }
+
+  for (int i = 0; i < count && used + 1 < outSize; i++) {
+    int written = snprintf(out + used, outSize - used, "%s%s", used > 0 ? "\n\n" : "", messages[i]);
+    used = written > 0 ? min(used + written, outSize - 1) : used;
+  }
+}
+
+const char* notificationPriorityName(NotificationPriority priority) {
+  switch (priority) {
+    case NOTIFY_PRIORITY_CRITICAL: return "critical";
+    case NOTIFY_PRIORITY_NORMAL: return "normal";
+    default: return "info";
+  }
+}
+
+// ========== Notification Types ==========
+
+void notifyFilamentError(const char* errorType) {
+  char message[200];
+  snprintf(message, sizeof(message),
+           "🚨 Centauri Carbon Alarm!\n\n%s erkannt!\n\nDruck wurde pausiert.",
+           errorType);
+  queueNotification(message, NOTIFY_PRIORITY_CRITICAL);
+}
+
+void notifyPrintComplete(const char* filename, unsigned long duration) {
+  char message[200];
+  unsigned long hours = duration / 3600000;
+  unsigned long minutes = (duration % 3600000) / 60000;
+
+  snprintf(message, sizeof(message),
+           "✅ Druck abgeschlossen!\n\nDatei: %s\nDauer: %luh %lumin",
+           filename, hours, minutes);
+  queueNotification(message);
+}
+
+void notifyPrintStarted(const char* filename) {
+  char message[200];
+  snprintf(message, sizeof(message),
+           "🖨️ Druck gestartet\n\nDatei: %s",
+           filename);
+  queueNotification(message, NOTIFY_PRIORITY_INFO);
+}
@@ -0,0 +1,97 @@
+/*
+ * Notification Dispatcher
+ * Bounded queues drained by a low-priority background task, so that
+ * slow network delivery never blocks the main loop. Critical messages
+ * are sent immediately and retried until delivered; normal and info
+ * messages are coalesced into digests that respect the cooldown instead
+ * of being dropped.
+ * Every message is fanned out to all registered notification sinks.
+ */
+
+#ifndef NOTIFIER_H
+#define NOTIFIER_H
+
+#include <Arduino.h>
+
+// ========== Dispatcher Configuration ==========
+#define NOTIFY_QUEUE_LENGTH 8          // Pending messages per queue (see queueNotification())
+#define NOTIFY_MESSAGE_SIZE 256        // Maximum message length incl. terminator
+#define NOTIFY_DIGEST_SIZE 1024        // Maximum digest length incl. terminator
+#define NOTIFY_DIGEST_MESSAGES 16      // Maximum messages per digest (rest is summarized)
+#define NOTIFY_MAX_SINKS 8             // Registered notification backends
+#define NOTIFY_POLL_INTERVAL_MS 5000   // Keep-alive interval for persistent sink connections
+#define NOTIFY_MAX_ATTEMPTS 4          // Delivery attempts per digest
+#define NOTIFY_RETRY_BASE_MS 2000      // First retry delay, doubled on each retry
+#define NOTIFY_TIME_BUDGET_MS 60000    // Give up on a digest after this long
+#define NOTIFY_CRITICAL_RETRY_MAX_MS 60000  // Longest delay between retries of a critical message (never given up)
+#define NOTIFY_COOLDOWN_MS 60000       // Minimum time between non-critical sends
+#define NOTIFY_NORMAL_WINDOW_MS 10000  // Collect events this long before sending a digest
+#define NOTIFY_INFO_WINDOW_MS 300000   // Info-only digests wait longer for company
+#define NOTIFY_TASK_STACK 8192         // TLS handshake needs a large stack
+#define NOTIFY_TASK_PRIORITY 1         // Same as loopTask, below all network tasks
+
+// Message priority
+enum NotificationPriority {
+  NOTIFY_PRIORITY_CRITICAL,  // Alarms: sent immediately, bypass cooldown, retried until delivered
+  NOTIFY_PRIORITY_NORMAL,    // Events: coalesced within NOTIFY_NORMAL_WINDOW_MS
+  NOTIFY_PRIORITY_INFO       // Chatter: coalesced within NOTIFY_INFO_WINDOW_MS
+};
+
+// Delivery result of a notification backend
+enum NotifyResult {
+  NOTIFY_SENT,      // Delivered
+  NOTIFY_SKIPPED,   // Not sent on purpose (disabled, not configured) - no retry
+  NOTIFY_FAILED     // Network or server error - retry later
+};
+
+// Notification backend. All methods except isEnabled() are only called
+// from the dispatcher task, so implementations may block and keep their
+// connection open between calls.
+class NotificationSink {
+public:
+  virtual ~NotificationSink() {}
+
+  // Short name for logs and the status API
+  virtual const char* name() const = 0;
+
+  // True if the backend is configured and switched on (called from any task)
+  virtual bool isEnabled() const = 0;
+
+  // Deliver a batch of messages in one request
+  virtual NotifyResult send(const char* const* messages, int count, NotificationPriority priority) = 0;
+
+  // Called every NOTIFY_POLL_INTERVAL_MS to keep the connection alive
+  virtual void poll() {}
+};
+
+// Create the queues and start the dispatcher task
+void setupNotifier();
+
+// Add a backend (call during setup, before the first message is queued)
+bool registerNotificationSink(NotificationSink* sink);
+
+// True if at least one registered backend is enabled
+bool anyNotificationSinkEnabled();
+
+// Queue a message for delivery (never blocks, safe from any task). When a
+// queue is full, normal and info messages drop the oldest queued one;
+// critical messages never evict an unsent alarm but are counted and
+// noted on the last queued alarm instead. A sink that keeps failing
+// while a full backlog waits only for it gets such a note as well.
+bool queueNotification(const char* message, NotificationPriority priority = NOTIFY_PRIORITY_NORMAL);
+
+// Number of messages waiting in the queues and the pending digest
+int getNotificationQueueDepth();
+
+// Join a batch into one text for backends that take a single message
+void formatNotificationBatch(const char* const* messages, int count, char* out, size_t outSize);
+
+// Lower-case priority name ("critical", "normal", "info")
+const char* notificationPriorityName(NotificationPriority priority);
+
+// Notification types
+void notifyFilamentError(const char* errorType);
+void notifyPrintComplete(const char* filename, unsigned long duration);
+void notifyPrintStarted(const char* filename);
+
+#endif // NOTIFIER_H
@@ -0,0 +1,244 @@
+/*
+ * OTA Health Gate Implementation
+ *
+ * Bootloader rollback (CONFIG_BOOTLOADER_APP_ROLLBACK_ENABLE): the new
+ * image boots in ESP_OTA_IMG_PENDING_VERIFY, a reset before it is marked
+ * valid makes the bootloader go back on its own. Without it the trial
+ * record counts boots, so a crash loop still ends after a few restarts.
+ *
+ * An update installed while the printer was off (or over the fallback
+ * access point) must not be rolled back for a check this environment
+ * cannot pass, so the trial record notes what was reachable at install
+ * time and only that is required.
+ */
+
+#include "ota_health.h"
+#include "ota_update.h"
+#include "settings_store.h"
+#include "wifi_manager.h"
+#include "websocket_client.h"
+#include "printer_status.h"
+#include "filament_sensor.h"
+#include <esp_ota_ops.h>
+
+static OTAHealthState healthState = OTA_HEALTH_VALID;
+static bool bootloaderRollback = false;
+static unsigned long trialStartMs = 0;
+
+// Checks required for this trial
+static bool requireWiFi = true;
+static bool requirePrinter = true;
+
+// Checks latch once they passed during the trial
+static bool wifiOk = false;
+static bool printerOk = false;
+static bool sensorOk = false;
+
+// The Arduino core marks a pending image valid right after boot unless
+// the sketch asks to verify it later - the gate below does that
+bool verifyRollbackLater() {
+  return true;
+}
+
+static void clearTrial(const char* rollbackReason) {
+  Settings& settings = beginSettingsUpdate();
+  settings.otaTrial.pending = false;
+  settings.otaTrial.boots = 0;
+  settings.otaTrial.rolledBack = rollbackReason != nullptr;
+  strlcpy(settings.otaTrial.rollbackReason, rollbackReason ? rollbackReason : "",
+          sizeof(settings.otaTrial.rollbackReason));
+  endSettingsUpdate(SETTINGS_OTA);
+}
+
+static void confirmImage() {
+  if (bootloaderRollback) {
+    esp_err_t err = esp_ota_mark_app_valid_cancel_rollback();
+    if (err != ESP_OK) {
+      Serial.printf("[OTA] WARNING: Marking the image valid failed: %s\n", esp_err_to_name(err));
+    }
+  }
+  if (getSettings().otaTrial.pending) {
+    clearTrial(nullptr);
+  }
+  healthState = OTA_HEALTH_VALID;
+  Serial.printf("[OTA] ✅ New image confirmed healthy after %lu ms\n",
+                (unsigned long)(millis() - trialStartMs));
+}
+
+static void rollBack(const char* reason) {
+  healthState = OTA_HEALTH_ROLLING_BACK;
+  Serial.printf("[OTA] ❌ New image failed the health gate (%s), rolling back\n", reason);
+
+  // Record the reason first - the previous image may report it
+  clearTrial(reason);
+
+  if (bootloaderRollback) {
+    esp_ota_mark_app_invalid_rollback_and_reboot();
+    // Only returns if there is no valid image to go back to
+    Serial.println("[OTA] ERROR: Bootloader rollback failed, keeping this image");
+    healthState = OTA_HEALTH_VALID;
+    return;
+  }
+
+  const esp_partition_t* previous = esp_partition_find_first(ESP_PARTITION_TYPE_APP, ESP_PARTITION_SUBTYPE_ANY,
+                                                             getSettings().otaTrial.previous);
+  if (!previous) {
+    previous = esp_ota_get_next_update_partition(NULL);
+  }
+  esp_err_t err = previous ? esp_ota_set_boot_partition(previous) : ESP_ERR_NOT_FOUND;
+  if (err != ESP_OK) {
+    Serial.printf("[OTA] ERROR: Rollback failed (%s), keeping this image\n", esp_err_to_name(err));
+    healthState = OTA_HEALTH_VALID;
+    return;
+  }
+
+  Serial.printf("[OTA] Rebooting into %s\n", previous->label);
+  delay(100);
+  ESP.restart();
+}
+
+void setupOTAHealthGate() {
+  const esp_partition_t* running = esp_ota_get_running_partition();
+  esp_ota_img_states_t imageState;
+  bootloaderRollback = running && esp_ota_get_state_partition(running, &imageState) == ESP_OK &&
+                       imageState == ESP_OTA_IMG_PENDING_VERIFY;
+
+  const OTATrial& trial = getSettings().otaTrial;
+  if (trial.rolledBack) {
+    Serial.printf("[OTA] Last update was rolled back: %s\n", trial.rollbackReason);
+  }
+
+  bool softwareTrial = trial.pending;
+  if (softwareTrial && running && strcmp(running->label, trial.previous) == 0) {
+    // The new image never started (or the bootloader already went back)
+    Serial.println("[OTA] Update did not boot, still running the previous image");
+    clearTrial("new image did not boot");
+    softwareTrial = false;
+  }
+
+  if (!bootloaderRollback && !softwareTrial) {
+    return;
+  }
+
+  healthState = OTA_HEALTH_PENDING;
+  trialStartMs = millis();
+
+  if (trial.pending) {
+    requireWiFi = trial.requireWiFi;
+    requirePrinter = trial.requirePrinter;
+  } else {
+    // Pending image without a trial record (not installed through
+    // finishOTAUpdate): nothing is known about the printer
+    requireWiFi = getSettings().system.configured;
+    requirePrinter = false;
+  }
+  Serial.printf("[OTA] Health checks: WiFi %s, printer %s, sensor required\n",
+                requireWiFi ? "required" : "skipped", requirePrinter ? "required" : "skipped");
+
+  if (softwareTrial) {
+    Settings& settings = beginSettingsUpdate();
+    uint8_t boots = ++settings.otaTrial.boots;
+    endSettingsUpdate(SETTINGS_OTA);
+
+    if (boots > OTA_HEALTH_MAX_BOOTS && !bootloaderRollback) {
+      rollBack("restarted before becoming healthy");
+      return;
+    }
+    Serial.printf("[OTA] New image on trial (boot %u of %d), budget %lu s\n",
+                  boots, OTA_HEALTH_MAX_BOOTS, (unsigned long)(OTA_HEALTH_BUDGET_MS / 1000));
+  } else {
+    Serial.printf("[OTA] New image pending verification, budget %lu s\n",
+                  (unsigned long)(OTA_HEALTH_BUDGET_MS / 1000));
+  }
+}
+
+void handleOTAHealthGate() {
+  if (healthState != OTA_HEALTH_PENDING) {
+    return;
+  }
+
+  wifiOk = wifiOk || isWiFiConnected();
+  printerOk = printerOk || (isWebSocketConnected() && printerStatus.currentStatus >= 0);
+  sensorOk = sensorOk || isFilamentSensorArmed();
+
+  bool wifiPassed = wifiOk || !requireWiFi;
+  bool printerPassed = printerOk || !requirePrinter;
+  if (wifiPassed && printerPassed && sensorOk) {
+    confirmImage();
+    return;
+  }
+
+  // Never pull the image from under a running upload (e.g. a fixed build)
+  if (millis() - trialStartMs < OTA_HEALTH_BUDGET_MS || isOTAUploadActive()) {
+    return;
+  }
+
+  rollBack(!wifiPassed ? "WiFi not connected" : !printerPassed ? "printer not reachable" : "filament sensor not armed");
+}
+
+void beginOTATrial() {
+  const esp_partition_t* running = esp_ota_get_running_partition();
+
+  // Read before taking the settings lock (driver calls)
+  bool wifiUp = isWiFiConnected();
+  bool printerUp = isWebSocketConnected() && printerStatus.currentStatus >= 0;
+
+  Settings& settings = beginSettingsUpdate();
+  settings.otaTrial.pending = true;
+  settings.otaTrial.boots = 0;
+  strlcpy(settings.otaTrial.previous, running ? running->label : "", sizeof(settings.otaTrial.previous));
+  settings.otaTrial.rolledBack = false;
+  settings.otaTrial.rollbackReason[0] = '\0';
+  settings.otaTrial.requireWiFi = wifiUp;
+  settings.otaTrial.requirePrinter = printerUp;
+  endSettingsUpdate(SETTINGS_OTA);
+}
+
+OTAHealthState getOTAHealthState() {
+  return healthState;
+}
+
+const char* getOTAHealthStateName() {
+  switch (healthState) {
+    case OTA_HEALTH_VALID: return "valid";
+    case OTA_HEALTH_PENDING: return "pending";
+    case OTA_HEALTH_ROLLING_BACK: return "rollingBack";
+  }
+  return "unknown";
+}
+
+bool isOTAHealthBootloaderRollback() {
+  return bootloaderRollback;
+}
+
+uint32_t getOTAHealthRemainingMs() {
+  if (healthState != OTA_HEALTH_PENDING) {
+    return 0;
+  }
+  unsigned long elapsed = millis() - trialStartMs;
+  return elapsed < OTA_HEALTH_BUDGET_MS ? OTA_HEALTH_BUDGET_MS - elapsed : 0;
+}
+
+bool isOTAHealthWiFiOk() {
+  return wifiOk;
+}
+
+bool isOTAHealthPrinterOk() {
+  return printerOk;
+}
+
+bool isOTAHealthSensorOk() {
+  return sensorOk;
+}
+
+bool isOTAHealthWiFiRequired() {
+  return requireWiFi;
+}
+
+bool isOTAHealthPrinterRequired() {
+  return requirePrinter;
+}
+
+const char* getOTALastRollbackReason() {
+  return getSettings().otaTrial.rolledBack ? getSettings().otaTrial.rollbackReason : "";
+}
@@ -0,0 +1,67 @@
+/*
+ * OTA Health Gate
+ * A freshly installed image is on trial until WiFi, the printer WebSocket
+ * and the filament sensor have all been confirmed within a time budget;
+ * otherwise the previous image is booted again. WiFi and printer are only
+ * required if they were reachable when the image was installed. Uses the bootloader's
+ * app rollback when it is enabled (pending-verify state), else a trial
+ * record in the settings store that also catches crash loops.
+ */
+
+#ifndef OTA_HEALTH_H
+#define OTA_HEALTH_H
+
+#include <Arduino.h>
+
+// ========== OTA Health Gate Configuration ==========
+#define OTA_HEALTH_BUDGET_MS 180000   // New image must be healthy within this time
+#define OTA_HEALTH_MAX_BOOTS 3        // Boots on trial without confirmation before rolling back
+
+enum OTAHealthState {
+  OTA_HEALTH_VALID,         // Running image is trusted
+  OTA_HEALTH_PENDING,       // New image on trial
+  OTA_HEALTH_ROLLING_BACK
+};
+
+// Trial record (persisted in the settings store)
+struct OTATrial {
+  bool pending;
+  uint8_t boots;                  // Boots of the new image so far
+  char previous[17];              // Partition label to go back to
+  bool rolledBack;                // Last trial ended with a rollback
+  char rollbackReason[40];
+  bool requireWiFi;               // Station link was up at install time
+  bool requirePrinter;            // Printer was reachable at install time
+};
+
+// Check the running image (call in setup() right after the settings store)
+void setupOTAHealthGate();
+
+// Confirm the image once healthy or roll back after the budget (call every loop)
+void handleOTAHealthGate();
+
+// Put the image just written on trial (called by finishOTAUpdate)
+void beginOTATrial();
+
+OTAHealthState getOTAHealthState();
+const char* getOTAHealthStateName();
+
+// True if the bootloader's rollback protects the trial (else software trial)
+bool isOTAHealthBootloaderRollback();
+
+// Milliseconds until the trial budget runs out (0 when not pending)
+uint32_t getOTAHealthRemainingMs();
+
+// Individual checks of the running trial
+bool isOTAHealthWiFiOk();
+bool isOTAHealthPrinterOk();
+bool isOTAHealthSensorOk();
+
+// Checks the running trial has to pass (the sensor is always required)
+bool isOTAHealthWiFiRequired();
+bool isOTAHealthPrinterRequired();
+
+// Reason of the last rollback ("" if none)
+const char* getOTALastRollbackReason();
+
+#endif // OTA_HEALTH_H
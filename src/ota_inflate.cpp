@@ -0,0 +1,233 @@
+/*
+ * OTA Gzip Inflater Implementation
+ *
+ * The gzip container (RFC 1952) is parsed byte by byte so chunks may be
+ * split anywhere; the raw deflate stream in between goes to the ROM
+ * tinfl with a wrapping 32 KB output window. The CRC32 and size from
+ * the trailer are checked against the inflated output.
+ */
+
+#include "ota_inflate.h"
+#include <rom/miniz.h>
+#include <esp_rom_crc.h>
+
+// gzip header flags
+#define GZIP_FHCRC 0x02
+#define GZIP_FEXTRA 0x04
+#define GZIP_FNAME 0x08
+#define GZIP_FCOMMENT 0x10
+
+enum InflateState {
+  INFLATE_HEADER,      // 10 fixed header bytes
+  INFLATE_EXTRA_LEN,
+  INFLATE_EXTRA,
+  INFLATE_NAME,
+  INFLATE_COMMENT,
+  INFLATE_HEADER_CRC,
+  INFLATE_DEFLATE,
+  INFLATE_TRAILER,     // CRC32 + ISIZE, little endian
+  INFLATE_DONE,
+  INFLATE_ERROR
+};
+
+static tinfl_decompressor* decompressor = nullptr;
+static uint8_t* window = nullptr;
+static size_t windowPos = 0;
+static OtaInflateSink outputSink = nullptr;
+
+static InflateState state = INFLATE_HEADER;
+static uint8_t headerBuf[10];
+static uint8_t flags = 0;
+static size_t fieldPos = 0;
+static size_t extraLen = 0;
+static uint8_t trailer[8];
+
+static uint32_t outputCrc = 0;
+static uint32_t outputSize = 0;
+static const char* lastError = "";
+
+static void fail(const char* reason) {
+  lastError = reason;
+  state = INFLATE_ERROR;
+}
+
+// Continue after the fixed header or an optional field
+static void nextHeaderField(InflateState after) {
+  fieldPos = 0;
+  if (after < INFLATE_EXTRA_LEN && (flags & GZIP_FEXTRA)) {
+    state = INFLATE_EXTRA_LEN;
+  } else if (after < INFLATE_NAME && (flags & GZIP_FNAME)) {
+    state = INFLATE_NAME;
+  } else if (after < INFLATE_COMMENT && (flags & GZIP_FCOMMENT)) {
+    state = INFLATE_COMMENT;
+  } else if (after < INFLATE_HEADER_CRC && (flags & GZIP_FHCRC)) {
+    state = INFLATE_HEADER_CRC;
+  } else {
+    tinfl_init(decompressor);
+    state = INFLATE_DEFLATE;
+  }
+}
+
+// Consume one header or trailer byte
+static void parseByte(uint8_t byte) {
+  switch (state) {
+    case INFLATE_HEADER:
+      headerBuf[fieldPos++] = byte;
+      if (fieldPos == sizeof(headerBuf)) {
+        if (headerBuf[0] != 0x1F || headerBuf[1] != 0x8B || headerBuf[2] != 8) {
+          fail("Not a gzip/deflate image");
+          return;
+        }
+        flags = headerBuf[3];
+        nextHeaderField(INFLATE_HEADER);
+      }
+      break;
+
+    case INFLATE_EXTRA_LEN:
+      extraLen |= (size_t)byte << (8 * fieldPos++);
+      if (fieldPos == 2) {
+        if (extraLen > 0) {
+          fieldPos = 0;
+          state = INFLATE_EXTRA;
+        } else {
+          nextHeaderField(INFLATE_EXTRA);
+        }
+      }
+      break;
+
+    case INFLATE_EXTRA:
+      if (++fieldPos == extraLen) {
+        nextHeaderField(INFLATE_EXTRA);
+      }
+      break;
+
+    case INFLATE_NAME:
+    case INFLATE_COMMENT:
+      if (byte == 0) {
+        nextHeaderField(state);
+      }
+      break;
+
+    case INFLATE_HEADER_CRC:
+      if (++fieldPos == 2) {
+        nextHeaderField(INFLATE_HEADER_CRC);
+      }
+      break;
+
+    case INFLATE_TRAILER:
+      trailer[fieldPos++] = byte;
+      if (fieldPos == sizeof(trailer)) {
+        uint32_t crc = trailer[0] | (trailer[1] << 8) | (trailer[2] << 16) | ((uint32_t)trailer[3] << 24);
+        uint32_t size = trailer[4] | (trailer[5] << 8) | (trailer[6] << 16) | ((uint32_t)trailer[7] << 24);
+        if (crc != outputCrc) {
+          fail("gzip CRC32 mismatch");
+        } else if (size != outputSize) {
+          fail("gzip size mismatch");
+        } else {
+          state = INFLATE_DONE;
+        }
+      }
+      break;
+
+    case INFLATE_DONE:
+      fail("Data after the end of the gzip stream");
+      break;
+
+    default:
+      break;
+  }
+}
+
+// Run the deflate stream; returns the number of input bytes consumed
+static size_t inflateBytes(const uint8_t* data, size_t len) {
+  size_t consumed = 0;
+
+  while (state == INFLATE_DEFLATE) {
+    size_t inBytes = len - consumed;
+    size_t outBytes = OTA_INFLATE_WINDOW_SIZE - windowPos;
+    tinfl_status status = tinfl_decompress(decompressor, data + consumed, &inBytes,
+                                           window, window + windowPos, &outBytes,
+                                           TINFL_FLAG_HAS_MORE_INPUT);
+    consumed += inBytes;
+
+    if (outBytes > 0) {
+      outputCrc = esp_rom_crc32_le(outputCrc, window + windowPos, outBytes);
+      outputSize += outBytes;
+      if (!outputSink(window + windowPos, outBytes)) {
+        fail("Writing inflated data failed");
+        break;
+      }
+      windowPos = (windowPos + outBytes) & (OTA_INFLATE_WINDOW_SIZE - 1);
+    }
+
+    if (status < TINFL_STATUS_DONE) {
+      fail("Corrupt deflate stream");
+    } else if (status == TINFL_STATUS_DONE) {
+      fieldPos = 0;
+      state = INFLATE_TRAILER;
+    } else if (status == TINFL_STATUS_NEEDS_MORE_INPUT && consumed == len) {
+      break;
+    }
+    // TINFL_STATUS_HAS_MORE_OUTPUT: window full, loop to flush the next part
+  }
+
+  return consumed;
+}
+
+bool isGzipData(const uint8_t* data, size_t len) {
+  return len >= 2 && data[0] == 0x1F && data[1] == 0x8B;
+}
+
+bool otaInflateBegin(OtaInflateSink sink) {
+  otaInflateEnd();
+
+  decompressor = (tinfl_decompressor*)malloc(sizeof(tinfl_decompressor));
+  window = (uint8_t*)malloc(OTA_INFLATE_WINDOW_SIZE);
+  if (!decompressor || !window) {
+    otaInflateEnd();
+    lastError = "Not enough memory for the inflater";
+    return false;
+  }
+
+  outputSink = sink;
+  windowPos = 0;
+  state = INFLATE_HEADER;
+  flags = 0;
+  fieldPos = 0;
+  extraLen = 0;
+  outputCrc = 0;
+  outputSize = 0;
+  lastError = "";
+  return true;
+}
+
+bool otaInflateWrite(const uint8_t* data, size_t len) {
+  size_t pos = 0;
+  while (pos < len && state != INFLATE_ERROR) {
+    if (state == INFLATE_DEFLATE) {
+      pos += inflateBytes(data + pos, len - pos);
+    } else {
+      parseByte(data[pos++]);
+    }
+  }
+  return state != INFLATE_ERROR;
+}
+
+bool otaInflateFinished() {
+  return state == INFLATE_DONE;
+}
+
+void otaInflateEnd() {
+  free(decompressor);
+  free(window);
+  decompressor = nullptr;
+  window = nullptr;
+}
+
+uint32_t getOtaInflatedSize() {
+  return outputSize;
+}
+
+const char* getOtaInflateError() {
+  return lastError;
+}
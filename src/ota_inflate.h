@@ -0,0 +1,40 @@
+/*
+ * OTA Gzip Inflater
+ * Streaming gzip decompression for compressed OTA images, using the
+ * tinfl inflater in the chip ROM. Output is handed to a sink in pieces
+ * as it is produced; only a fixed dictionary window is kept in RAM.
+ */
+
+#ifndef OTA_INFLATE_H
+#define OTA_INFLATE_H
+
+#include <Arduino.h>
+
+// Deflate window (gzip always allows 32 KB back-references)
+#define OTA_INFLATE_WINDOW_SIZE 32768
+
+// Receives inflated data; return false to abort
+typedef bool (*OtaInflateSink)(const uint8_t* data, size_t len);
+
+// True if the data starts with the gzip magic (firmware images start with 0xE9)
+bool isGzipData(const uint8_t* data, size_t len);
+
+// Allocate the inflater (window + decompressor state)
+bool otaInflateBegin(OtaInflateSink sink);
+
+// Feed compressed bytes (gzip header, deflate stream and trailer in any split)
+bool otaInflateWrite(const uint8_t* data, size_t len);
+
+// True once the deflate stream ended and the trailer (CRC32, size) matched
+bool otaInflateFinished();
+
+// Free the inflater
+void otaInflateEnd();
+
+// Inflated bytes so far
+uint32_t getOtaInflatedSize();
+
+// Reason of the last failure
+const char* getOtaInflateError();
+
+#endif // OTA_INFLATE_H
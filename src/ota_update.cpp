@@ -4,6 +4,14 @@
 
 #include "ota_update.h"
 #include <esp_ota_ops.h>
+#include <mbedtls/sha256.h>
+#include "ota_inflate.h"
+#include "ota_health.h"
+#include "config.h"
+
+// Version marker in the image, found by tools/fleet_update.py before uploading
+#define FIRMWARE_VERSION_TAG "CCMON_VERSION="
+static const char firmwareVersionTag[] = FIRMWARE_VERSION_TAG FIRMWARE_VERSION;
 
 // OTA state
 static OTAStatus otaStatus = OTA_IDLE;
@@ -11,10 +19,75 @@ static int otaProgress = 0;
 static String otaError = "";
 static size_t totalSize = 0;
 static size_t writtenSize = 0;
+static bool totalSizeKnown = false;
+static unsigned long lastChunkMs = 0;
+static bool compressed = false;      // gzip image, inflated into the partition
+
+// Incremental image digest
+static mbedtls_sha256_context shaContext;
+static bool shaActive = false;
+static bool shaExpected = false;
+static uint8_t expectedDigest[32];
+static char imageDigestHex[OTA_SHA256_HEX_LEN + 1] = "";
+
+// Parse 64 hex characters into 32 bytes
+static bool parseSha256(const char* hex, uint8_t* digest) {
+  if (!hex || strlen(hex) != OTA_SHA256_HEX_LEN) {
+    return false;
+  }
+  for (int i = 0; i < 32; i++) {
+    char byte[3] = { hex[i * 2], hex[i * 2 + 1], '\0' };
+    char* end;
+    digest[i] = (uint8_t)strtoul(byte, &end, 16);
+    if (*end != '\0') {
+      return false;
+    }
+  }
+  return true;
+}
+
+static void stopSha() {
+  if (shaActive) {
+    mbedtls_sha256_free(&shaContext);
+    shaActive = false;
+  }
+}
+
+// Drop the digest, the inflater and the partially written partition
+static void releaseUpdate() {
+  stopSha();
+  otaInflateEnd();
+  Update.abort();
+}
+
+static bool writeFlash(const uint8_t* data, size_t len) {
+  return Update.write((uint8_t*)data, len) == len;
+}
+
+// Start writing the partition once the first bytes show the image type
+static bool beginFlash(const uint8_t* data, size_t len) {
+  compressed = isGzipData(data, len);
+  if (compressed && !otaInflateBegin(writeFlash)) {
+    otaError = getOtaInflateError();
+    return false;
+  }
+
+  // The inflated size is only known at the end of a compressed image
+  if (!Update.begin(compressed ? UPDATE_SIZE_UNKNOWN : totalSize, U_FLASH)) {
+    otaError = "Update.begin failed: " + String(Update.errorString());
+    return false;
+  }
+
+  if (compressed) {
+    Serial.println("[OTA] gzip image, inflating into the update partition");
+  }
+  return true;
+}
 
 void setupOTA() {
   // Nothing needed for initialization
   Serial.println("[OTA] OTA update system initialized");
+  Serial.printf("[OTA] Firmware version %s\n", getFirmwareVersion());
 
   // Print current partition info
   const esp_partition_t* running = esp_ota_get_running_partition();
@@ -42,13 +115,24 @@ String getOTAError() {
   return otaError;
 }
 
-bool startOTAUpdate(size_t firmwareSize) {
+bool startOTAUpdate(size_t firmwareSize, bool sizeKnown, const char* expectedSha256) {
   if (otaStatus == OTA_UPDATING) {
-    otaError = "Update already in progress";
+    if (isOTAUploadActive()) {
+      otaError = "Update already in progress, resume at offset " + String(writtenSize);
+      return false;
+    }
+    expireOTAUpdate();
+  }
+
+  uint8_t digest[32];
+  bool hasDigest = expectedSha256 && expectedSha256[0] != '\0';
+  if (hasDigest && !parseSha256(expectedSha256, digest)) {
+    otaError = "Invalid sha256 (expected 64 hex characters)";
     return false;
   }
 
-  Serial.printf("[OTA] Starting update, firmware size: %d bytes\n", firmwareSize);
+  Serial.printf("[OTA] Starting update, firmware size: %u bytes%s%s\n", (unsigned)firmwareSize,
+                sizeKnown ? "" : " (upload size)", hasDigest ? ", SHA-256 verified" : "");
 
   // Check partition size
   const esp_partition_t* partition = esp_ota_get_next_update_partition(NULL);
@@ -60,19 +144,27 @@ bool startOTAUpdate(size_t firmwareSize) {
 
   if (firmwareSize > partition->size) {
     otaError = "Firmware too large for partition";
-    Serial.printf("[OTA] ERROR: Firmware size %d exceeds partition size %d\n", firmwareSize, partition->size);
+    Serial.printf("[OTA] ERROR: Firmware size %u exceeds partition size %lu\n",
+                  (unsigned)firmwareSize, (unsigned long)partition->size);
     return false;
   }
 
-  // Start update
-  if (!Update.begin(firmwareSize, U_FLASH)) {
-    otaError = "Update.begin failed: " + String(Update.errorString());
-    Serial.printf("[OTA] ERROR: Update.begin failed: %s\n", Update.errorString());
-    return false;
+  // The partition is opened with the first chunk (plain or gzip image)
+  releaseUpdate();
+  mbedtls_sha256_init(&shaContext);
+  mbedtls_sha256_starts(&shaContext, 0);
+  shaActive = true;
+  shaExpected = hasDigest;
+  if (hasDigest) {
+    memcpy(expectedDigest, digest, sizeof(expectedDigest));
   }
+  imageDigestHex[0] = '\0';
 
   totalSize = firmwareSize;
+  totalSizeKnown = sizeKnown;
+  compressed = false;
   writtenSize = 0;
+  lastChunkMs = millis();
   otaProgress = 0;
   otaStatus = OTA_UPDATING;
   otaError = "";
@@ -81,41 +173,111 @@ bool startOTAUpdate(size_t firmwareSize) {
   return true;
 }
 
+bool resumeOTAUpdate(size_t offset, const char* expectedSha256) {
+  if (otaStatus != OTA_UPDATING) {
+    otaError = "No interrupted update to resume";
+    return false;
+  }
+
+  if (offset != writtenSize) {
+    otaError = "Resume offset mismatch, expected " + String(writtenSize);
+    return false;
+  }
+
+  // The digest (if any) identifies the image - never mix two images
+  uint8_t digest[32];
+  bool hasDigest = expectedSha256 && expectedSha256[0] != '\0';
+  if (hasDigest != shaExpected ||
+      (hasDigest && (!parseSha256(expectedSha256, digest) || memcmp(digest, expectedDigest, sizeof(digest)) != 0))) {
+    otaError = "Resume sha256 does not match the interrupted update";
+    return false;
+  }
+
+  lastChunkMs = millis();
+  Serial.printf("[OTA] Resuming update at %u / %u bytes\n", (unsigned)writtenSize, (unsigned)totalSize);
+  return true;
+}
+
 bool writeOTAChunk(uint8_t* data, size_t len) {
   if (otaStatus != OTA_UPDATING) {
     otaError = "Update not started";
     return false;
   }
 
-  size_t written = Update.write(data, len);
-  if (written != len) {
-    otaError = "Write failed: " + String(Update.errorString());
-    Serial.printf("[OTA] ERROR: Write failed, expected %d, wrote %d: %s\n",
-                  len, written, Update.errorString());
+  if (totalSizeKnown && writtenSize + len > totalSize) {
+    otaError = "More data than the announced firmware size";
+    Serial.println("[OTA] ERROR: Upload exceeds announced size");
     otaStatus = OTA_ERROR;
-    Update.abort();
+    releaseUpdate();
     return false;
   }
 
-  writtenSize += written;
-  otaProgress = (writtenSize * 100) / totalSize;
+  if (writtenSize == 0 && !beginFlash(data, len)) {
+    Serial.printf("[OTA] ERROR: %s\n", otaError.c_str());
+    otaStatus = OTA_ERROR;
+    releaseUpdate();
+    return false;
+  }
 
-  // Print progress every 10%
-  static int lastProgress = 0;
-  if (otaProgress >= lastProgress + 10) {
-    Serial.printf("[OTA] Progress: %d%% (%d / %d bytes)\n", otaProgress, writtenSize, totalSize);
-    lastProgress = otaProgress;
+  bool written = compressed ? otaInflateWrite(data, len) : writeFlash(data, len);
+  if (!written) {
+    otaError = "Write failed: ";
+    if (compressed) {
+      otaError += String(getOtaInflateError()) + ", ";
+    }
+    otaError += Update.errorString();
+    Serial.printf("[OTA] ERROR: %s at %u bytes\n", otaError.c_str(), (unsigned)writtenSize);
+    otaStatus = OTA_ERROR;
+    releaseUpdate();
+    return false;
   }
 
+  mbedtls_sha256_update(&shaContext, data, len);
+  writtenSize += len;
+  lastChunkMs = millis();
+  otaProgress = totalSize > 0 ? (int)((uint64_t)writtenSize * 100 / totalSize) : 0;
+
   return true;
 }
 
+bool isOTAImageComplete() {
+  return otaStatus == OTA_UPDATING && totalSizeKnown && writtenSize == totalSize;
+}
+
 bool finishOTAUpdate() {
   if (otaStatus != OTA_UPDATING) {
     otaError = "Update not in progress";
     return false;
   }
 
+  uint8_t digest[32];
+  mbedtls_sha256_finish(&shaContext, digest);
+  stopSha();
+  for (int i = 0; i < 32; i++) {
+    snprintf(imageDigestHex + i * 2, 3, "%02x", digest[i]);
+  }
+
+  if (shaExpected && memcmp(digest, expectedDigest, sizeof(digest)) != 0) {
+    otaError = "SHA-256 mismatch, image rejected";
+    Serial.printf("[OTA] ERROR: SHA-256 mismatch (got %s)\n", imageDigestHex);
+    otaStatus = OTA_ERROR;
+    releaseUpdate();
+    return false;
+  }
+
+  if (compressed) {
+    if (!otaInflateFinished()) {
+      otaError = "Compressed image incomplete or corrupt";
+      Serial.printf("[OTA] ERROR: %s (%s)\n", otaError.c_str(), getOtaInflateError());
+      otaStatus = OTA_ERROR;
+      releaseUpdate();
+      return false;
+    }
+    Serial.printf("[OTA] Inflated %u bytes to %lu bytes\n", (unsigned)writtenSize,
+                  (unsigned long)getOtaInflatedSize());
+    otaInflateEnd();
+  }
+
   if (!Update.end(true)) {
     otaError = "Update.end failed: " + String(Update.errorString());
     Serial.printf("[OTA] ERROR: Update.end failed: %s\n", Update.errorString());
@@ -123,9 +285,13 @@ bool finishOTAUpdate() {
     return false;
   }
 
+  // The new image has to pass the health gate after the reboot
+  beginOTATrial();
+
   otaProgress = 100;
   otaStatus = OTA_SUCCESS;
-  Serial.println("[OTA] Update completed successfully!");
+  Serial.printf("[OTA] Update completed successfully! %u bytes, SHA-256 %s%s\n",
+                (unsigned)writtenSize, imageDigestHex, shaExpected ? " (verified)" : "");
   Serial.println("[OTA] Rebooting in 2 seconds...");
 
   return true;
@@ -133,7 +299,7 @@ bool finishOTAUpdate() {
 
 void abortOTAUpdate() {
   if (otaStatus == OTA_UPDATING) {
-    Update.abort();
+    releaseUpdate();
     Serial.println("[OTA] Update aborted");
   }
   otaStatus = OTA_ERROR;
@@ -141,6 +307,45 @@ void abortOTAUpdate() {
   otaProgress = 0;
 }
 
+bool isOTAUploadActive() {
+  return otaStatus == OTA_UPDATING && millis() - lastChunkMs < OTA_RESUME_TIMEOUT_MS;
+}
+
+void expireOTAUpdate() {
+  if (otaStatus != OTA_UPDATING || isOTAUploadActive()) {
+    return;
+  }
+  releaseUpdate();
+  otaStatus = OTA_ERROR;
+  otaError = "Interrupted update expired";
+  otaProgress = 0;
+  Serial.printf("[OTA] Interrupted update expired at %u / %u bytes\n", (unsigned)writtenSize, (unsigned)totalSize);
+}
+
+size_t getOTAWrittenSize() {
+  return writtenSize;
+}
+
+size_t getOTATotalSize() {
+  return totalSizeKnown ? totalSize : 0;
+}
+
+bool isOTACompressed() {
+  return compressed;
+}
+
+uint32_t getOTAInflatedSize() {
+  return compressed ? getOtaInflatedSize() : 0;
+}
+
+String getOTASha256() {
+  return String(imageDigestHex);
+}
+
+const char* getFirmwareVersion() {
+  return firmwareVersionTag + strlen(FIRMWARE_VERSION_TAG);
+}
+
 String getCurrentPartition() {
   const esp_partition_t* running = esp_ota_get_running_partition();
   if (running) {
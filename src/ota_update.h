@@ -8,6 +8,10 @@
 #include <Arduino.h>
 #include <Update.h>
 
+// ========== OTA Configuration ==========
+#define OTA_RESUME_TIMEOUT_MS 300000   // An interrupted upload stays resumable this long
+#define OTA_SHA256_HEX_LEN 64
+
 // OTA Update status
 enum OTAStatus {
   OTA_IDLE,
@@ -28,18 +32,48 @@ int getOTAProgress();
 // Get OTA error message
 String getOTAError();
 
-// Start OTA update
-bool startOTAUpdate(size_t firmwareSize);
+// Start OTA update. With sizeKnown the image is complete once firmwareSize
+// bytes arrived; expectedSha256 (64 hex chars, optional) is checked before
+// the partition is committed. Size and digest refer to the uploaded bytes,
+// a gzip image (detected by its magic) is inflated on the fly.
+bool startOTAUpdate(size_t firmwareSize, bool sizeKnown = false, const char* expectedSha256 = nullptr);
+
+// Continue an interrupted update at a byte offset (must equal the bytes
+// received so far, and the digest must match the one given at the start)
+bool resumeOTAUpdate(size_t offset, const char* expectedSha256 = nullptr);
 
-// Write firmware data chunk
+// Write firmware data chunk (also feeds the SHA-256)
 bool writeOTAChunk(uint8_t* data, size_t len);
 
-// Finish OTA update
+// True once all bytes of a sized update arrived
+bool isOTAImageComplete();
+
+// Verify the SHA-256 and commit the update partition
 bool finishOTAUpdate();
 
+// Update in progress and not stalled past OTA_RESUME_TIMEOUT_MS
+bool isOTAUploadActive();
+
+// Abort an update that received no data for OTA_RESUME_TIMEOUT_MS
+void expireOTAUpdate();
+
+// Bytes received and expected (0 if unknown)
+size_t getOTAWrittenSize();
+size_t getOTATotalSize();
+
+// gzip image being inflated, and the inflated bytes so far
+bool isOTACompressed();
+uint32_t getOTAInflatedSize();
+
+// SHA-256 of the received image (hex, empty until finished)
+String getOTASha256();
+
 // Abort OTA update
 void abortOTAUpdate();
 
+// Version of the running firmware (FIRMWARE_VERSION)
+const char* getFirmwareVersion();
+
 // Get current partition info
 String getCurrentPartition();
 String getNextPartition();
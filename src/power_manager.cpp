@@ -0,0 +1,153 @@
+/*
+ * Power Manager Implementation
+ *
+ * Without CONFIG_PM_ENABLE the CPU frequency is switched directly with
+ * setCpuFrequencyMhz(). With it, esp_pm scales the frequency between
+ * the two limits and this module holds a max-frequency lock while
+ * active. Light sleep stays off: it would gate the GPIO edge interrupts
+ * that count motion pulses.
+ */
+
+#include "power_manager.h"
+#include "config.h"
+#include "printer_status.h"
+#include "printer_status_codes.h"
+#include "ota_update.h"
+#include <WiFi.h>
+
+#if CONFIG_PM_ENABLE
+#include <esp_pm.h>
+#endif
+
+static volatile PowerMode mode = POWER_MODE_ACTIVE;
+static TaskHandle_t loopTask = nullptr;
+static unsigned long lastBusyMs = 0;
+static volatile unsigned long lastActivityMs = 0;
+static unsigned long idleSinceMs = 0;
+static uint32_t idleTotalMs = 0;
+
+#if CONFIG_PM_ENABLE
+static esp_pm_lock_handle_t activeLock = nullptr;
+#endif
+
+static const char* const modeNames[] = { "active", "idle" };
+
+// Printing, pausing or preparing - anything but a finished or idle printer
+static bool isPrinterBusy() {
+  int status = printerStatus.printStatus;
+  return status >= 0 &&
+         status != SDCP_PRINT_STATUS_IDLE &&
+         status != SDCP_PRINT_STATUS_STOPPED &&
+         status != SDCP_PRINT_STATUS_COMPLETE;
+}
+
+static void applyMode(PowerMode next) {
+  unsigned long now = millis();
+  bool staMode = (WiFi.getMode() & WIFI_MODE_STA) != 0;
+
+  if (next == POWER_MODE_IDLE) {
+    idleSinceMs = now;
+#if CONFIG_PM_ENABLE
+    if (activeLock) {
+      esp_pm_lock_release(activeLock);
+    }
+#else
+    setCpuFrequencyMhz(POWER_IDLE_CPU_MHZ);
+#endif
+    if (staMode) {
+      WiFi.setSleep(WIFI_PS_MAX_MODEM);
+    }
+  } else {
+    idleTotalMs += now - idleSinceMs;
+#if CONFIG_PM_ENABLE
+    if (activeLock) {
+      esp_pm_lock_acquire(activeLock);
+    }
+#else
+    setCpuFrequencyMhz(POWER_ACTIVE_CPU_MHZ);
+#endif
+    if (staMode) {
+      WiFi.setSleep(WIFI_PS_MIN_MODEM);
+    }
+  }
+
+  mode = next;
+  Serial.printf("[POWER] %s mode (CPU %lu MHz)\n", next == POWER_MODE_IDLE ? "Idle" : "Active",
+                (unsigned long)getCpuFrequencyMhz());
+}
+
+void setupPowerManager() {
+  loopTask = xTaskGetCurrentTaskHandle();
+  lastBusyMs = millis();
+
+#if CONFIG_PM_ENABLE
+  esp_pm_config_t config = {};
+  config.max_freq_mhz = POWER_ACTIVE_CPU_MHZ;
+  config.min_freq_mhz = POWER_IDLE_CPU_MHZ;
+  config.light_sleep_enable = false;
+  if (esp_pm_configure(&config) != ESP_OK ||
+      esp_pm_lock_create(ESP_PM_CPU_FREQ_MAX, 0, "active", &activeLock) != ESP_OK) {
+    activeLock = nullptr;
+    Serial.println("[POWER] ⚠️ esp_pm not available, CPU stays at full speed");
+  } else {
+    esp_pm_lock_acquire(activeLock);
+  }
+  Serial.println("[POWER] Power manager initialized (esp_pm frequency scaling)");
+#else
+  Serial.println("[POWER] Power manager initialized (frequency scaling)");
+#endif
+}
+
+void handlePowerManager() {
+  unsigned long now = millis();
+
+  if (isPrinterBusy() || isOTAUploadActive()) {
+    lastBusyMs = now;
+  }
+
+  bool idle = now - lastBusyMs > POWER_IDLE_DELAY_MS &&
+              now - lastActivityMs > POWER_ACTIVITY_HOLD_MS;
+  PowerMode next = idle ? POWER_MODE_IDLE : POWER_MODE_ACTIVE;
+  if (next != mode) {
+    applyMode(next);
+  }
+
+  if (mode == POWER_MODE_IDLE) {
+    // Sleep until a sensor edge or HTTP request, at most one idle period
+    ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(POWER_IDLE_WAIT_MS));
+  }
+}
+
+void IRAM_ATTR powerWakeFromISR() {
+  if (mode != POWER_MODE_IDLE || !loopTask) {
+    return;
+  }
+  BaseType_t woken = pdFALSE;
+  vTaskNotifyGiveFromISR(loopTask, &woken);
+  if (woken) {
+    portYIELD_FROM_ISR();
+  }
+}
+
+void notifyPowerActivity() {
+  lastActivityMs = millis();
+  if (mode == POWER_MODE_IDLE && loopTask) {
+    xTaskNotifyGive(loopTask);
+  }
+}
+
+PowerMode getPowerMode() {
+  return mode;
+}
+
+const char* getPowerModeName() {
+  return modeNames[mode];
+}
+
+uint32_t getPowerIdleSeconds() {
+  uint32_t total = idleTotalMs;
+  if (mode == POWER_MODE_IDLE) {
+    total += millis() - idleSinceMs;
+  }
+  return total / 1000;
+}
@@ -0,0 +1,46 @@
+/*
+ * Power Manager
+ * Idle mode while the printer is not printing: lower CPU frequency,
+ * maximum WiFi modem sleep and a loop that waits instead of spinning.
+ * Sensor edges and HTTP requests wake the loop immediately, a print
+ * start returns to full speed. Uses esp_pm frequency scaling when the
+ * framework is built with power management (CONFIG_PM_ENABLE).
+ */
+
+#ifndef POWER_MANAGER_H
+#define POWER_MANAGER_H
+
+#include <Arduino.h>
+
+// ========== Power Manager Configuration ==========
+#define POWER_IDLE_DELAY_MS 60000      // Not printing for this long = idle
+#define POWER_ACTIVITY_HOLD_MS 30000   // An HTTP request keeps full speed this long
+#define POWER_ACTIVE_CPU_MHZ 160
+#define POWER_IDLE_CPU_MHZ 80          // Lowest frequency that keeps WiFi running
+#define POWER_IDLE_WAIT_MS 20          // Longest loop wait per pass while idle
+
+enum PowerMode {
+  POWER_MODE_ACTIVE,
+  POWER_MODE_IDLE
+};
+
+// Initialize (call in setup() after the sensor and WiFi)
+void setupPowerManager();
+
+// Switch modes and, while idle, wait for a wake event or the
+// idle timeout (call at the end of every loop pass)
+void handlePowerManager();
+
+// Wake the loop from a sensor ISR (no-op while active)
+void powerWakeFromISR();
+
+// Report activity that needs full speed (any task, e.g. HTTP handlers)
+void notifyPowerActivity();
+
+PowerMode getPowerMode();
+const char* getPowerModeName();
+
+// Seconds spent in idle mode since boot
+uint32_t getPowerIdleSeconds();
+
+#endif // POWER_MANAGER_H
@@ -5,8 +5,11 @@
 #include "printer_status.h"
 #include "printer_status_codes.h"
 #include "filament_sensor.h"
-#include "callmebot.h"
+#include "notifier.h"
 #include "config.h"
+#include "heap_monitor.h"
+#include "warm_restart.h"
+#include "logger.h"
 
 // Global printer status instance
 PrinterStatus printerStatus;
@@ -16,6 +19,47 @@ static int lastPrintStatus = -1;
 static unsigned long printStartTime = 0;
 static String currentPrintFilename = "";  // Store filename during print
 
+// Mirror the print state into the warm restart snapshot
+static void savePrintSnapshot(bool printStarted) {
+  WarmRestartState& state = beginWarmRestartUpdate();
+  state.printStatus = printerStatus.printStatus;
+  state.lastPrintStatus = lastPrintStatus;
+  state.currentLayer = printerStatus.currentLayer;
+  state.totalLayers = printerStatus.totalLayers;
+  if (printStarted) {
+    state.printStartUs = warmRestartNowUs();
+    strlcpy(state.filename, currentPrintFilename.c_str(), sizeof(state.filename));
+  }
+  endWarmRestartUpdate();
+}
+
+void restorePrintStatus() {
+  const WarmRestartState* state = getRestoredState();
+  if (!state) {
+    return;
+  }
+
+  // Pretend the last status was already received: the sensor checks run
+  // at once and no start transition is reported for the running print
+  printerStatus.printStatus = state->printStatus;
+  printerStatus.currentLayer = state->currentLayer;
+  printerStatus.totalLayers = state->totalLayers;
+  printerStatus.filename = state->filename;
+  lastPrintStatus = state->lastPrintStatus;
+  currentPrintFilename = state->filename;
+
+  int64_t elapsedUs = state->printStartUs != 0 ? warmRestartNowUs() - state->printStartUs : -1;
+  if (elapsedUs >= 0 && elapsedUs < (int64_t)WARM_RESTART_MAX_PRINT_S * 1000000LL) {
+    printStartTime = millis() - (unsigned long)(elapsedUs / 1000);
+  } else {
+    printStartTime = millis();
+  }
+
+  LOGI("STATUS", "Restored %s, print running for %lu s, file: %s",
+                lastPrintStatus >= 0 ? getStatusText(lastPrintStatus) : "INIT",
+                (millis() - printStartTime) / 1000, currentPrintFilename.c_str());
+}
+
 void displayPrinterStatus() {
   Serial.println("\n========================================");
   Serial.println("         PRINTER STATUS");
@@ -72,19 +116,16 @@ void displayPrinterStatus() {
 }
 
 void checkStatusNotifications() {
+  HEAP_TAG_SCOPE(HEAP_TAG_STATUS);
+
   // Check if print status changed
   if (printerStatus.printStatus != lastPrintStatus) {
-    // Log EVERY status change for debugging
-    Serial.println("\n========================================");
-    Serial.println("   STATUS CHANGE DETECTED!");
-    Serial.println("========================================");
-    Serial.printf("Last Status: %d (%s)\n", lastPrintStatus,
-                  lastPrintStatus >= 0 ? getStatusText(lastPrintStatus) : "INIT");
-    Serial.printf("New Status:  %d (%s)\n", printerStatus.printStatus,
-                  getStatusText(printerStatus.printStatus));
-    Serial.println("========================================\n");
+    LOGI("STATUS", "Status change: %d (%s) -> %d (%s)", lastPrintStatus,
+         lastPrintStatus >= 0 ? getStatusText(lastPrintStatus) : "INIT",
+         printerStatus.printStatus, getStatusText(printerStatus.printStatus));
 
     // Print started or resumed - reset filament sensor timer and save filename
+    bool printStarted = false;
     if (lastPrintStatus != SDCP_PRINT_STATUS_PRINTING &&
         lastPrintStatus != SDCP_PRINT_STATUS_PRINTING_ALT &&
         lastPrintStatus != SDCP_PRINT_STATUS_PRINTING_RESUME &&
@@ -95,8 +136,9 @@ void checkStatusNotifications() {
       resetFilamentSensor();  // Reset motion timer to prevent false jam detection
       printStartTime = millis();
       currentPrintFilename = printerStatus.filename;  // Save filename for completion notification
-      Serial.printf("[STATUS] ✓ Print started/resumed - filament sensor reset, filename: %s\n",
-                    currentPrintFilename.c_str());
+      printStarted = true;
+      LOGI("STATUS", "✓ Print started/resumed - filament sensor reset, filename: %s",
+           currentPrintFilename.c_str());
     }
 
     // Print completed (when transitioning to COMPLETE, STOPPED or IDLE after printing)
@@ -107,28 +149,24 @@ void checkStatusNotifications() {
                          lastPrintStatus == SDCP_PRINT_STATUS_PRINTING_ALT ||
                          lastPrintStatus == SDCP_PRINT_STATUS_PRINTING_RESUME);
 
-    Serial.printf("[STATUS DEBUG] isCompletedStatus: %s, wasPrinting: %s\n",
-                  isCompletedStatus ? "YES" : "NO", wasPrinting ? "YES" : "NO");
+    LOGD("STATUS", "isCompletedStatus: %s, wasPrinting: %s",
+         isCompletedStatus ? "YES" : "NO", wasPrinting ? "YES" : "NO");
 
     if (isCompletedStatus && wasPrinting) {
       unsigned long duration = millis() - printStartTime;
-      Serial.println("\n========================================");
-      Serial.println("   🎉 PRINT COMPLETED!");
-      Serial.println("========================================");
-      Serial.printf("Filename: %s\n", currentPrintFilename.c_str());
-      Serial.printf("Duration: %lu ms\n", duration);
-      Serial.printf("Transition: %d (%s) -> %d (%s)\n",
-                    lastPrintStatus, getStatusText(lastPrintStatus),
-                    printerStatus.printStatus, getStatusText(printerStatus.printStatus));
-      Serial.println("Sending WhatsApp notification...");
-      Serial.println("========================================\n");
+      LOGI("STATUS", "🎉 Print completed: %s, %lu s", currentPrintFilename.c_str(), duration / 1000);
 
       // Use saved filename instead of current (which might be empty)
       notifyPrintComplete(currentPrintFilename.c_str(), duration);
-      Serial.printf("[STATUS] ✅ Print completed notification sent (status changed from %d to %d)\n",
-                    lastPrintStatus, printerStatus.printStatus);
+      LOGD("STATUS", "Print completed notification queued (status changed from %d to %d)",
+           lastPrintStatus, printerStatus.printStatus);
     }
 
     lastPrintStatus = printerStatus.printStatus;
+    savePrintSnapshot(printStarted);
+  } else if (getWarmRestartState().currentLayer != printerStatus.currentLayer ||
+             getWarmRestartState().totalLayers != printerStatus.totalLayers) {
+    // Layer changed: refresh the snapshot (once per layer)
+    savePrintSnapshot(false);
   }
 }
@@ -42,6 +42,9 @@ void displayPrinterStatus();
 // Check for status changes and send notifications
 void checkStatusNotifications();
 
+// Restore the last known print state after a warm restart (call before arming the sensor)
+void restorePrintStatus();
+
 // Note: getStatusText() is defined in printer_status_codes.h
 
 #endif // PRINTER_STATUS_H
@@ -0,0 +1,203 @@
+/*
+ * Sampling Profiler Implementation
+ *
+ * The timer ISR reads mepc, the PC the interrupt returns to, i.e. the
+ * instruction the CPU was about to execute. The histogram is an
+ * open-addressing hash table written only by the ISR; a run ends through
+ * a one-shot esp_timer so the hardware timer is never touched from the
+ * interrupt itself.
+ */
+
+#include "sample_profiler.h"
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#if CONFIG_IDF_TARGET_ARCH_RISCV
+#include <riscv/csr.h>
+#endif
+
+#define PROFILE_SLOT_MASK (PROFILE_SLOTS - 1)
+#define PROFILE_MAX_PROBES 8              // Collisions tried before a sample is dropped
+#define PROFILE_TASK_OTHER 0xFF
+
+struct ProfileSlot {
+  uint32_t pc;                            // 0 = empty
+  uint32_t count;                         // 300 s at 997 Hz fits easily
+  uint8_t task;
+};
+
+static ProfileSlot slots[PROFILE_SLOTS];
+static TaskHandle_t taskHandles[PROFILE_MAX_TASKS];
+static char taskNames[PROFILE_MAX_TASKS][configMAX_TASK_NAME_LEN];
+static volatile uint8_t taskCount = 0;
+
+static volatile bool running = false;
+static volatile uint32_t sampleCount = 0;
+static volatile uint32_t droppedCount = 0;
+static volatile uint32_t slotsUsed = 0;
+static uint32_t runSeconds = 0;
+
+static hw_timer_t* sampleTimer = nullptr;
+static esp_timer_handle_t stopTimer = nullptr;
+
+static inline uint32_t IRAM_ATTR interruptedPc() {
+#if CONFIG_IDF_TARGET_ARCH_RISCV
+  return RV_READ_CSR(mepc);
+#else
+  return 0;
+#endif
+}
+
+// Index of the interrupted task (only the ISR adds entries)
+static uint8_t IRAM_ATTR sampledTask() {
+  TaskHandle_t task = xTaskGetCurrentTaskHandle();
+  uint8_t count = taskCount;
+  for (uint8_t i = 0; i < count; i++) {
+    if (taskHandles[i] == task) {
+      return i;
+    }
+  }
+  if (count == PROFILE_MAX_TASKS) {
+    return PROFILE_TASK_OTHER;
+  }
+  taskHandles[count] = task;
+  const char* name = pcTaskGetName(task);
+  size_t i = 0;
+  for (; i < sizeof(taskNames[count]) - 1 && name[i]; i++) {
+    taskNames[count][i] = name[i];
+  }
+  taskNames[count][i] = '\0';
+  taskCount = count + 1;
+  return count;
+}
+
+static void IRAM_ATTR sampleISR() {
+  if (!running) {
+    return;
+  }
+
+  uint32_t pc = interruptedPc();
+  uint8_t task = sampledTask();
+  sampleCount++;
+
+  // Multiplicative hash, instructions are 2-byte aligned
+  uint32_t index = ((pc >> 1) * 2654435761u) >> 16;
+  for (int probe = 0; probe < PROFILE_MAX_PROBES; probe++) {
+    ProfileSlot& slot = slots[(index + probe) & PROFILE_SLOT_MASK];
+    if (slot.pc == pc && slot.task == task) {
+      slot.count++;
+      return;
+    }
+    if (slot.pc == 0) {
+      slot.task = task;
+      slot.count = 1;
+      slot.pc = pc;
+      slotsUsed++;
+      return;
+    }
+  }
+  droppedCount++;
+}
+
+// Runs in the esp_timer task when the requested duration is over
+static void stopCallback(void* arg) {
+  stopSampleProfiler();
+}
+
+bool startSampleProfiler(uint32_t seconds) {
+  if (running) {
+    return false;
+  }
+  if (seconds == 0) {
+    seconds = PROFILE_DEFAULT_SECONDS;
+  }
+  if (seconds > PROFILE_MAX_SECONDS) {
+    seconds = PROFILE_MAX_SECONDS;
+  }
+
+  if (!sampleTimer) {
+    sampleTimer = timerBegin(1000000);
+    if (!sampleTimer) {
+      Serial.println("[PROFILE] ERROR: No hardware timer available");
+      return false;
+    }
+    timerAttachInterrupt(sampleTimer, sampleISR);
+    timerAlarm(sampleTimer, 1000000 / PROFILE_SAMPLE_HZ, true, 0);
+    timerStop(sampleTimer);
+  }
+  if (!stopTimer) {
+    esp_timer_create_args_t args = {};
+    args.callback = stopCallback;
+    args.name = "profstop";
+    if (esp_timer_create(&args, &stopTimer) != ESP_OK) {
+      return false;
+    }
+  }
+
+  memset(slots, 0, sizeof(slots));
+  taskCount = 0;
+  sampleCount = 0;
+  droppedCount = 0;
+  slotsUsed = 0;
+  runSeconds = seconds;
+
+  running = true;
+  timerRestart(sampleTimer);
+  timerStart(sampleTimer);
+  esp_timer_start_once(stopTimer, (uint64_t)seconds * 1000000);
+
+  Serial.printf("[PROFILE] Sampling at %d Hz for %lu s\n", PROFILE_SAMPLE_HZ, (unsigned long)seconds);
+  return true;
+}
+
+void stopSampleProfiler() {
+  if (!running) {
+    return;
+  }
+  running = false;
+  timerStop(sampleTimer);
+  esp_timer_stop(stopTimer);
+  Serial.printf("[PROFILE] Done: %lu samples, %lu dropped\n",
+                (unsigned long)sampleCount, (unsigned long)droppedCount);
+}
+
+SampleProfileStats getSampleProfileStats() {
+  SampleProfileStats stats;
+  stats.running = running;
+#if CONFIG_IDF_TARGET_ARCH_RISCV
+  stats.supported = true;
+#else
+  stats.supported = false;
+#endif
+  stats.seconds = runSeconds;
+  stats.samples = sampleCount;
+  stats.dropped = droppedCount;
+  stats.slotsUsed = slotsUsed;
+  return stats;
+}
+
+void writeSampleProfile(Print& out) {
+  SampleProfileStats stats = getSampleProfileStats();
+  out.printf("{\"running\":%s,\"supported\":%s,\"hz\":%d,\"seconds\":%lu,\"samples\":%lu,\"dropped\":%lu,\"slotsUsed\":%lu,\"tasks\":[",
+             stats.running ? "true" : "false", stats.supported ? "true" : "false", PROFILE_SAMPLE_HZ,
+             (unsigned long)stats.seconds, (unsigned long)stats.samples, (unsigned long)stats.dropped,
+             (unsigned long)stats.slotsUsed);
+
+  uint8_t count = taskCount;
+  for (uint8_t i = 0; i < count; i++) {
+    out.printf("%s\"%s\"", i > 0 ? "," : "", taskNames[i]);
+  }
+
+  // [pc, task index (255 = other), samples]
+  out.print("],\"pcs\":[");
+  bool first = true;
+  for (int i = 0; i < PROFILE_SLOTS; i++) {
+    ProfileSlot slot = slots[i];
+    if (slot.pc == 0) {
+      continue;
+    }
+    out.printf("%s[%lu,%u,%lu]", first ? "" : ",", (unsigned long)slot.pc, slot.task, (unsigned long)slot.count);
+    first = false;
+  }
+  out.print("]}");
+}
@@ -0,0 +1,41 @@
+/*
+ * Sampling Profiler
+ * A hardware timer interrupt records the interrupted program counter and
+ * task at a fixed rate into a PC histogram. Started on demand for a few
+ * seconds via /api/profile; tools/profile_symbolize.py maps the samples
+ * to functions using the firmware ELF.
+ */
+
+#ifndef SAMPLE_PROFILER_H
+#define SAMPLE_PROFILER_H
+
+#include <Arduino.h>
+
+// ========== Sampling Profiler Configuration ==========
+#define PROFILE_SAMPLE_HZ 997             // Prime, so samples do not lock onto the 1 kHz tick
+#define PROFILE_SLOTS 512                 // Distinct (PC, task) pairs per run (power of two)
+#define PROFILE_MAX_TASKS 12              // Tasks told apart; later ones count as "other"
+#define PROFILE_DEFAULT_SECONDS 10
+#define PROFILE_MAX_SECONDS 300
+
+struct SampleProfileStats {
+  bool running;
+  bool supported;                         // PC sampling available on this chip
+  uint32_t seconds;                       // Requested duration of the last run
+  uint32_t samples;                       // Samples taken in the last run
+  uint32_t dropped;                       // Samples lost because the histogram was full
+  uint32_t slotsUsed;
+};
+
+// Start a run (clears the previous histogram); false if already running
+bool startSampleProfiler(uint32_t seconds);
+
+// End the current run early
+void stopSampleProfiler();
+
+SampleProfileStats getSampleProfileStats();
+
+// Histogram as JSON: {"hz", "samples", "tasks": [...], "pcs": [[pc, task, count], ...]}
+void writeSampleProfile(Print& out);
+
+#endif // SAMPLE_PROFILER_H
@@ -1,10 +1,267 @@
 /*
  * Serial Configuration Helper Implementation
+ *
+ * Bytes are collected into a fixed line buffer (at most
+ * SERIAL_BYTES_PER_PASS per call), so a slow or silent terminal never
+ * holds up the loop. A command is the text up to the first ':' or space,
+ * the rest is passed to its handler.
  */
 
 #include "serial_config.h"
+#include "config.h"
 #include "config_manager.h"
+#include "loop_profiler.h"
+#include "heap_monitor.h"
+#include "metrics.h"
+#include "filament_sensor.h"
+#include "printer_status.h"
+#include "websocket_client.h"
+#include "wifi_manager.h"
+#include "power_manager.h"
+#include "settings_store.h"
+#include "notifier.h"
+#include "ota_update.h"
+#include "ota_health.h"
+#include "web_server.h"
+#include "url_encode.h"
+#include "task_monitor.h"
 #include <Arduino.h>
+#include <esp_timer.h>
+#include <esp_rom_crc.h>
+
+typedef void (*SerialCommandHandler)(const char* args);
+
+struct SerialCommand {
+  const char* name;
+  const char* usage;
+  SerialCommandHandler handler;
+};
+
+static char lineBuffer[SERIAL_LINE_MAX];
+static size_t lineLength = 0;
+static bool lineOverflow = false;
+
+// ========== Configuration Commands ==========
+
+static void commandWiFi(const char* args) {
+  // Format: wifi:ssid:password
+  const char* colon = strchr(args, ':');
+  if (!colon || colon == args) {
+    Serial.println("[SERIAL] ✗ Invalid format! Use: wifi:ssid:password");
+    return;
+  }
+
+  String ssid = String(args).substring(0, colon - args);
+  Serial.printf("[SERIAL] Setting WiFi: %s\n", ssid.c_str());
+  updateWiFiConfig(ssid.c_str(), colon + 1);
+  Serial.println("[SERIAL] ✓ WiFi configuration saved!");
+  Serial.println("[SERIAL] Type 'restart' to apply changes.");
+}
+
+static void commandPrinter(const char* args) {
+  // Format: printer:ip:port
+  const char* colon = strchr(args, ':');
+  if (!colon || colon == args) {
+    Serial.println("[SERIAL] ✗ Invalid format! Use: printer:192.168.1.100:80");
+    return;
+  }
+
+  String ip = String(args).substring(0, colon - args);
+  int port = atoi(colon + 1);
+  if (port == 0) port = 80;
+
+  Serial.printf("[SERIAL] Setting Printer: %s:%d\n", ip.c_str(), port);
+  updatePrinterConfig(ip.c_str(), port);
+  Serial.println("[SERIAL] ✓ Printer configuration saved!");
+  Serial.println("[SERIAL] Type 'restart' to apply changes.");
+}
+
+static void commandShow(const char* args) {
+  SystemConfig& config = getConfig();
+  Serial.println("\n[SERIAL] Current Configuration:");
+  Serial.printf("[SERIAL]   Configured: %s\n", config.configured ? "YES" : "NO");
+  Serial.printf("[SERIAL]   WiFi SSID: %s\n", config.wifiSSID);
+  Serial.printf("[SERIAL]   WiFi Password: %s\n", strlen(config.wifiPassword) > 0 ? "***" : "(empty)");
+  Serial.printf("[SERIAL]   Printer IP: %s\n", config.printerIP);
+  Serial.printf("[SERIAL]   Printer Port: %d\n", config.printerPort);
+  Serial.println();
+}
+
+static void commandRestart(const char* args) {
+  Serial.println("[SERIAL] Restarting ESP32...");
+  flushSettings();
+  delay(100);
+  ESP.restart();
+}
+
+// ========== Diagnostic Commands ==========
+
+static void commandStats(const char* args) {
+  Serial.println("\n--- Stats ---");
+  Serial.printf("Firmware: %s (%s), OTA health: %s\n", getFirmwareVersion(),
+                getCurrentPartition().c_str(), getOTAHealthStateName());
+  Serial.printf("Uptime: %lu s, CPU: %lu MHz, power: %s (idle %lu s)\n",
+                millis() / 1000, (unsigned long)getCpuFrequencyMhz(), getPowerModeName(),
+                (unsigned long)getPowerIdleSeconds());
+  Serial.printf("WiFi: %s, RSSI %d dBm, link up %lu s\n", getWiFiStateName(), getWiFiRssi(),
+                getWiFiLinkUptime() / 1000);
+  Serial.printf("Printer: %s, status %s, layer %d/%d\n",
+                isWebSocketConnected() ? "connected" : "disconnected",
+                getStatusText(printerStatus.printStatus),
+                printerStatus.currentLayer, printerStatus.totalLayers);
+  Serial.printf("Notifications queued: %d\n", getNotificationQueueDepth());
+
+  SettingsStats settings = getSettingsStats();
+  Serial.printf("Settings: %lu commits since boot, %lu lifetime%s\n",
+                (unsigned long)settings.commits, (unsigned long)settings.lifetimeCommits,
+                settings.pending ? ", changes pending" : "");
+
+  Serial.printf("Motion pulses: %lu, jams: %lu, runouts: %lu, auto-pauses: %lu\n",
+                (unsigned long)metricsGet(METRIC_MOTION_PULSES), (unsigned long)metricsGet(METRIC_JAM_EVENTS),
+                (unsigned long)metricsGet(METRIC_RUNOUT_EVENTS), (unsigned long)metricsGet(METRIC_AUTO_PAUSES));
+  Serial.printf("WebSocket: %lu frames, %lu parse errors, %lu reconnects\n",
+                (unsigned long)metricsGet(METRIC_WS_FRAMES_PARSED), (unsigned long)metricsGet(METRIC_WS_PARSE_ERRORS),
+                (unsigned long)metricsGet(METRIC_WS_RECONNECTS));
+  Serial.printf("WiFi: %lu disconnects, %lu failed connects\n",
+                (unsigned long)metricsGet(METRIC_WIFI_DISCONNECTS),
+                (unsigned long)metricsGet(METRIC_WIFI_CONNECT_FAILURES));
+  Serial.printf("Notify: %lu retries, %lu dropped; HTTP: %lu overloaded, %lu rate limited\n",
+                (unsigned long)metricsGet(METRIC_NOTIFY_RETRIES), (unsigned long)metricsGet(METRIC_NOTIFY_DROPPED),
+                (unsigned long)metricsGet(METRIC_HTTP_OVERLOADED), (unsigned long)metricsGet(METRIC_HTTP_RATE_LIMITED));
+}
+
+static void commandHeap(const char* args) {
+  Serial.println("\n--- Heap ---");
+  Serial.printf("Free: %lu bytes, largest block: %lu bytes, minimum: %lu bytes\n",
+                (unsigned long)ESP.getFreeHeap(), (unsigned long)ESP.getMaxAllocHeap(),
+                (unsigned long)ESP.getMinFreeHeap());
+
+  // Most recent short-term samples, oldest first
+  int count = getHeapSampleCount(false);
+  int first = count > 6 ? count - 6 : 0;
+  for (int i = first; i < count; i++) {
+    HeapSample sample = getHeapSample(false, i);
+    Serial.printf("  %6lu s: free %6lu, largest %6lu\n", (unsigned long)sample.uptimeS,
+                  (unsigned long)sample.freeHeap, (unsigned long)sample.largestBlock);
+  }
+
+  if (heapAllocHooksEnabled()) {
+    Serial.println("Tag         Allocs      Bytes      Frees");
+    for (int tag = 0; tag < HEAP_TAG_COUNT; tag++) {
+      HeapTagStats stats = getHeapTagStats((HeapTag)tag);
+      Serial.printf("%-10s %7lu %10lu %10lu\n", stats.name, (unsigned long)stats.allocs,
+                    (unsigned long)stats.bytes, (unsigned long)stats.frees);
+    }
+  }
+}
+
+static void commandTasks(const char* args) {
+  printTaskStats();
+}
+
+static void commandLoopProf(const char* args) {
+  if (strcmp(args, "reset") == 0) {
+    resetLoopProfiler();
+    Serial.println("[SERIAL] ✓ Loop profiler reset");
+  } else {
+    printLoopProfile();
+  }
+}
+
+static void commandStatus(const char* args) {
+  displayPrinterStatus();
+}
+
+static void commandSensor(const char* args) {
+  displayFilamentSensorStatus();
+  Serial.printf("Armed: %s\n", isFilamentSensorArmed() ? "YES" : "NO");
+  Serial.printf("Motion Timeout: %lu ms\n", getMotionTimeout());
+  Serial.printf("Switch Mode: %s\n", getSwitchDirectMode() ? "Direct" : "Pause Command");
+  Serial.printf("Runout Pin: %s\n", getRunoutPinState().c_str());
+}
+
+// ========== Benchmarks ==========
+
+static volatile uint32_t benchSink = 0;
+
+static void benchDigitalRead() {
+  benchSink += digitalRead(SENSOR_SWITCH) + digitalRead(SENSOR_MOTION);
+}
+
+static void benchUrlEncode() {
+  static const char* message = "⚠️ Filament-Stau erkannt! Druck pausiert: Benchy_0.2mm_PLA.gcode (Layer 42/180)";
+  char out[256];
+  benchSink += urlEncode(message, out, sizeof(out));
+}
+
+static void benchStatusJson() {
+  JsonDocument doc;
+  buildStatusDocument(doc);
+  benchSink += measureJson(doc);
+}
+
+static void benchSettingsCrc() {
+  benchSink += esp_rom_crc32_le(0, (const uint8_t*)&getSettings(), sizeof(Settings));
+}
+
+struct BenchCase {
+  const char* name;
+  void (*fn)();
+};
+
+static const BenchCase benchCases[] = {
+  { "digitalRead x2", benchDigitalRead },
+  { "urlEncode",      benchUrlEncode },
+  { "statusJson",     benchStatusJson },
+  { "settingsCrc",    benchSettingsCrc },
+};
+
+static const size_t BENCH_CASE_COUNT = sizeof(benchCases) / sizeof(benchCases[0]);
+static size_t nextBenchCase = BENCH_CASE_COUNT;  // == count: no run in progress
+
+// Run a case in batches until the time budget is used up
+static void runBench(const BenchCase& bench) {
+  const int batch = 16;
+  uint32_t iterations = 0;
+  int64_t start = esp_timer_get_time();
+  int64_t elapsed;
+  do {
+    for (int i = 0; i < batch; i++) {
+      bench.fn();
+    }
+    iterations += batch;
+    elapsed = esp_timer_get_time() - start;
+  } while (elapsed < SERIAL_BENCH_BUDGET_US);
+
+  Serial.printf("%-14s %8lu %10lu\n", bench.name, (unsigned long)iterations,
+                (unsigned long)(elapsed * 1000 / iterations));
+}
+
+// Cases run one per checkSerialConfig() pass so the loop keeps turning in between
+static void commandBench(const char* args) {
+  Serial.printf("\n--- Bench (%d ms per case, %lu MHz) ---\n", SERIAL_BENCH_BUDGET_US / 1000,
+                (unsigned long)getCpuFrequencyMhz());
+  Serial.println("Case             Iters      ns/op");
+  nextBenchCase = 0;
+}
+
+static void commandHelp(const char* args);
+
+static const SerialCommand commands[] = {
+  { "wifi",     "wifi:<ssid>:<password>", commandWiFi },
+  { "printer",  "printer:<ip>:<port>",    commandPrinter },
+  { "show",     "show",                   commandShow },
+  { "stats",    "stats",                  commandStats },
+  { "heap",     "heap",                   commandHeap },
+  { "loopprof", "loopprof [reset]",       commandLoopProf },
+  { "tasks",    "tasks",                  commandTasks },
+  { "status",   "status",                 commandStatus },
+  { "sensor",   "sensor",                 commandSensor },
+  { "bench",    "bench",                  commandBench },
+  { "restart",  "restart",                commandRestart },
+  { "help",     "help",                   commandHelp },
+  { "?",        nullptr,                  commandHelp },
+};
 
 void printConfigMenu() {
   Serial.println("\n");
@@ -13,10 +270,11 @@ void printConfigMenu() {
   Serial.println("╠═══════════════════════════════════════════╣");
   Serial.println("║  Enter commands in Serial Monitor:        ║");
   Serial.println("║                                           ║");
-  Serial.println("║  wifi:<ssid>:<password>                   ║");
-  Serial.println("║  printer:<ip>:<port>                      ║");
-  Serial.println("║  show                                     ║");
-  Serial.println("║  restart                                  ║");
+  for (const SerialCommand& command : commands) {
+    if (command.usage) {
+      Serial.printf("║  %-41s║\n", command.usage);
+    }
+  }
   Serial.println("║                                           ║");
   Serial.println("║  Example:                                 ║");
   Serial.println("║  wifi:MeinWiFi:geheim123                  ║");
@@ -25,69 +283,58 @@ void printConfigMenu() {
   Serial.println();
 }
 
-void checkSerialConfig() {
-  if (Serial.available() > 0) {
-    String command = Serial.readStringUntil('\n');
-    command.trim();
+static void commandHelp(const char* args) {
+  printConfigMenu();
+}
+
+static void dispatchLine(char* line) {
+  Serial.printf("[SERIAL] Received: %s\n", line);
 
-    if (command.length() == 0) {
+  // Command name ends at the first ':' or space
+  char* args = line + strcspn(line, ": ");
+  if (*args != '\0') {
+    *args++ = '\0';
+    while (*args == ' ') args++;
+  }
+
+  for (const SerialCommand& command : commands) {
+    if (strcmp(line, command.name) == 0) {
+      command.handler(args);
       return;
     }
+  }
+  Serial.println("[SERIAL] ✗ Unknown command. Type 'help' for menu.");
+}
 
-    Serial.printf("[SERIAL] Received: %s\n", command.c_str());
-
-    if (command.startsWith("wifi:")) {
-      // Format: wifi:ssid:password
-      int firstColon = command.indexOf(':', 5);
-      if (firstColon > 5) {
-        String ssid = command.substring(5, firstColon);
-        String password = command.substring(firstColon + 1);
-
-        Serial.printf("[SERIAL] Setting WiFi: %s\n", ssid.c_str());
-        updateWiFiConfig(ssid.c_str(), password.c_str());
-        Serial.println("[SERIAL] ✓ WiFi configuration saved!");
-        Serial.println("[SERIAL] Type 'restart' to apply changes.");
-      } else {
-        Serial.println("[SERIAL] ✗ Invalid format! Use: wifi:ssid:password");
-      }
-    }
-    else if (command.startsWith("printer:")) {
-      // Format: printer:ip:port
-      int firstColon = command.indexOf(':', 8);
-      if (firstColon > 8) {
-        String ip = command.substring(8, firstColon);
-        int port = command.substring(firstColon + 1).toInt();
-
-        if (port == 0) port = 80;
-
-        Serial.printf("[SERIAL] Setting Printer: %s:%d\n", ip.c_str(), port);
-        updatePrinterConfig(ip.c_str(), port);
-        Serial.println("[SERIAL] ✓ Printer configuration saved!");
-        Serial.println("[SERIAL] Type 'restart' to apply changes.");
-      } else {
-        Serial.println("[SERIAL] ✗ Invalid format! Use: printer:192.168.1.100:80");
+void checkSerialConfig() {
+  if (nextBenchCase < BENCH_CASE_COUNT) {
+    runBench(benchCases[nextBenchCase++]);
+  }
+
+  for (int budget = SERIAL_BYTES_PER_PASS; budget > 0 && Serial.available() > 0; budget--) {
+    int c = Serial.read();
+
+    if (c == '\n' || c == '\r') {
+      // Trim trailing spaces
+      while (lineLength > 0 && lineBuffer[lineLength - 1] == ' ') lineLength--;
+      lineBuffer[lineLength] = '\0';
+
+      if (lineOverflow) {
+        Serial.printf("[SERIAL] ✗ Line too long (max %d characters)\n", SERIAL_LINE_MAX - 1);
+      } else if (lineLength > 0) {
+        char* line = lineBuffer;
+        while (*line == ' ') line++;
+        dispatchLine(line);
       }
-    }
-    else if (command == "show") {
-      SystemConfig& config = getConfig();
-      Serial.println("\n[SERIAL] Current Configuration:");
-      Serial.printf("[SERIAL]   Configured: %s\n", config.configured ? "YES" : "NO");
-      Serial.printf("[SERIAL]   WiFi SSID: %s\n", config.wifiSSID);
-      Serial.printf("[SERIAL]   WiFi Password: %s\n", strlen(config.wifiPassword) > 0 ? "***" : "(empty)");
-      Serial.printf("[SERIAL]   Printer IP: %s\n", config.printerIP);
-      Serial.printf("[SERIAL]   Printer Port: %d\n", config.printerPort);
-      Serial.println();
-    }
-    else if (command == "restart") {
-      Serial.println("[SERIAL] Restarting ESP32...");
-      delay(1000);
-      ESP.restart();
-    }
-    else if (command == "help" || command == "?") {
-      printConfigMenu();
-    }
-    else {
-      Serial.println("[SERIAL] ✗ Unknown command. Type 'help' for menu.");
+      lineLength = 0;
+      lineOverflow = false;
+    } else if (c == '\b' || c == 0x7F) {
+      // Backspace from terminal programs
+      if (lineLength > 0) lineLength--;
+    } else if (lineLength < SERIAL_LINE_MAX - 1) {
+      lineBuffer[lineLength++] = (char)c;
+    } else {
+      lineOverflow = true;
     }
   }
 }
@@ -1,12 +1,19 @@
 /*
  * Serial Configuration Helper
- * Configure WiFi and Printer via Serial Monitor
+ * Configure WiFi and Printer via Serial Monitor, plus diagnostic
+ * commands for on-site debugging. Input is collected without blocking
+ * and dispatched line by line through a command table.
  */
 
 #ifndef SERIAL_CONFIG_H
 #define SERIAL_CONFIG_H
 
-// Check for serial configuration commands
+// ========== Serial Console Configuration ==========
+#define SERIAL_LINE_MAX 128            // Longest accepted command line
+#define SERIAL_BYTES_PER_PASS 64       // Input bytes consumed per loop pass
+#define SERIAL_BENCH_BUDGET_US 5000    // Time per benchmark case, one case per loop pass
+
+// Read pending input and run complete command lines (never blocks)
 void checkSerialConfig();
 
 // Print configuration menu
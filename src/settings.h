@@ -310,7 +310,7 @@ const char* getSettingsHTML() {
       </div>
 
       <div class="controls" style="margin-top: 20px;">
-        <input type="file" id="firmwareFile" accept=".bin" style="display: none;" onchange="uploadFirmware()">
+        <input type="file" id="firmwareFile" accept=".bin,.gz" style="display: none;" onchange="uploadFirmware()">
         <button class="btn btn-success" onclick="document.getElementById('firmwareFile').click()">
           📁 Firmware auswählen
         </button>
@@ -530,8 +530,8 @@ const char* getSettingsHTML() {
 
       if (!file) return;
 
-      if (!file.name.endsWith('.bin')) {
-        alert('Bitte nur .bin Dateien auswählen!');
+      if (!file.name.endsWith('.bin') && !file.name.endsWith('.bin.gz')) {
+        alert('Bitte nur .bin oder .bin.gz Dateien auswählen!');
         return;
       }
 
@@ -540,9 +540,6 @@ const char* getSettingsHTML() {
         return;
       }
 
-      const formData = new FormData();
-      formData.append('firmware', file);
-
       const progressDiv = document.getElementById('otaProgress');
       const progressBar = document.getElementById('otaProgressBar');
       const statusDiv = document.getElementById('otaStatus');
@@ -552,20 +549,33 @@ const char* getSettingsHTML() {
       progressBar.textContent = '0%';
       statusDiv.textContent = 'Upload läuft...';
 
-      try {
+      const fail = (message) => {
+        statusDiv.textContent = 'Fehler: ' + message;
+        progressBar.style.background = '#dc3545';
+        alert('Upload fehlgeschlagen: ' + message);
+        fileInput.value = '';
+      };
+
+      // Upload from a byte offset; after a dropped connection continue where the ESP32 stopped
+      let retries = 0;
+      const sendFrom = (start) => {
+        const formData = new FormData();
+        formData.append('firmware', file.slice(start), file.name);
+
         const xhr = new XMLHttpRequest();
 
         xhr.upload.addEventListener('progress', (e) => {
           if (e.lengthComputable) {
-            const percentComplete = Math.round((e.loaded / e.total) * 100);
+            const sent = start + (file.size - start) * (e.loaded / e.total);
+            const percentComplete = Math.round((sent / file.size) * 100);
             progressBar.style.width = percentComplete + '%';
             progressBar.textContent = percentComplete + '%';
           }
         });
 
         xhr.addEventListener('load', () => {
+          const response = JSON.parse(xhr.responseText);
           if (xhr.status === 200) {
-            const response = JSON.parse(xhr.responseText);
             progressBar.style.width = '100%';
             progressBar.textContent = '100%';
             statusDiv.textContent = response.message || 'Upload erfolgreich! Neustart...';
@@ -574,31 +584,45 @@ const char* getSettingsHTML() {
             setTimeout(() => {
               alert('Firmware erfolgreich aktualisiert!\n\nDer ESP32 startet jetzt neu.\nBitte warten Sie ca. 10 Sekunden und laden Sie die Seite neu.');
             }, 1000);
+            fileInput.value = '';
           } else {
-            const response = JSON.parse(xhr.responseText);
-            statusDiv.textContent = 'Fehler: ' + (response.message || 'Upload fehlgeschlagen');
-            progressBar.style.background = '#dc3545';
-            alert('Upload fehlgeschlagen: ' + (response.message || 'Unbekannter Fehler'));
+            fail(response.message || 'Upload fehlgeschlagen');
           }
-          fileInput.value = '';
         });
 
         xhr.addEventListener('error', () => {
-          statusDiv.textContent = 'Upload fehlgeschlagen';
-          progressBar.style.background = '#dc3545';
-          alert('Upload fehlgeschlagen: Netzwerkfehler');
-          fileInput.value = '';
+          if (retries++ >= 5) {
+            fail('Netzwerkfehler');
+            return;
+          }
+          statusDiv.textContent = 'Verbindung unterbrochen, setze Upload fort...';
+          setTimeout(async () => {
+            try {
+              const status = await (await fetch('/api/ota/status')).json();
+              if (status.resumable) {
+                sendFrom(status.written);
+                return;
+              }
+            } catch (error) {
+              console.error('OTA Status Fehler:', error);
+            }
+            fail('Netzwerkfehler');
+          }, 2000);
         });
 
-        xhr.open('POST', '/api/ota/upload');
+        let url = '/api/ota/upload?size=' + file.size;
+        if (start > 0) {
+          url += '&offset=' + start;
+        }
+        xhr.open('POST', url);
         xhr.send(formData);
+      };
 
+      try {
+        sendFrom(0);
       } catch (error) {
         console.error('Upload Fehler:', error);
-        statusDiv.textContent = 'Fehler: ' + error.message;
-        progressBar.style.background = '#dc3545';
-        alert('Upload fehlgeschlagen: ' + error.message);
-        fileInput.value = '';
+        fail(error.message);
       }
     }
 
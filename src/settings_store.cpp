@@ -0,0 +1,331 @@
+/*
+ * Settings Store Implementation
+ *
+ * NVS layout: namespace "settings", key "blob" = SettingsHeader + Settings.
+ * NVS replaces a blob atomically, so a power loss during a commit leaves
+ * the previous version intact.
+ */
+
+#include "settings_store.h"
+#include "config.h"
+#include "metrics.h"
+#include <Preferences.h>
+#include <esp_rom_crc.h>
+#include <esp_system.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+
+#define SETTINGS_NAMESPACE "settings"
+#define SETTINGS_KEY "blob"
+#define SETTINGS_MAGIC 0x54455343  // "CSET"
+
+struct SettingsHeader {
+  uint32_t magic;
+  uint16_t version;
+  uint16_t size;          // sizeof(Settings) of the firmware that wrote the blob
+  uint32_t crc;           // CRC32 of the settings bytes
+  uint32_t commitCount;   // Lifetime commits
+};
+
+struct SettingsBlob {
+  SettingsHeader header;
+  Settings settings;
+};
+
+static const char* const sectionNames[SETTINGS_SECTION_COUNT] = {
+  "system", "filament", "callmebot", "notify", "mqtt", "wifi", "ota"
+};
+
+static Preferences store;
+static Settings settings;             // RAM copy, guarded by settingsMux
+static SettingsBlob blob;             // Commit buffer, guarded by commitMutex
+static portMUX_TYPE settingsMux = portMUX_INITIALIZER_UNLOCKED;
+static SemaphoreHandle_t commitMutex = nullptr;
+static bool storeOpen = false;
+
+// Dirty tracking (guarded by settingsMux)
+static uint32_t dirtyMask = 0;
+static unsigned long firstChangeMs = 0;
+static unsigned long lastChangeMs = 0;
+
+static SettingsStats stats;
+
+static void applyDefaults(Settings& s) {
+  memset(&s, 0, sizeof(s));
+
+  strlcpy(s.system.printerIP, "192.168.1.100", sizeof(s.system.printerIP));
+  s.system.printerPort = 80;
+
+  s.motionTimeout = MOTION_TIMEOUT;
+  s.autoPause = true;
+  s.switchDirect = true;
+
+  strlcpy(s.sinks.mqttTopic, "centauri/notify", sizeof(s.sinks.mqttTopic));
+
+  s.mqtt.port = MQTT_DEFAULT_PORT;
+  strlcpy(s.mqtt.discoveryPrefix, "homeassistant", sizeof(s.mqtt.discoveryPrefix));
+}
+
+// ========== Legacy Migration ==========
+
+static void readString(Preferences& prefs, const char* key, char* out, size_t size) {
+  if (prefs.isKey(key)) {
+    prefs.getString(key, out, size);
+  }
+}
+
+// Read the per-module namespaces used by earlier firmware. Returns true
+// if any of them existed.
+static bool readLegacyNamespaces(Settings& s) {
+  Preferences prefs;
+  bool found = false;
+
+  if (prefs.begin("system", true)) {
+    if (prefs.getBool("configured", false)) {
+      readString(prefs, "wifiSSID", s.system.wifiSSID, sizeof(s.system.wifiSSID));
+      readString(prefs, "wifiPass", s.system.wifiPassword, sizeof(s.system.wifiPassword));
+      readString(prefs, "printerIP", s.system.printerIP, sizeof(s.system.printerIP));
+      s.system.printerPort = prefs.getInt("printerPort", 80);
+      s.system.configured = true;
+      found = true;
+    }
+    prefs.end();
+  }
+
+  if (prefs.begin("filament", true)) {
+    s.motionTimeout = prefs.getULong("motionTimeout", MOTION_TIMEOUT);
+    s.autoPause = prefs.getBool("autoPause", true);
+    s.switchDirect = prefs.getBool("switchDirect", true);
+    prefs.end();
+    found = true;
+  }
+
+  if (prefs.begin("callmebot", true)) {
+    s.callmebotEnabled = prefs.getBool("enabled", false);
+    readString(prefs, "phone", s.callmebotPhone, sizeof(s.callmebotPhone));
+    readString(prefs, "apiKey", s.callmebotApiKey, sizeof(s.callmebotApiKey));
+    prefs.end();
+    found = true;
+  }
+
+  return found;
+}
+
+static void clearLegacyNamespaces() {
+  static const char* const namespaces[] = { "system", "filament", "callmebot" };
+  Preferences prefs;
+
+  for (const char* name : namespaces) {
+    if (prefs.begin(name, false)) {
+      prefs.clear();
+      prefs.end();
+    }
+  }
+}
+
+// ========== Blob ==========
+
+// Copy a verified blob payload into settings. Payloads of the current
+// version are copied as is (appended fields keep their defaults). When
+// SETTINGS_VERSION is bumped, add a case for the previous version that
+// reads its layout from payload and fills settings field by field, so
+// devices keep their WiFi and other settings across the change.
+static bool decodeSettings(uint16_t version, const uint8_t* payload, size_t length) {
+  switch (version) {
+    case SETTINGS_VERSION:
+      memcpy(&settings, payload, min(length, sizeof(Settings)));
+      return true;
+
+    default:
+      return false;
+  }
+}
+
+// Load the blob into settings. Older (shorter) blobs keep defaults for the
+// missing tail; newer (longer) ones are truncated.
+static bool loadBlob() {
+  size_t length = store.getBytesLength(SETTINGS_KEY);
+  if (length < sizeof(SettingsHeader)) {
+    return false;
+  }
+
+  uint8_t* buffer = (uint8_t*)malloc(length);
+  if (!buffer) {
+    return false;
+  }
+
+  bool ok = false;
+  if (store.getBytes(SETTINGS_KEY, buffer, length) == length) {
+    SettingsHeader header;
+    memcpy(&header, buffer, sizeof(header));
+    const uint8_t* payload = buffer + sizeof(header);
+    size_t payloadLength = length - sizeof(header);
+
+    if (header.magic != SETTINGS_MAGIC || header.size != payloadLength) {
+      Serial.println("[SETTINGS] ⚠️ Blob header invalid");
+    } else if (esp_rom_crc32_le(0, payload, payloadLength) != header.crc) {
+      Serial.println("[SETTINGS] ⚠️ Blob CRC mismatch");
+    } else if (!decodeSettings(header.version, payload, payloadLength)) {
+      Serial.printf("[SETTINGS] ⚠️ Blob version %u not supported (expected %u)\n",
+                    header.version, SETTINGS_VERSION);
+    } else {
+      if (header.version != SETTINGS_VERSION) {
+        Serial.printf("[SETTINGS] Upgraded blob from version %u to %u\n", header.version, SETTINGS_VERSION);
+        dirtyMask = (1u << SETTINGS_SECTION_COUNT) - 1;  // Rewrite in the current layout
+      }
+      stats.lifetimeCommits = header.commitCount;
+      ok = true;
+    }
+  }
+
+  free(buffer);
+  return ok;
+}
+
+// Write the RAM copy if it has pending changes. Returns false on NVS errors.
+static bool commitSettings() {
+  if (!storeOpen || !commitMutex) {
+    return false;
+  }
+  xSemaphoreTake(commitMutex, portMAX_DELAY);
+
+  portENTER_CRITICAL(&settingsMux);
+  uint32_t mask = dirtyMask;
+  if (mask) {
+    blob.settings = settings;
+    dirtyMask = 0;
+  }
+  portEXIT_CRITICAL(&settingsMux);
+
+  if (!mask) {
+    xSemaphoreGive(commitMutex);
+    return true;
+  }
+
+  blob.header.magic = SETTINGS_MAGIC;
+  blob.header.version = SETTINGS_VERSION;
+  blob.header.size = sizeof(Settings);
+  blob.header.crc = esp_rom_crc32_le(0, (const uint8_t*)&blob.settings, sizeof(Settings));
+  blob.header.commitCount = stats.lifetimeCommits + 1;
+
+  bool ok = store.putBytes(SETTINGS_KEY, &blob, sizeof(blob)) == sizeof(blob);
+
+  if (ok) {
+    stats.lifetimeCommits++;
+    stats.commits++;
+    metricsIncrement(METRIC_SETTINGS_COMMITS);
+
+    char sections[64] = "";
+    for (int i = 0; i < SETTINGS_SECTION_COUNT; i++) {
+      if (mask & (1u << i)) {
+        if (sections[0]) strlcat(sections, ", ", sizeof(sections));
+        strlcat(sections, sectionNames[i], sizeof(sections));
+      }
+    }
+    Serial.printf("[SETTINGS] Committed %s (%u bytes, commit #%lu)\n",
+                  sections, (unsigned)sizeof(blob), (unsigned long)stats.lifetimeCommits);
+  } else {
+    // Keep the changes pending and try again after the debounce delay
+    portENTER_CRITICAL(&settingsMux);
+    dirtyMask |= mask;
+    lastChangeMs = millis();
+    portEXIT_CRITICAL(&settingsMux);
+    Serial.println("[SETTINGS] ❌ Commit failed");
+  }
+
+  xSemaphoreGive(commitMutex);
+  return ok;
+}
+
+static void shutdownHandler() {
+  commitSettings();
+}
+
+// ========== Public API ==========
+
+void setupSettingsStore() {
+  commitMutex = xSemaphoreCreateMutex();
+  applyDefaults(settings);
+  stats.blobSize = sizeof(SettingsBlob);
+
+  storeOpen = store.begin(SETTINGS_NAMESPACE, false);
+  if (!storeOpen) {
+    Serial.println("[SETTINGS] ERROR: Failed to open NVS namespace, using defaults");
+    return;
+  }
+
+  unsigned long start = micros();
+  if (loadBlob()) {
+    Serial.printf("[SETTINGS] Loaded %u bytes in %lu us (%lu lifetime commits)\n",
+                  (unsigned)sizeof(SettingsBlob), (unsigned long)(micros() - start),
+                  (unsigned long)stats.lifetimeCommits);
+  } else if (readLegacyNamespaces(settings)) {
+    // One-time migration from the per-module namespaces
+    stats.migrated = true;
+    dirtyMask = (1u << SETTINGS_SECTION_COUNT) - 1;
+    if (commitSettings()) {
+      clearLegacyNamespaces();
+      Serial.println("[SETTINGS] ✓ Migrated legacy namespaces to settings blob");
+    }
+  } else {
+    Serial.println("[SETTINGS] No stored settings, using defaults");
+  }
+
+  esp_register_shutdown_handler(shutdownHandler);
+}
+
+void handleSettingsStore() {
+  if (!dirtyMask) {
+    return;
+  }
+
+  unsigned long now = millis();
+  if (now - lastChangeMs >= SETTINGS_COMMIT_DELAY_MS || now - firstChangeMs >= SETTINGS_MAX_DELAY_MS) {
+    commitSettings();
+  }
+}
+
+const Settings& getSettings() {
+  return settings;
+}
+
+Settings& beginSettingsUpdate() {
+  portENTER_CRITICAL(&settingsMux);
+  return settings;
+}
+
+void endSettingsUpdate(SettingsSection section) {
+  unsigned long now = millis();
+  if (!dirtyMask) {
+    firstChangeMs = now;
+  }
+  dirtyMask |= 1u << section;
+  lastChangeMs = now;
+  stats.changes++;
+  stats.sectionChanges[section]++;
+  portEXIT_CRITICAL(&settingsMux);
+
+  metricsIncrement(METRIC_SETTINGS_CHANGES);
+
+  // WiFi/printer settings are usually followed by a restart, the OTA trial
+  // must survive a crash of the new image - write them now
+  if (section == SETTINGS_SYSTEM || section == SETTINGS_OTA) {
+    commitSettings();
+  }
+}
+
+void flushSettings() {
+  commitSettings();
+}
+
+SettingsStats getSettingsStats() {
+  portENTER_CRITICAL(&settingsMux);
+  SettingsStats copy = stats;
+  copy.pending = dirtyMask != 0;
+  portEXIT_CRITICAL(&settingsMux);
+  return copy;
+}
+
+const char* getSettingsSectionName(SettingsSection section) {
+  return section >= 0 && section < SETTINGS_SECTION_COUNT ? sectionNames[section] : "unknown";
+}
@@ -0,0 +1,98 @@
+/*
+ * Settings Store
+ * One typed in-RAM copy of all persistent settings, stored in NVS as a
+ * single versioned, CRC-checked blob. Changes are tracked per section and
+ * committed in debounced batches; system settings commit immediately.
+ */
+
+#ifndef SETTINGS_STORE_H
+#define SETTINGS_STORE_H
+
+#include <Arduino.h>
+#include "config_manager.h"
+#include "notification_sinks.h"
+#include "mqtt_client.h"
+#include "wifi_manager.h"
+#include "ota_health.h"
+
+// ========== Settings Store Configuration ==========
+#define SETTINGS_VERSION 1               // Bump only for incompatible changes (appending is compatible), see decodeSettings()
+#define SETTINGS_COMMIT_DELAY_MS 5000    // Commit this long after the last change
+#define SETTINGS_MAX_DELAY_MS 30000      // ...but at the latest this long after the first one
+
+// Sections for dirty tracking and statistics
+enum SettingsSection {
+  SETTINGS_SYSTEM,      // WiFi and printer - committed immediately
+  SETTINGS_FILAMENT,
+  SETTINGS_CALLMEBOT,
+  SETTINGS_NOTIFY,
+  SETTINGS_MQTT,
+  SETTINGS_WIFI,        // Access point cache, rewritten only when it changes
+  SETTINGS_OTA,         // Update trial record - committed immediately
+  SETTINGS_SECTION_COUNT
+};
+
+// All persistent settings. New fields are only appended so that blobs
+// written by older firmware still load (missing tail = defaults).
+struct Settings {
+  // System
+  SystemConfig system;
+
+  // Filament sensor
+  uint32_t motionTimeout;
+  bool autoPause;
+  bool switchDirect;
+
+  // CallMeBot
+  bool callmebotEnabled;
+  char callmebotPhone[24];
+  char callmebotApiKey[32];
+
+  // Notification sinks
+  NotificationSinkConfig sinks;
+
+  // MQTT status client
+  MqttConfig mqtt;
+
+  // WiFi fast-connect cache
+  WiFiCache wifiCache;
+
+  // OTA health gate trial
+  OTATrial otaTrial;
+};
+
+struct SettingsStats {
+  uint32_t lifetimeCommits;   // Blob writes over the device lifetime (stored in the blob)
+  uint32_t commits;           // Blob writes since boot
+  uint32_t changes;           // Section updates since boot
+  uint32_t sectionChanges[SETTINGS_SECTION_COUNT];
+  uint32_t blobSize;          // Bytes per commit
+  bool pending;               // Uncommitted changes in RAM
+  bool migrated;              // Loaded from the legacy per-module namespaces at this boot
+};
+
+// Load the blob (or migrate the legacy namespaces). Call first in setup().
+void setupSettingsStore();
+
+// Commit pending changes once the debounce delay has passed (call every loop)
+void handleSettingsStore();
+
+// Read-only view of the RAM copy
+const Settings& getSettings();
+
+// Change settings: beginSettingsUpdate() locks and returns the RAM copy,
+// endSettingsUpdate() unlocks, marks the section dirty and schedules (or,
+// for SETTINGS_SYSTEM, performs) the commit. Keep the code in between short.
+Settings& beginSettingsUpdate();
+void endSettingsUpdate(SettingsSection section);
+
+// Write pending changes now (also runs automatically before a restart)
+void flushSettings();
+
+// Write counters
+SettingsStats getSettingsStats();
+
+// Section name for logs and APIs
+const char* getSettingsSectionName(SettingsSection section);
+
+#endif // SETTINGS_STORE_H
@@ -0,0 +1,181 @@
+/*
+ * Task Monitor Implementation
+ *
+ * CPU shares are computed from the run-time counters of two consecutive
+ * snapshots (any caller), so /api/tasks polled every few seconds shows the
+ * load of that window rather than the average since boot.
+ */
+
+#include "task_monitor.h"
+#include "logger.h"
+#include "notifier.h"
+#include "mqtt_client.h"
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+// Previous run-time counters, keyed by the FreeRTOS task number
+static UBaseType_t previousNumbers[TASK_MONITOR_MAX_TASKS];
+static configRUN_TIME_COUNTER_TYPE previousRuntimes[TASK_MONITOR_MAX_TASKS];
+static int previousCount = 0;
+static configRUN_TIME_COUNTER_TYPE previousTotal = 0;
+static uint32_t previousMs = 0;
+static portMUX_TYPE previousMux = portMUX_INITIALIZER_UNLOCKED;
+
+// Stack sizes of tasks created with a known size
+static uint32_t configuredStackSize(const char* name) {
+  if (strcmp(name, "loopTask") == 0) {
+    return getArduinoLoopTaskStackSize();
+  }
+  if (strcmp(name, "notifier") == 0) {
+    return NOTIFY_TASK_STACK;
+  }
+  if (strcmp(name, "logger") == 0) {
+    return LOG_TASK_STACK;
+  }
+  if (strcmp(name, "mqtt") == 0) {
+    return MQTT_TASK_STACK;
+  }
+  return 0;
+}
+
+static char stateChar(eTaskState state) {
+  switch (state) {
+    case eRunning: return 'X';
+    case eReady: return 'R';
+    case eBlocked: return 'B';
+    case eSuspended: return 'S';
+    case eDeleted: return 'D';
+    default: return '?';
+  }
+}
+
+bool takeTaskSnapshot(TaskSnapshot& snapshot) {
+  snapshot.count = 0;
+  snapshot.intervalMs = 0;
+#if configGENERATE_RUN_TIME_STATS
+  snapshot.runtimeStats = true;
+#else
+  snapshot.runtimeStats = false;
+#endif
+
+#if configUSE_TRACE_FACILITY
+  // A few spare entries for tasks created while the list is taken
+  UBaseType_t capacity = uxTaskGetNumberOfTasks() + 4;
+  TaskStatus_t* status = (TaskStatus_t*)malloc(capacity * sizeof(TaskStatus_t));
+  if (!status) {
+    return false;
+  }
+  configRUN_TIME_COUNTER_TYPE total = 0;
+  UBaseType_t count = uxTaskGetSystemState(status, capacity, &total);
+  uint32_t now = millis();
+
+  // Highest priority first, ties by name
+  for (UBaseType_t i = 1; i < count; i++) {
+    TaskStatus_t current = status[i];
+    UBaseType_t j = i;
+    while (j > 0 && (status[j - 1].uxCurrentPriority < current.uxCurrentPriority ||
+                     (status[j - 1].uxCurrentPriority == current.uxCurrentPriority &&
+                      strcmp(status[j - 1].pcTaskName, current.pcTaskName) > 0))) {
+      status[j] = status[j - 1];
+      j--;
+    }
+    status[j] = current;
+  }
+
+  // The spinlock masks interrupts, so it only guards copying the previous
+  // counters in and out; names and soft-float shares are computed outside
+  UBaseType_t lastNumbers[TASK_MONITOR_MAX_TASKS];
+  configRUN_TIME_COUNTER_TYPE lastRuntimes[TASK_MONITOR_MAX_TASKS];
+  portENTER_CRITICAL(&previousMux);
+  int lastCount = previousCount;
+  memcpy(lastNumbers, previousNumbers, sizeof(lastNumbers));
+  memcpy(lastRuntimes, previousRuntimes, sizeof(lastRuntimes));
+  configRUN_TIME_COUNTER_TYPE totalDelta = total - previousTotal;
+  uint32_t lastMs = previousMs;
+  portEXIT_CRITICAL(&previousMux);
+
+  snapshot.intervalMs = lastMs ? now - lastMs : now;
+
+  UBaseType_t nextNumbers[TASK_MONITOR_MAX_TASKS];
+  configRUN_TIME_COUNTER_TYPE nextRuntimes[TASK_MONITOR_MAX_TASKS] = {};
+  int nextCount = 0;
+
+  for (UBaseType_t i = 0; i < count && snapshot.count < TASK_MONITOR_MAX_TASKS; i++) {
+    const TaskStatus_t& task = status[i];
+    TaskInfo& info = snapshot.tasks[snapshot.count++];
+    strlcpy(info.name, task.pcTaskName, sizeof(info.name));
+    info.priority = task.uxCurrentPriority;
+    info.basePriority = task.uxBasePriority;
+    info.state = stateChar(task.eCurrentState);
+    info.stackFreeMin = task.usStackHighWaterMark;   // ESP-IDF counts stack in bytes
+    info.stackSize = configuredStackSize(task.pcTaskName);
+    info.cpuPercent = -1;
+    info.cpuTotalPercent = -1;
+
+#if configGENERATE_RUN_TIME_STATS
+    configRUN_TIME_COUNTER_TYPE previous = 0;
+    for (int p = 0; p < lastCount; p++) {
+      if (lastNumbers[p] == task.xTaskNumber) {
+        previous = lastRuntimes[p];
+        break;
+      }
+    }
+    if (total > 0) {
+      info.cpuTotalPercent = 100.0f * task.ulRunTimeCounter / total;
+    }
+    if (totalDelta > 0) {
+      info.cpuPercent = 100.0f * (configRUN_TIME_COUNTER_TYPE)(task.ulRunTimeCounter - previous) / totalDelta;
+    }
+    nextRuntimes[nextCount] = task.ulRunTimeCounter;
+#endif
+    nextNumbers[nextCount++] = task.xTaskNumber;
+  }
+
+  // Remember the counters for the next snapshot
+  portENTER_CRITICAL(&previousMux);
+  memcpy(previousNumbers, nextNumbers, nextCount * sizeof(nextNumbers[0]));
+  memcpy(previousRuntimes, nextRuntimes, nextCount * sizeof(nextRuntimes[0]));
+  previousCount = nextCount;
+  previousTotal = total;
+  previousMs = now;
+  portEXIT_CRITICAL(&previousMux);
+
+  free(status);
+  return true;
+#else
+  return false;
+#endif
+}
+
+void printTaskStats() {
+  TaskSnapshot* snapshot = new TaskSnapshot;
+  if (!takeTaskSnapshot(*snapshot)) {
+    Serial.println("[TASKS] Task list not available (FreeRTOS built without trace facility)");
+    delete snapshot;
+    return;
+  }
+
+  Serial.printf("\n--- Tasks (%d, CPU over the last %lu ms) ---\n", snapshot->count,
+                (unsigned long)snapshot->intervalMs);
+  Serial.println("Name             Prio  St    CPU  Total  StackFree  StackSize");
+  for (int i = 0; i < snapshot->count; i++) {
+    const TaskInfo& task = snapshot->tasks[i];
+    char cpu[8] = "-";
+    char total[8] = "-";
+    if (task.cpuPercent >= 0) {
+      snprintf(cpu, sizeof(cpu), "%.1f%%", task.cpuPercent);
+      snprintf(total, sizeof(total), "%.1f%%", task.cpuTotalPercent);
+    }
+    char size[12] = "?";
+    if (task.stackSize) {
+      snprintf(size, sizeof(size), "%lu", (unsigned long)task.stackSize);
+    }
+    Serial.printf("%-16s %2u/%-2u  %c  %6s %6s  %9lu  %9s%s\n", task.name, task.priority, task.basePriority,
+                  task.state, cpu, total, (unsigned long)task.stackFreeMin, size,
+                  task.stackFreeMin < TASK_STACK_LOW_BYTES ? "  ⚠️ low" : "");
+  }
+  if (!snapshot->runtimeStats) {
+    Serial.println("CPU shares need CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS (see /api/profile for task shares)");
+  }
+  delete snapshot;
+}
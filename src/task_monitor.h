@@ -0,0 +1,43 @@
+/*
+ * Task Monitor
+ * Per-task CPU share (FreeRTOS run-time stats), stack high-water marks
+ * and priorities of all tasks: loopTask, async_tcp, the WiFi/lwIP tasks
+ * and the firmware's own tasks. Served at /api/tasks and by the 'tasks'
+ * console command.
+ */
+
+#ifndef TASK_MONITOR_H
+#define TASK_MONITOR_H
+
+#include <Arduino.h>
+
+// ========== Task Monitor Configuration ==========
+#define TASK_MONITOR_MAX_TASKS 24
+#define TASK_STACK_LOW_BYTES 512          // Less free stack than this is flagged
+
+struct TaskInfo {
+  char name[configMAX_TASK_NAME_LEN];
+  uint8_t priority;                       // Current (may be raised by mutex inheritance)
+  uint8_t basePriority;
+  char state;                             // X running, R ready, B blocked, S suspended, D deleted
+  uint32_t stackFreeMin;                  // Least free stack since the task started (bytes)
+  uint32_t stackSize;                     // Configured stack size, 0 if not known
+  float cpuPercent;                       // Since the previous snapshot, -1 without run-time stats
+  float cpuTotalPercent;                  // Since boot, -1 without run-time stats
+};
+
+struct TaskSnapshot {
+  bool runtimeStats;                      // CPU shares available in this build
+  uint32_t intervalMs;                    // Time covered by cpuPercent
+  int count;
+  TaskInfo tasks[TASK_MONITOR_MAX_TASKS]; // Sorted by priority, highest first
+};
+
+// Fill snapshot with the current task list; false if the FreeRTOS build
+// has no trace facility
+bool takeTaskSnapshot(TaskSnapshot& snapshot);
+
+// Print a task table to Serial
+void printTaskStats();
+
+#endif // TASK_MONITOR_H
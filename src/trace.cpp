@@ -0,0 +1,236 @@
+/*
+ * Span Tracer Implementation
+ *
+ * Same ring scheme as the logger: one atomic increment reserves a slot,
+ * storing seq + 1 publishes it, the exporter re-checks the state after
+ * copying. Spans are stored as complete events when they end, so a
+ * partly overwritten ring never leaves unmatched begin/end pairs.
+ */
+
+#include "trace.h"
+#include <atomic>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+#define TRACE_RING_MASK (TRACE_RING_EVENTS - 1)
+
+struct TraceSlot {
+  std::atomic<uint32_t> state;         // seq + 1 once published, 0 while being written
+  TraceEvent event;
+};
+
+static TraceSlot ring[TRACE_RING_EVENTS];
+static std::atomic<uint32_t> nextSeq(0);
+static uint32_t clearedSeq = 0;
+static volatile uint32_t minSpanUs = TRACE_MIN_SPAN_US;
+
+// Tasks seen so far (index + 1 is the task number in events)
+static TaskHandle_t taskHandles[TRACE_MAX_TASKS];
+static char taskNames[TRACE_MAX_TASKS][configMAX_TASK_NAME_LEN];
+static std::atomic<int> taskCount(0);
+static portMUX_TYPE taskMux = portMUX_INITIALIZER_UNLOCKED;
+
+static uint8_t currentTask() {
+  if (xPortInIsrContext()) {
+    return TRACE_TASK_ISR;
+  }
+
+  TaskHandle_t self = xTaskGetCurrentTaskHandle();
+  int count = taskCount.load(std::memory_order_acquire);
+  for (int i = 0; i < count; i++) {
+    if (taskHandles[i] == self) {
+      return i + 1;
+    }
+  }
+
+  // First event from this task: remember its name for the timeline row
+  uint8_t task = TRACE_TASK_OTHER;
+  portENTER_CRITICAL(&taskMux);
+  count = taskCount.load(std::memory_order_relaxed);
+  if (count < TRACE_MAX_TASKS) {
+    taskHandles[count] = self;
+    strlcpy(taskNames[count], pcTaskGetName(self), sizeof(taskNames[count]));
+    taskCount.store(count + 1, std::memory_order_release);
+    task = count + 1;
+  }
+  portEXIT_CRITICAL(&taskMux);
+  return task;
+}
+
+static void IRAM_ATTR writeEvent(uint32_t startUs, uint32_t durationUs, const char* category,
+                                 const char* name, uint8_t task, char phase) {
+  uint32_t seq = nextSeq.fetch_add(1, std::memory_order_relaxed);
+  TraceSlot& slot = ring[seq & TRACE_RING_MASK];
+
+  slot.state.store(0, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+
+  slot.event.startUs = startUs;
+  slot.event.durationUs = durationUs;
+  slot.event.category = category;
+  slot.event.name = name;
+  slot.event.task = task;
+  slot.event.phase = phase;
+
+  slot.state.store(seq + 1, std::memory_order_release);
+}
+
+void traceEnd(const TraceSpan& span) {
+  uint32_t duration = traceNow() - span.startUs;
+  if (duration < minSpanUs) {
+    return;
+  }
+  writeEvent(span.startUs, duration, span.category, span.name, currentTask(), 'X');
+}
+
+void IRAM_ATTR traceInstant(const char* category, const char* name) {
+  // Interrupt handlers all share the ISR row
+  uint8_t task = xPortInIsrContext() ? TRACE_TASK_ISR : currentTask();
+  writeEvent(traceNow(), 0, category, name, task, 'i');
+}
+
+void setTraceMinSpanUs(uint32_t us) {
+  minSpanUs = us;
+}
+
+uint32_t getTraceMinSpanUs() {
+  return minSpanUs;
+}
+
+void clearTrace() {
+  clearedSeq = nextSeq.load(std::memory_order_acquire);
+}
+
+uint32_t getTraceEventCount() {
+  return nextSeq.load(std::memory_order_relaxed);
+}
+
+// Copy a published slot; false if it holds another sequence number or was
+// overwritten during the copy
+static bool readEvent(uint32_t seq, TraceEvent& event) {
+  TraceSlot& slot = ring[seq & TRACE_RING_MASK];
+  if (slot.state.load(std::memory_order_acquire) != seq + 1) {
+    return false;
+  }
+  event = slot.event;
+  std::atomic_thread_fence(std::memory_order_acquire);
+  return slot.state.load(std::memory_order_relaxed) == seq + 1;
+}
+
+// ========== Chrome Trace Export ==========
+
+enum TraceExportStage {
+  EXPORT_HEADER,
+  EXPORT_TASK_NAMES,
+  EXPORT_EVENTS,
+  EXPORT_FOOTER,
+  EXPORT_DONE
+};
+
+static const char* taskName(int task) {
+  if (task == TRACE_TASK_ISR) {
+    return "ISR";
+  }
+  if (task == TRACE_TASK_OTHER || task > taskCount.load(std::memory_order_acquire)) {
+    return "other";
+  }
+  return taskNames[task - 1];
+}
+
+void beginTraceExport(TraceExport& state) {
+  state.end = nextSeq.load(std::memory_order_acquire);
+  uint32_t oldest = state.end > TRACE_RING_EVENTS ? state.end - TRACE_RING_EVENTS : 0;
+  state.seq = clearedSeq > oldest ? clearedSeq : oldest;
+  state.nowUs = esp_timer_get_time();
+  state.task = TRACE_TASK_ISR;
+  state.stage = EXPORT_HEADER;
+  state.pendingLength = 0;
+  state.pendingPos = 0;
+}
+
+// Render the next piece into state.pending; false when nothing is left
+static bool renderNext(TraceExport& state) {
+  char* out = state.pending;
+  size_t size = sizeof(state.pending);
+  int length = 0;
+
+  while (length == 0) {
+    switch (state.stage) {
+      case EXPORT_HEADER:
+        length = snprintf(out, size, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":["
+                          "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"CC Monitor\"}}");
+        state.stage = EXPORT_TASK_NAMES;
+        break;
+
+      case EXPORT_TASK_NAMES:
+        if (state.task > taskCount.load(std::memory_order_acquire)) {
+          // Row for events from tasks beyond TRACE_MAX_TASKS
+          length = snprintf(out, size, ",{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,"
+                            "\"args\":{\"name\":\"other\"}}", TRACE_TASK_OTHER);
+          state.stage = EXPORT_EVENTS;
+          break;
+        }
+        length = snprintf(out, size, ",{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,"
+                          "\"args\":{\"name\":\"%s\"}}", state.task, taskName(state.task));
+        state.task++;
+        break;
+
+      case EXPORT_EVENTS: {
+        if (state.seq == state.end) {
+          state.stage = EXPORT_FOOTER;
+          break;
+        }
+        TraceEvent event;
+        uint32_t seq = state.seq++;
+        if (!readEvent(seq, event)) {
+          break;   // Overwritten since the export started
+        }
+        // Restore the 64-bit timestamp (events are younger than the 71 min wrap)
+        int64_t ts = state.nowUs - (int64_t)(uint32_t)((uint32_t)state.nowUs - event.startUs);
+        if (event.phase == 'X') {
+          length = snprintf(out, size, ",{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"ts\":%lld,\"dur\":%lu,"
+                            "\"pid\":1,\"tid\":%u}", event.name, event.category, (long long)ts,
+                            (unsigned long)event.durationUs, event.task);
+        } else {
+          length = snprintf(out, size, ",{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"i\",\"s\":\"t\",\"ts\":%lld,"
+                            "\"pid\":1,\"tid\":%u}", event.name, event.category, (long long)ts,
+                            event.task);
+        }
+        break;
+      }
+
+      case EXPORT_FOOTER:
+        length = snprintf(out, size, "],\"otherData\":{\"minSpanUs\":%lu,\"recorded\":%lu}}",
+                          (unsigned long)minSpanUs, (unsigned long)state.end);
+        state.stage = EXPORT_DONE;
+        break;
+
+      default:
+        return false;
+    }
+  }
+
+  if (length >= (int)size) {
+    length = size - 1;   // Only possible with absurdly long names
+  }
+  state.pendingLength = length;
+  state.pendingPos = 0;
+  return true;
+}
+
+size_t readTraceExport(TraceExport& state, uint8_t* buffer, size_t maxLength) {
+  size_t written = 0;
+  while (written < maxLength) {
+    if (state.pendingPos == state.pendingLength && !renderNext(state)) {
+      break;
+    }
+    size_t chunk = state.pendingLength - state.pendingPos;
+    if (chunk > maxLength - written) {
+      chunk = maxLength - written;
+    }
+    memcpy(buffer + written, state.pending + state.pendingPos, chunk);
+    state.pendingPos += chunk;
+    written += chunk;
+  }
+  return written;
+}
@@ -0,0 +1,102 @@
+/*
+ * Span Tracer
+ * Timeline of spans (WebSocket parsing, commands, HTTP handlers, sensor
+ * checks, notification sends) and ISR instants in a fixed-size RAM ring,
+ * tagged with the task they ran in. Served at /api/trace as Chrome
+ * trace-event JSON for chrome://tracing or ui.perfetto.dev.
+ */
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <Arduino.h>
+#include <esp_timer.h>
+
+// ========== Trace Configuration ==========
+#ifndef TRACE_ENABLED
+#define TRACE_ENABLED 1                // 0 compiles all TRACE_* macros to nothing
+#endif
+#define TRACE_RING_EVENTS 256          // Events kept in RAM (power of two)
+#define TRACE_MAX_TASKS 12             // Tasks with their own timeline row
+#define TRACE_MIN_SPAN_US 100          // Default: shorter spans are not recorded (/api/trace?minUs=)
+
+// Task index of events recorded in interrupt context
+#define TRACE_TASK_ISR 0
+// Task index once TRACE_MAX_TASKS tasks are known
+#define TRACE_TASK_OTHER 0xFF
+
+// One recorded event
+struct TraceEvent {
+  uint32_t startUs;                    // esp_timer time, low 32 bits
+  uint32_t durationUs;                 // 0 for instants
+  const char* category;                // String literals
+  const char* name;
+  uint8_t task;                        // TRACE_TASK_ISR, 1..TRACE_MAX_TASKS or TRACE_TASK_OTHER
+  char phase;                          // 'X' complete span, 'i' instant
+};
+
+// An open span (see TRACE_BEGIN)
+struct TraceSpan {
+  const char* category;
+  const char* name;
+  uint32_t startUs;
+};
+
+inline uint32_t traceNow() {
+  return (uint32_t)esp_timer_get_time();
+}
+
+// Record a span that ends now (dropped if shorter than the threshold)
+void traceEnd(const TraceSpan& span);
+
+// Record a point event (safe from ISRs)
+void traceInstant(const char* category, const char* name);
+
+class TraceScope {
+public:
+  TraceScope(const char* category, const char* name) : span{ category, name, traceNow() } {}
+  ~TraceScope() { traceEnd(span); }
+private:
+  TraceSpan span;
+};
+
+#if TRACE_ENABLED
+#define TRACE_BEGIN(span, category, name) TraceSpan span = { category, name, traceNow() }
+#define TRACE_END(span) traceEnd(span)
+#define TRACE_SCOPE(category, name) TraceScope traceScope_(category, name)
+#define TRACE_INSTANT(category, name) traceInstant(category, name)
+#else
+#define TRACE_BEGIN(span, category, name) do {} while (0)
+#define TRACE_END(span) do {} while (0)
+#define TRACE_SCOPE(category, name) do {} while (0)
+#define TRACE_INSTANT(category, name) do {} while (0)
+#endif
+
+// Spans shorter than this are not recorded (instants always are)
+void setTraceMinSpanUs(uint32_t us);
+uint32_t getTraceMinSpanUs();
+
+// Forget all recorded events
+void clearTrace();
+
+// Events recorded since boot (including overwritten ones)
+uint32_t getTraceEventCount();
+
+// Chrome trace-event JSON, produced piece by piece for a chunked response
+struct TraceExport {
+  uint32_t seq;                        // Next event to write
+  uint32_t end;                        // Events recorded when the export started
+  int64_t nowUs;                       // Reference for restoring 64-bit timestamps
+  int task;                            // Next timeline row name to write
+  uint8_t stage;
+  char pending[192];                   // Rendered text not yet handed out
+  uint16_t pendingLength;
+  uint16_t pendingPos;
+};
+
+void beginTraceExport(TraceExport& state);
+
+// Copy the next part of the document into buffer; 0 when complete
+size_t readTraceExport(TraceExport& state, uint8_t* buffer, size_t maxLength);
+
+#endif // TRACE_H
@@ -0,0 +1,43 @@
+/*
+ * URL Encoder Implementation
+ */
+
+#include "url_encode.h"
+
+static const char hexDigits[] = "0123456789ABCDEF";
+
+// Unreserved characters per RFC 3986, section 2.3
+static inline bool isUnreserved(unsigned char c) {
+  return (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z') || (c >= '0' && c <= '9') ||
+         c == '-' || c == '.' || c == '_' || c == '~';
+}
+
+size_t urlEncode(const char* in, char* out, size_t outSize) {
+  size_t needed = 0;
+  size_t written = 0;
+  bool full = outSize == 0;
+
+  for (const unsigned char* p = (const unsigned char*)in; *p; p++) {
+    unsigned char c = *p;
+    size_t length = isUnreserved(c) ? 1 : 3;
+    needed += length;
+
+    if (full || written + length >= outSize) {
+      full = true;
+      continue;
+    }
+
+    if (length == 1) {
+      out[written++] = c;
+    } else {
+      out[written++] = '%';
+      out[written++] = hexDigits[c >> 4];
+      out[written++] = hexDigits[c & 0x0F];
+    }
+  }
+
+  if (outSize > 0) {
+    out[written] = '\0';
+  }
+  return needed;
+}
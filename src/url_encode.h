@@ -0,0 +1,22 @@
+/*
+ * URL Encoder
+ * RFC 3986 percent-encoding into a caller-provided buffer in one pass.
+ * Plain C, no Arduino dependency (also built by tools/bench_url_encode.cpp).
+ */
+
+#ifndef URL_ENCODE_H
+#define URL_ENCODE_H
+
+#include <stddef.h>
+
+// Worst-case encoded size (incl. terminator) for an input of the given length
+#define URL_ENCODED_SIZE(length) ((length) * 3 + 1)
+
+// Percent-encode everything except the unreserved set (A-Z a-z 0-9 - . _ ~).
+// UTF-8 sequences (umlauts, emoji) are encoded byte by byte.
+// Like snprintf, returns the length the full encoding needs; the output is
+// always terminated and never ends in a partial %XX escape. A return value
+// >= outSize means the output was truncated.
+size_t urlEncode(const char* in, char* out, size_t outSize);
+
+#endif // URL_ENCODE_H
@@ -0,0 +1,81 @@
+/*
+ * Warm Restart State Implementation
+ *
+ * The record lives in RTC_NOINIT memory: it survives software, watchdog
+ * and brownout resets, but is random after power-on. The magic, the
+ * struct size and a CRC make sure only a snapshot written by this
+ * firmware layout is restored (a new OTA image may move the section).
+ */
+
+#include "warm_restart.h"
+#include <esp_attr.h>
+#include <esp_rom_crc.h>
+#include <sys/time.h>
+
+#define WARM_RESTART_MAGIC 0x5741524D  // "WARM"
+
+struct RtcWarmRecord {
+  uint32_t magic;
+  uint32_t size;
+  uint32_t crc;
+  WarmRestartState state;
+};
+
+RTC_NOINIT_ATTR static RtcWarmRecord rtcRecord;
+
+static WarmRestartState restored;
+static bool restoredValid = false;
+
+static uint32_t stateCrc(const WarmRestartState& state) {
+  return esp_rom_crc32_le(0, (const uint8_t*)&state, sizeof(state));
+}
+
+static void sealRecord() {
+  rtcRecord.magic = WARM_RESTART_MAGIC;
+  rtcRecord.size = sizeof(WarmRestartState);
+  rtcRecord.crc = stateCrc(rtcRecord.state);
+}
+
+int64_t warmRestartNowUs() {
+  // System time is derived from the RTC timer and survives software resets
+  struct timeval tv;
+  gettimeofday(&tv, nullptr);
+  return (int64_t)tv.tv_sec * 1000000LL + tv.tv_usec;
+}
+
+void setupWarmRestart() {
+  bool valid = rtcRecord.magic == WARM_RESTART_MAGIC &&
+               rtcRecord.size == sizeof(WarmRestartState) &&
+               rtcRecord.crc == stateCrc(rtcRecord.state);
+
+  if (valid) {
+    restored = rtcRecord.state;
+    restored.filename[sizeof(restored.filename) - 1] = '\0';
+    restoredValid = true;
+    Serial.printf("[WARM] ✓ Restored state: status %d, layer %ld/%ld, motion seen: %s\n",
+                  restored.printStatus, (long)restored.currentLayer, (long)restored.totalLayers,
+                  restored.motionDetectedThisPrint ? "yes" : "no");
+  } else {
+    // Power-on or a different firmware layout: start from a clean snapshot
+    memset(&rtcRecord.state, 0, sizeof(rtcRecord.state));
+    rtcRecord.state.printStatus = -1;
+    rtcRecord.state.lastPrintStatus = -1;
+    sealRecord();
+  }
+}
+
+const WarmRestartState* getRestoredState() {
+  return restoredValid ? &restored : nullptr;
+}
+
+const WarmRestartState& getWarmRestartState() {
+  return rtcRecord.state;
+}
+
+WarmRestartState& beginWarmRestartUpdate() {
+  return rtcRecord.state;
+}
+
+void endWarmRestartUpdate() {
+  sealRecord();
+}
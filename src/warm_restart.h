@@ -0,0 +1,46 @@
+/*
+ * Warm Restart State
+ * Small CRC-protected snapshot of the print and sensor state in RTC
+ * memory. After an OTA, watchdog reset or ESP.restart() the monitor
+ * restores it in setup() and keeps protecting a running print without
+ * waiting for a fresh print-start transition.
+ */
+
+#ifndef WARM_RESTART_H
+#define WARM_RESTART_H
+
+#include <Arduino.h>
+
+// ========== Warm Restart Configuration ==========
+#define WARM_RESTART_MAX_PRINT_S (7UL * 24 * 3600)  // Longer print durations are treated as clock errors
+#define WARM_RESTART_FILENAME_LEN 64
+
+struct WarmRestartState {
+  int16_t printStatus;            // Last printer status received
+  int16_t lastPrintStatus;        // Status last handled by checkStatusNotifications()
+  int32_t currentLayer;
+  int32_t totalLayers;
+  int64_t printStartUs;           // gettimeofday() time the print started, 0 = unknown
+  bool motionDetectedThisPrint;
+  bool filamentErrorDetected;
+  char filename[WARM_RESTART_FILENAME_LEN];
+};
+
+// Validate the RTC snapshot (call in setup() before the sensor is armed)
+void setupWarmRestart();
+
+// Snapshot restored at this boot (nullptr after power-on or if invalid)
+const WarmRestartState* getRestoredState();
+
+// Current snapshot
+const WarmRestartState& getWarmRestartState();
+
+// Change the snapshot between begin/end, end re-seals the CRC.
+// Only called from the loop task.
+WarmRestartState& beginWarmRestartUpdate();
+void endWarmRestartUpdate();
+
+// Time base that keeps running across software resets (microseconds)
+int64_t warmRestartNowUs();
+
+#endif // WARM_RESTART_H
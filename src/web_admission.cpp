@@ -0,0 +1,171 @@
+/*
+ * Web Admission Control Implementation
+ *
+ * All callbacks of the async web server run in the async_tcp task,
+ * so the tables below need no locking.
+ */
+
+#include "web_admission.h"
+#include "metrics.h"
+
+// Requests tracked until their client disconnects
+#define TRACKED_REJECTIONS 8
+#define TRACKED_REQUESTS (ADMISSION_MAX_CONCURRENT + ADMISSION_RESERVED_CONTROL + TRACKED_REJECTIONS)
+
+// Token bucket precision (tokens are stored in milli-tokens)
+#define TOKEN_SCALE 1000
+
+struct TrackedRequest {
+  AsyncWebServerRequest *request;
+  AdmissionResult result;
+  AdmissionClass admissionClass;
+};
+
+struct ClientBucket {
+  uint32_t ip;
+  uint32_t tokens;       // Milli-tokens
+  unsigned long lastRefill;
+  unsigned long lastSeen;
+};
+
+static TrackedRequest tracked[TRACKED_REQUESTS];
+static ClientBucket clients[ADMISSION_CLIENT_SLOTS];
+static int normalInFlight = 0;
+static int controlInFlight = 0;
+
+static TrackedRequest* findTracked(AsyncWebServerRequest *request) {
+  for (int i = 0; i < TRACKED_REQUESTS; i++) {
+    if (tracked[i].request == request) {
+      return &tracked[i];
+    }
+  }
+  return nullptr;
+}
+
+static void releaseRequest(AsyncWebServerRequest *request) {
+  TrackedRequest* entry = findTracked(request);
+  if (!entry) {
+    return;
+  }
+
+  if (entry->result == ADMISSION_ACCEPTED) {
+    if (entry->admissionClass == ADMISSION_CONTROL) {
+      controlInFlight--;
+    } else {
+      normalInFlight--;
+    }
+  }
+  entry->request = nullptr;
+}
+
+// Take one token from the client's bucket
+static bool takeToken(uint32_t ip) {
+  unsigned long now = millis();
+  ClientBucket* bucket = nullptr;
+  ClientBucket* oldest = &clients[0];
+
+  for (int i = 0; i < ADMISSION_CLIENT_SLOTS; i++) {
+    if (clients[i].ip == ip && clients[i].lastSeen != 0) {
+      bucket = &clients[i];
+      break;
+    }
+    if (clients[i].lastSeen < oldest->lastSeen) {
+      oldest = &clients[i];
+    }
+  }
+
+  if (!bucket) {
+    // New client (or evicted one) starts with a full bucket
+    bucket = oldest;
+    bucket->ip = ip;
+    bucket->tokens = ADMISSION_BURST * TOKEN_SCALE;
+    bucket->lastRefill = now;
+  }
+  bucket->lastSeen = now;
+
+  // Refill (capped at the time needed to fill an empty bucket)
+  unsigned long elapsed = min(now - bucket->lastRefill,
+                              (unsigned long)(ADMISSION_BURST * TOKEN_SCALE / ADMISSION_RATE_PER_SECOND));
+  uint32_t refill = elapsed * ADMISSION_RATE_PER_SECOND;  // ms * tokens/s = milli-tokens
+  if (refill > 0) {
+    bucket->tokens = min((uint32_t)(ADMISSION_BURST * TOKEN_SCALE), bucket->tokens + refill);
+    bucket->lastRefill = now;
+  }
+
+  if (bucket->tokens < TOKEN_SCALE) {
+    return false;
+  }
+  bucket->tokens -= TOKEN_SCALE;
+  return true;
+}
+
+static AdmissionResult decide(AsyncWebServerRequest *request, AdmissionClass admissionClass) {
+  if (admissionClass == ADMISSION_CONTROL) {
+    // Control requests may use the reserved lane and skip the rate limit
+    if (normalInFlight + controlInFlight >= ADMISSION_MAX_CONCURRENT + ADMISSION_RESERVED_CONTROL) {
+      return ADMISSION_OVERLOADED;
+    }
+    return ADMISSION_ACCEPTED;
+  }
+
+  if (normalInFlight >= ADMISSION_MAX_CONCURRENT) {
+    return ADMISSION_OVERLOADED;
+  }
+  if (!takeToken(request->client()->getRemoteAddress())) {
+    return ADMISSION_RATE_LIMITED;
+  }
+  return ADMISSION_ACCEPTED;
+}
+
+AdmissionResult admitRequest(AsyncWebServerRequest *request, AdmissionClass admissionClass, bool allowNew) {
+  TrackedRequest* entry = findTracked(request);
+  if (entry) {
+    return entry->result;
+  }
+  if (!allowNew) {
+    return ADMISSION_OVERLOADED;
+  }
+
+  AdmissionResult result = decide(request, admissionClass);
+
+  entry = findTracked(nullptr);
+  if (!entry) {
+    // Table full of rejected requests: reject without tracking
+    return result == ADMISSION_ACCEPTED ? ADMISSION_OVERLOADED : result;
+  }
+
+  entry->request = request;
+  entry->result = result;
+  entry->admissionClass = admissionClass;
+  request->onDisconnect([request]() { releaseRequest(request); });
+
+  if (result == ADMISSION_ACCEPTED) {
+    if (admissionClass == ADMISSION_CONTROL) {
+      controlInFlight++;
+    } else {
+      normalInFlight++;
+    }
+  }
+  return result;
+}
+
+void sendAdmissionRejection(AsyncWebServerRequest *request, AdmissionResult result) {
+  AsyncWebServerResponse *response;
+
+  if (result == ADMISSION_RATE_LIMITED) {
+    metricsIncrement(METRIC_HTTP_RATE_LIMITED);
+    response = request->beginResponse(429, "application/json",
+                                      "{\"success\":false,\"message\":\"Too many requests\"}");
+  } else {
+    metricsIncrement(METRIC_HTTP_OVERLOADED);
+    response = request->beginResponse(503, "application/json",
+                                      "{\"success\":false,\"message\":\"Server busy\"}");
+  }
+
+  response->addHeader("Retry-After", "1");
+  request->send(response);
+}
+
+int getRequestsInFlight() {
+  return normalInFlight + controlInFlight;
+}
@@ -0,0 +1,43 @@
+/*
+ * Web Admission Control
+ * Concurrent-request limit with a reserved lane for control actions
+ * and a per-client token bucket
+ */
+
+#ifndef WEB_ADMISSION_H
+#define WEB_ADMISSION_H
+
+#include <ESPAsyncWebServer.h>
+
+// Request classes
+enum AdmissionClass {
+  ADMISSION_NORMAL,   // Dashboard, status polling, settings, OTA
+  ADMISSION_CONTROL   // Printer control (pause, resume, ...) - never rate limited
+};
+
+// Admission decision
+enum AdmissionResult {
+  ADMISSION_ACCEPTED,
+  ADMISSION_OVERLOADED,    // Too many requests in flight -> 503
+  ADMISSION_RATE_LIMITED   // Client exceeded its token bucket -> 429
+};
+
+// ========== Admission Configuration ==========
+#define ADMISSION_MAX_CONCURRENT 4      // Normal requests in flight
+#define ADMISSION_RESERVED_CONTROL 2    // Extra slots only usable by control requests
+#define ADMISSION_RATE_PER_SECOND 5     // Token refill rate per client IP
+#define ADMISSION_BURST 20              // Token bucket size per client IP
+#define ADMISSION_CLIENT_SLOTS 8        // Tracked client IPs (least recently used is evicted)
+
+// Decide whether a request may be handled. Repeated calls for the same
+// request return the first decision. Pass allowNew = false for later body
+// chunks so a request rejected earlier is never admitted mid-stream.
+AdmissionResult admitRequest(AsyncWebServerRequest *request, AdmissionClass admissionClass, bool allowNew = true);
+
+// Send the 503/429 response for a rejected request
+void sendAdmissionRejection(AsyncWebServerRequest *request, AdmissionResult result);
+
+// Current number of admitted requests in flight
+int getRequestsInFlight();
+
+#endif // WEB_ADMISSION_H
@@ -13,7 +13,22 @@
 #include "printer_control.h"
 #include "filament_sensor.h"
 #include "ota_update.h"
+#include "ota_health.h"
 #include "callmebot.h"
+#include "notification_sinks.h"
+#include "mqtt_client.h"
+#include "wifi_manager.h"
+#include "metrics.h"
+#include "loop_profiler.h"
+#include "heap_monitor.h"
+#include "boot_profiler.h"
+#include "warm_restart.h"
+#include "power_manager.h"
+#include "web_admission.h"
+#include "logger.h"
+#include "trace.h"
+#include "sample_profiler.h"
+#include "task_monitor.h"
 #include <ArduinoJson.h>
 
 // Web server instance
@@ -21,9 +36,312 @@ static AsyncWebServer webServer(80);
 
 // Use getter functions instead of external variables
 
+// Set when the current OTA upload was refused (one upload at a time)
+static bool otaUploadRejected = false;
+
+static const char* methodName(WebRequestMethodComposite method) {
+  switch (method) {
+    case HTTP_GET: return "GET";
+    case HTTP_POST: return "POST";
+    case HTTP_PUT: return "PUT";
+    case HTTP_DELETE: return "DELETE";
+    default: return "OTHER";
+  }
+}
+
+// Scheme and host[:port] of a URL; drops user info, path and query,
+// which may carry tokens or secret topic names
+static String urlOrigin(const char* url) {
+  const char* scheme = strstr(url, "://");
+  const char* host = scheme ? scheme + 3 : url;
+  const char* end = host + strcspn(host, "/?#");
+  const char* at = (const char*)memchr(host, '@', end - host);
+
+  String origin;
+  if (scheme) {
+    origin.concat(url, host - url);
+  }
+  if (at) {
+    host = at + 1;
+  }
+  origin.concat(host, end - host);
+  return origin;
+}
+
+// Build the /api/status document
+void buildStatusDocument(JsonDocument& doc) {
+  // Status information
+  JsonObject status = doc["status"].to<JsonObject>();
+  status["state"] = printerStatus.printStatus;
+  status["stateText"] = getStatusText(printerStatus.printStatus);
+  status["position"] = printerStatus.currentCoord;
+  status["zOffset"] = printerStatus.zOffset;
+  status["lightOn"] = printerStatus.lightOn;
+  status["bedTemp"] = printerStatus.bedTemp;
+  status["bedTarget"] = printerStatus.bedTargetTemp;
+  status["nozzleTemp"] = printerStatus.nozzleTemp;
+  status["nozzleTarget"] = printerStatus.nozzleTargetTemp;
+  status["chamberTemp"] = printerStatus.chamberTemp;
+
+  // Print information
+  JsonObject print = doc["print"].to<JsonObject>();
+  print["progress"] = printerStatus.progress;
+  print["filename"] = printerStatus.filename;
+  print["layer"] = printerStatus.currentLayer;
+  print["totalLayers"] = printerStatus.totalLayers;
+  print["speed"] = printerStatus.printSpeed;
+
+  // Fan information
+  JsonObject fans = doc["fans"].to<JsonObject>();
+  fans["model"] = printerStatus.modelFan;
+  fans["aux"] = printerStatus.auxFan;
+  fans["box"] = printerStatus.boxFan;
+
+  // Filament sensor information
+  JsonObject sensor = doc["sensor"].to<JsonObject>();
+  sensor["error"] = isFilamentErrorDetected();
+  sensor["lastMotion"] = millis() - getLastMotionPulse();
+  sensor["pulseCount"] = getMotionPulseCount();
+  sensor["autoPause"] = getAutoPauseEnabled();
+  sensor["pauseDelay"] = getMotionTimeout();
+  sensor["switchDirectMode"] = getSwitchDirectMode();
+
+  // Check filament present (HIGH = present on this sensor)
+  bool filamentPresent = digitalRead(SENSOR_SWITCH) == HIGH;
+  sensor["noFilament"] = !filamentPresent;
+
+  // CallMeBot notification settings
+  JsonObject notify = doc["notify"].to<JsonObject>();
+  notify["enabled"] = getCallMeBotEnabled();
+  notify["phone"] = getCallMeBotPhone();
+  notify["hasApiKey"] = getCallMeBotApiKey().length() > 0;
+
+  // Self-hosted notification sinks (secrets are never returned)
+  NotificationSinkConfig sinkConfig = getNotificationSinkConfig();
+  JsonObject sinks = notify["sinks"].to<JsonObject>();
+  sinks["webhookConfigured"] = sinkConfig.webhookUrl[0] != '\0';
+  sinks["webhookHost"] = urlOrigin(sinkConfig.webhookUrl);
+  sinks["ntfyConfigured"] = sinkConfig.ntfyUrl[0] != '\0';
+  sinks["ntfyHost"] = urlOrigin(sinkConfig.ntfyUrl);
+  sinks["hasNtfyToken"] = sinkConfig.ntfyToken[0] != '\0';
+  sinks["mqttTopic"] = sinkConfig.mqttTopic;   // Broker: see "mqtt" below
+  sinks["mqttEnabled"] = isMqttSinkEnabled();
+
+  // MQTT status publishing (password is never returned)
+  MqttConfig mqttConfig = getMqttConfig();
+  JsonObject mqtt = doc["mqtt"].to<JsonObject>();
+  mqtt["enabled"] = mqttConfig.enabled;
+  mqtt["connected"] = isMqttConnected();
+  mqtt["host"] = mqttConfig.host;
+  mqtt["port"] = mqttConfig.port;
+  mqtt["user"] = mqttConfig.user;
+  mqtt["baseTopic"] = getMqttBaseTopic();
+  mqtt["discoveryPrefix"] = mqttConfig.discoveryPrefix;
+
+  // WiFi link
+  JsonObject wifi = doc["wifi"].to<JsonObject>();
+  wifi["state"] = getWiFiStateName();
+  wifi["connected"] = isWiFiConnected();
+  wifi["rssi"] = getWiFiRssi();
+  wifi["linkUptime"] = getWiFiLinkUptime() / 1000;
+  wifi["lastConnectMs"] = getWiFiLastConnectTime();
+  wifi["lastConnectFast"] = getWiFiLastConnectWasFast();
+  wifi["staticIpCache"] = getWiFiStaticIpCache();
+  wifi["fallbackAp"] = isWiFiFallbackApActive();
+
+  // Power mode
+  JsonObject power = doc["power"].to<JsonObject>();
+  power["mode"] = getPowerModeName();
+  power["cpuMHz"] = getCpuFrequencyMhz();
+  power["idleSeconds"] = getPowerIdleSeconds();
+
+  // WiFi and Printer configuration
+  SystemConfig& config = getConfig();
+  doc["wifiSSID"] = config.wifiSSID;
+  doc["printerIP"] = config.printerIP;
+  doc["printerPort"] = config.printerPort;
+}
+
+// Serialize one boot timeline (times in microseconds)
+static void addBootTimeline(JsonObject out, const BootTimeline& timeline) {
+  out["bootCount"] = timeline.bootCount;
+  out["resetReason"] = getResetReasonName(timeline.resetReason);
+
+  JsonObject marks = out["marks"].to<JsonObject>();
+  for (int i = 0; i < BOOT_MARK_COUNT; i++) {
+    if (timeline.marks[i] != 0) {
+      marks[getBootMarkName((BootMark)i)] = timeline.marks[i];
+    }
+  }
+
+  JsonArray phases = out["phases"].to<JsonArray>();
+  for (int i = 0; i < timeline.phaseCount; i++) {
+    JsonObject phase = phases.add<JsonObject>();
+    phase["name"] = timeline.phases[i].name;
+    phase["startUs"] = timeline.phases[i].startUs;
+    phase["durationUs"] = timeline.phases[i].durationUs;
+  }
+}
+
+// Notification sink settings from a /api/settings request. Only fields
+// present in the request are changed; "" disables a sink.
+static void updateNotificationSinks(JsonDocument& doc) {
+  NotificationSinkConfig sinkConfig = getNotificationSinkConfig();
+  if (doc["webhookUrl"].is<const char*>()) {
+    strlcpy(sinkConfig.webhookUrl, doc["webhookUrl"], sizeof(sinkConfig.webhookUrl));
+  }
+  if (doc["ntfyUrl"].is<const char*>()) {
+    strlcpy(sinkConfig.ntfyUrl, doc["ntfyUrl"], sizeof(sinkConfig.ntfyUrl));
+  }
+  if (doc["ntfyToken"].is<const char*>()) {
+    strlcpy(sinkConfig.ntfyToken, doc["ntfyToken"], sizeof(sinkConfig.ntfyToken));
+  }
+  if (doc["mqttTopic"].is<const char*>()) {
+    strlcpy(sinkConfig.mqttTopic, doc["mqttTopic"], sizeof(sinkConfig.mqttTopic));
+  }
+
+  setNotificationSinkConfig(sinkConfig);
+}
+
+// MQTT status client settings from a /api/settings request. Only fields
+// present in the request are changed.
+static void updateMqttSettings(JsonDocument& doc) {
+  MqttConfig mqttConfig = getMqttConfig();
+  if (doc["enabled"].is<bool>()) {
+    mqttConfig.enabled = doc["enabled"];
+  }
+  if (doc["host"].is<const char*>()) {
+    strlcpy(mqttConfig.host, doc["host"], sizeof(mqttConfig.host));
+  }
+  if (doc["port"].is<int>()) {
+    mqttConfig.port = doc["port"];
+  }
+  if (doc["user"].is<const char*>()) {
+    strlcpy(mqttConfig.user, doc["user"], sizeof(mqttConfig.user));
+  }
+  if (doc["password"].is<const char*>()) {
+    strlcpy(mqttConfig.password, doc["password"], sizeof(mqttConfig.password));
+  }
+  if (doc["baseTopic"].is<const char*>()) {
+    strlcpy(mqttConfig.baseTopic, doc["baseTopic"], sizeof(mqttConfig.baseTopic));
+  }
+  if (doc["discoveryPrefix"].is<const char*>()) {
+    strlcpy(mqttConfig.discoveryPrefix, doc["discoveryPrefix"], sizeof(mqttConfig.discoveryPrefix));
+  }
+
+  setMqttConfig(mqttConfig);
+}
+
+// True if the client asked for MessagePack (Accept header or ?format=msgpack)
+static bool wantsMsgPack(AsyncWebServerRequest *request) {
+  if (request->hasParam("format")) {
+    return request->getParam("format")->value() == "msgpack";
+  }
+  if (!request->hasHeader("Accept")) {
+    return false;
+  }
+  String accept = request->header("Accept");
+  return accept.indexOf("msgpack") >= 0;
+}
+
+// Send a document as JSON or MessagePack depending on content negotiation
+static void sendDocument(AsyncWebServerRequest *request, JsonDocument& doc, int code = 200) {
+  bool msgpack = wantsMsgPack(request);
+  AsyncResponseStream *response = request->beginResponseStream(msgpack ? "application/msgpack" : "application/json");
+  response->setCode(code);
+  response->addHeader("Vary", "Accept");
+
+  if (msgpack) {
+    serializeMsgPack(doc, *response);
+  } else {
+    serializeJson(doc, *response);
+  }
+  request->send(response);
+}
+
+// Register a route whose work happens in the request handler
+static void onRoute(const char* uri, WebRequestMethodComposite method, ArRequestHandlerFunction handler,
+                    AdmissionClass admissionClass = ADMISSION_NORMAL) {
+  int slot = metricsRegisterHttpRoute(methodName(method), uri);
+
+  webServer.on(uri, method, [uri, slot, handler, admissionClass](AsyncWebServerRequest *request) {
+    AdmissionResult admission = admitRequest(request, admissionClass);
+    if (admission != ADMISSION_ACCEPTED) {
+      sendAdmissionRejection(request, admission);
+      return;
+    }
+
+    notifyPowerActivity();
+    HEAP_TAG_SCOPE(HEAP_TAG_HTTP);
+    TRACE_SCOPE("http", uri);
+    uint32_t start = micros();
+    handler(request);
+    metricsRecordHttpRequest(slot, micros() - start);
+  });
+}
+
+// Register a route whose work happens in the body handler (JSON POST APIs)
+static void onBodyRoute(const char* uri, WebRequestMethodComposite method, ArBodyHandlerFunction handler,
+                        AdmissionClass admissionClass = ADMISSION_NORMAL) {
+  int slot = metricsRegisterHttpRoute(methodName(method), uri);
+
+  webServer.on(uri, method,
+    [admissionClass](AsyncWebServerRequest *request) {
+      // Body (if any) has been received; answer requests rejected while it arrived
+      AdmissionResult admission = admitRequest(request, admissionClass, request->contentLength() == 0);
+      if (admission != ADMISSION_ACCEPTED) {
+        sendAdmissionRejection(request, admission);
+      }
+    }, NULL,
+    [uri, slot, handler, admissionClass](AsyncWebServerRequest *request, uint8_t *data, size_t len, size_t index, size_t total) {
+      if (admitRequest(request, admissionClass, index == 0) != ADMISSION_ACCEPTED) {
+        return;
+      }
+
+      notifyPowerActivity();
+      HEAP_TAG_SCOPE(HEAP_TAG_HTTP);
+      TRACE_SCOPE("http", uri);
+      uint32_t start = micros();
+      handler(request, data, len, index, total);
+      if (index + len >= total) {
+        metricsRecordHttpRequest(slot, micros() - start);
+      }
+    }
+  );
+}
+
+// Register a file upload route (timed in the final request handler)
+static void onUploadRoute(const char* uri, WebRequestMethodComposite method,
+                          ArRequestHandlerFunction handler, ArUploadHandlerFunction uploadHandler) {
+  int slot = metricsRegisterHttpRoute(methodName(method), uri);
+
+  webServer.on(uri, method,
+    [uri, slot, handler](AsyncWebServerRequest *request) {
+      AdmissionResult admission = admitRequest(request, ADMISSION_NORMAL, false);
+      if (admission != ADMISSION_ACCEPTED) {
+        sendAdmissionRejection(request, admission);
+        return;
+      }
+
+      HEAP_TAG_SCOPE(HEAP_TAG_HTTP);
+      TRACE_SCOPE("http", uri);
+      uint32_t start = micros();
+      handler(request);
+      metricsRecordHttpRequest(slot, micros() - start);
+    },
+    [uri, uploadHandler](AsyncWebServerRequest *request, String filename, size_t index, uint8_t *data, size_t len, bool final) {
+      if (admitRequest(request, ADMISSION_NORMAL, index == 0) != ADMISSION_ACCEPTED) {
+        return;
+      }
+      TRACE_SCOPE("http", uri);
+      uploadHandler(request, filename, index, data, len, final);
+    }
+  );
+}
+
 void setupWebServer() {
   // Serve setup portal or dashboard based on configuration
-  webServer.on("/", HTTP_GET, [](AsyncWebServerRequest *request) {
+  onRoute("/", HTTP_GET, [](AsyncWebServerRequest *request) {
     if (isConfigured()) {
       request->send(200, "text/html", getDashboardHTML());
     } else {
@@ -32,17 +350,17 @@ void setupWebServer() {
   });
 
   // Setup portal page (accessible anytime)
-  webServer.on("/setup", HTTP_GET, [](AsyncWebServerRequest *request) {
+  onRoute("/setup", HTTP_GET, [](AsyncWebServerRequest *request) {
     request->send(200, "text/html", getSetupPortalHTML());
   });
 
   // Settings page
-  webServer.on("/settings", HTTP_GET, [](AsyncWebServerRequest *request) {
+  onRoute("/settings", HTTP_GET, [](AsyncWebServerRequest *request) {
     request->send(200, "text/html", getSettingsHTML());
   });
 
   // API: Handle initial setup
-  webServer.on("/api/setup", HTTP_POST, [](AsyncWebServerRequest *request) {}, NULL,
+  onBodyRoute("/api/setup", HTTP_POST,
     [](AsyncWebServerRequest *request, uint8_t *data, size_t len, size_t index, size_t total) {
       JsonDocument doc;
       DeserializationError error = deserializeJson(doc, data, len);
@@ -76,7 +394,7 @@ void setupWebServer() {
   );
 
   // API: Get current configuration
-  webServer.on("/api/config", HTTP_GET, [](AsyncWebServerRequest *request) {
+  onRoute("/api/config", HTTP_GET, [](AsyncWebServerRequest *request) {
     SystemConfig& config = getConfig();
     JsonDocument doc;
 
@@ -85,13 +403,11 @@ void setupWebServer() {
     doc["printerIP"] = config.printerIP;
     doc["printerPort"] = config.printerPort;
 
-    String output;
-    serializeJson(doc, output);
-    request->send(200, "application/json", output);
+    sendDocument(request, doc);
   });
 
   // API: Update configuration
-  webServer.on("/api/config", HTTP_POST, [](AsyncWebServerRequest *request) {}, NULL,
+  onBodyRoute("/api/config", HTTP_POST,
     [](AsyncWebServerRequest *request, uint8_t *data, size_t len, size_t index, size_t total) {
       JsonDocument doc;
       DeserializationError error = deserializeJson(doc, data, len);
@@ -125,69 +441,16 @@ void setupWebServer() {
     }
   );
 
-  // API: Get status
-  webServer.on("/api/status", HTTP_GET, [](AsyncWebServerRequest *request) {
+  // API: Get status (JSON or MessagePack, see sendDocument())
+  onRoute("/api/status", HTTP_GET, [](AsyncWebServerRequest *request) {
     JsonDocument doc;
-
-    // Status information
-    JsonObject status = doc["status"].to<JsonObject>();
-    status["state"] = printerStatus.printStatus;
-    status["stateText"] = getStatusText(printerStatus.printStatus);
-    status["position"] = printerStatus.currentCoord;
-    status["zOffset"] = printerStatus.zOffset;
-    status["lightOn"] = printerStatus.lightOn;
-    status["bedTemp"] = printerStatus.bedTemp;
-    status["bedTarget"] = printerStatus.bedTargetTemp;
-    status["nozzleTemp"] = printerStatus.nozzleTemp;
-    status["nozzleTarget"] = printerStatus.nozzleTargetTemp;
-    status["chamberTemp"] = printerStatus.chamberTemp;
-
-    // Print information
-    JsonObject print = doc["print"].to<JsonObject>();
-    print["progress"] = printerStatus.progress;
-    print["filename"] = printerStatus.filename;
-    print["layer"] = printerStatus.currentLayer;
-    print["totalLayers"] = printerStatus.totalLayers;
-    print["speed"] = printerStatus.printSpeed;
-
-    // Fan information
-    JsonObject fans = doc["fans"].to<JsonObject>();
-    fans["model"] = printerStatus.modelFan;
-    fans["aux"] = printerStatus.auxFan;
-    fans["box"] = printerStatus.boxFan;
-
-    // Filament sensor information
-    JsonObject sensor = doc["sensor"].to<JsonObject>();
-    sensor["error"] = isFilamentErrorDetected();
-    sensor["lastMotion"] = millis() - getLastMotionPulse();
-    sensor["pulseCount"] = getMotionPulseCount();
-    sensor["autoPause"] = getAutoPauseEnabled();
-    sensor["pauseDelay"] = getMotionTimeout();
-    sensor["switchDirectMode"] = getSwitchDirectMode();
-
-    // Check filament present (HIGH = present on this sensor)
-    bool filamentPresent = digitalRead(SENSOR_SWITCH) == HIGH;
-    sensor["noFilament"] = !filamentPresent;
-
-    // CallMeBot notification settings
-    JsonObject notify = doc["notify"].to<JsonObject>();
-    notify["enabled"] = getCallMeBotEnabled();
-    notify["phone"] = getCallMeBotPhone();
-    notify["hasApiKey"] = getCallMeBotApiKey().length() > 0;
-
-    // WiFi and Printer configuration
-    SystemConfig& config = getConfig();
-    doc["wifiSSID"] = config.wifiSSID;
-    doc["printerIP"] = config.printerIP;
-    doc["printerPort"] = config.printerPort;
-
-    String output;
-    serializeJson(doc, output);
-    request->send(200, "application/json", output);
+    buildStatusDocument(doc);
+    sendDocument(request, doc);
   });
 
-  // API: Update settings (printer IP, etc.)
-  webServer.on("/api/settings", HTTP_POST, [](AsyncWebServerRequest *request) {}, NULL,
+  // API: Update settings (printer IP, etc.). Normal admission class:
+  // configuration writes must not use the reserved control lane.
+  onBodyRoute("/api/settings", HTTP_POST,
     [](AsyncWebServerRequest *request, uint8_t *data, size_t len, size_t index, size_t total) {
       JsonDocument doc;
       DeserializationError error = deserializeJson(doc, data, len);
@@ -197,6 +460,30 @@ void setupWebServer() {
         return;
       }
 
+      // Notification sinks, MQTT and WiFi options (applied without restart)
+      String action = doc["action"] | "";
+      if (action == "setNotificationSinks" || action == "setMqttSettings" || action == "setWiFiOptions") {
+        JsonDocument response;
+        response["success"] = true;
+        if (action == "setNotificationSinks") {
+          updateNotificationSinks(doc);
+          response["message"] = "Notification sinks updated";
+        } else if (action == "setMqttSettings") {
+          updateMqttSettings(doc);
+          response["message"] = "MQTT settings updated";
+        } else {
+          if (doc["staticIpCache"].is<bool>()) {
+            setWiFiStaticIpCache(doc["staticIpCache"]);
+          }
+          response["message"] = "WiFi options updated";
+        }
+
+        String output;
+        serializeJson(response, output);
+        request->send(200, "application/json", output);
+        return;
+      }
+
       // Update WiFi configuration if provided
       if (doc["wifiSSID"].is<const char*>() && doc["wifiPassword"].is<const char*>()) {
         String wifiSSID = doc["wifiSSID"].as<String>();
@@ -251,8 +538,8 @@ void setupWebServer() {
     }
   );
 
-  // API: Control commands
-  webServer.on("/api/control", HTTP_POST, [](AsyncWebServerRequest *request) {}, NULL,
+  // API: Control commands (reserved admission lane, never rate limited)
+  onBodyRoute("/api/control", HTTP_POST,
     [](AsyncWebServerRequest *request, uint8_t *data, size_t len, size_t index, size_t total) {
       JsonDocument doc;
       DeserializationError error = deserializeJson(doc, data, len);
@@ -320,8 +607,12 @@ void setupWebServer() {
         response["message"] = "CallMeBot settings updated";
       }
       else if (action == "testNotification") {
-        sendWhatsAppNotification("Test Nachricht vom Centauri Carbon Monitor!");
-        response["message"] = "Test notification sent";
+        if (queueNotification("Test Nachricht vom Centauri Carbon Monitor!")) {
+          response["message"] = "Test notification queued";
+        } else {
+          response["success"] = false;
+          response["message"] = "No notification backend enabled";
+        }
       }
       else if (action == "restart") {
         response["message"] = "Restarting ESP32...";
@@ -340,11 +631,12 @@ void setupWebServer() {
       String output;
       serializeJson(response, output);
       request->send(200, "application/json", output);
-    }
+    },
+    ADMISSION_CONTROL
   );
 
   // API: Set runout pin output state
-  webServer.on("/api/test/runout/set", HTTP_GET, [](AsyncWebServerRequest *request) {
+  onRoute("/api/test/runout/set", HTTP_GET, [](AsyncWebServerRequest *request) {
     JsonDocument doc;
 
     if (request->hasParam("state")) {
@@ -366,7 +658,7 @@ void setupWebServer() {
   });
 
   // API: Read runout pin state
-  webServer.on("/api/test/runout/read", HTTP_GET, [](AsyncWebServerRequest *request) {
+  onRoute("/api/test/runout/read", HTTP_GET, [](AsyncWebServerRequest *request) {
     JsonDocument doc;
 
     String stateResult = getRunoutPinState();
@@ -379,76 +671,109 @@ void setupWebServer() {
   });
 
   // API: Get OTA status
-  webServer.on("/api/ota/status", HTTP_GET, [](AsyncWebServerRequest *request) {
+  onRoute("/api/ota/status", HTTP_GET, [](AsyncWebServerRequest *request) {
+    expireOTAUpdate();
     JsonDocument doc;
 
+    doc["version"] = getFirmwareVersion();
     doc["status"] = getOTAStatus();
     doc["progress"] = getOTAProgress();
     doc["error"] = getOTAError();
+    doc["written"] = getOTAWrittenSize();
+    doc["total"] = getOTATotalSize();
+    doc["resumable"] = isOTAUploadActive();
+    doc["sha256"] = getOTASha256();
+    doc["compressed"] = isOTACompressed();
+    doc["inflated"] = getOTAInflatedSize();
+
+    JsonObject health = doc["health"].to<JsonObject>();
+    health["state"] = getOTAHealthStateName();
+    health["bootloaderRollback"] = isOTAHealthBootloaderRollback();
+    health["remainingMs"] = getOTAHealthRemainingMs();
+    health["wifi"] = isOTAHealthWiFiOk();
+    health["printer"] = isOTAHealthPrinterOk();
+    health["sensor"] = isOTAHealthSensorOk();
+    health["wifiRequired"] = isOTAHealthWiFiRequired();
+    health["printerRequired"] = isOTAHealthPrinterRequired();
+    health["lastRollback"] = getOTALastRollbackReason();
+
     doc["currentPartition"] = getCurrentPartition();
     doc["nextPartition"] = getNextPartition();
 
-    String output;
-    serializeJson(doc, output);
-    request->send(200, "application/json", output);
+    sendDocument(request, doc);
   });
 
   // API: Upload firmware for OTA update
-  webServer.on("/api/ota/upload", HTTP_POST,
+  // Optional query parameters: size (image bytes), sha256 (hex digest,
+  // checked before commit), offset (resume an interrupted upload)
+  onUploadRoute("/api/ota/upload", HTTP_POST,
     [](AsyncWebServerRequest *request) {
       // This is called after upload completes
-      Serial.printf("[OTA] Request handler called, OTA status: %d\n", getOTAStatus());
-
       JsonDocument doc;
+      int code = 200;
 
-      if (getOTAStatus() == OTA_SUCCESS) {
+      if (otaUploadRejected || getOTAStatus() == OTA_ERROR) {
+        doc["success"] = false;
+        doc["message"] = getOTAError();
+        code = 500;
+      } else if (getOTAStatus() == OTA_SUCCESS) {
         doc["success"] = true;
         doc["message"] = "Firmware uploaded successfully. Rebooting...";
+        doc["sha256"] = getOTASha256();
+      } else {
+        // Part of the image stored - continue with offset=written
+        doc["success"] = true;
+        doc["message"] = "Partial upload stored";
+        doc["written"] = getOTAWrittenSize();
+        doc["total"] = getOTATotalSize();
+        code = 202;
+      }
 
-        String output;
-        serializeJson(doc, output);
-        request->send(200, "application/json", output);
+      String output;
+      serializeJson(doc, output);
+      request->send(code, "application/json", output);
 
+      if (code == 200) {
         // Reboot after sending response
         delay(1000);
         ESP.restart();
-      } else {
-        doc["success"] = false;
-        doc["message"] = getOTAError();
-        Serial.printf("[OTA] ERROR in request handler: %s\n", getOTAError().c_str());
-
-        String output;
-        serializeJson(doc, output);
-        request->send(500, "application/json", output);
       }
     },
     [](AsyncWebServerRequest *request, String filename, size_t index, uint8_t *data, size_t len, bool final) {
-      // This is called for each chunk of uploaded data
-      Serial.printf("[OTA] Upload callback: filename=%s, index=%d, len=%d, final=%d\n",
-                    filename.c_str(), index, len, final);
-
+      // Called for each chunk of uploaded data - no logging here, progress is in /api/ota/status
       if (index == 0) {
-        // First chunk - start OTA update
-        Serial.printf("[OTA] Upload started: %s, size: %d bytes\n", filename.c_str(), request->contentLength());
+        otaUploadRejected = false;
+        const char* sha256 = request->hasParam("sha256") ? request->getParam("sha256")->value().c_str() : nullptr;
+        size_t offset = request->hasParam("offset") ? request->getParam("offset")->value().toInt() : 0;
+
+        bool started;
+        if (offset > 0) {
+          started = resumeOTAUpdate(offset, sha256);
+        } else if (request->hasParam("size")) {
+          started = startOTAUpdate(request->getParam("size")->value().toInt(), true, sha256);
+        } else {
+          started = startOTAUpdate(request->contentLength(), false, sha256);
+        }
 
-        if (!startOTAUpdate(request->contentLength())) {
-          Serial.printf("[OTA] Failed to start update: %s\n", getOTAError().c_str());
+        if (!started) {
+          otaUploadRejected = true;
+          Serial.printf("[OTA] Upload rejected: %s\n", getOTAError().c_str());
           return;
         }
       }
 
-      // Write chunk
-      if (getOTAStatus() == OTA_UPDATING) {
-        if (!writeOTAChunk(data, len)) {
-          Serial.printf("[OTA] Failed to write chunk: %s\n", getOTAError().c_str());
-          return;
-        }
+      if (otaUploadRejected || getOTAStatus() != OTA_UPDATING) {
+        return;
       }
 
-      if (final) {
-        // Last chunk - finish update
-        Serial.printf("[OTA] Upload finished, total size: %d bytes\n", index + len);
+      if (len > 0 && !writeOTAChunk(data, len)) {
+        Serial.printf("[OTA] Failed to write chunk: %s\n", getOTAError().c_str());
+        return;
+      }
 
+      // A sized update is finished when all bytes arrived; otherwise the
+      // rest can follow in another request
+      if (final && (getOTATotalSize() == 0 || isOTAImageComplete())) {
         if (!finishOTAUpdate()) {
           Serial.printf("[OTA] Failed to finish update: %s\n", getOTAError().c_str());
         }
@@ -456,6 +781,207 @@ void setupWebServer() {
     }
   );
 
+  // API: Main loop profile (per-stage latency histograms)
+  onRoute("/api/loopprof", HTTP_GET, [](AsyncWebServerRequest *request) {
+    JsonDocument doc;
+
+    JsonArray stages = doc["stages"].to<JsonArray>();
+    for (int i = 0; i <= LOOP_STAGE_COUNT; i++) {
+      LoopStageStats stats = getLoopStageStats(i);
+      JsonObject stage = stages.add<JsonObject>();
+      stage["name"] = stats.name;
+      stage["count"] = stats.count;
+      stage["p50"] = stats.p50;
+      stage["p99"] = stats.p99;
+      stage["max"] = stats.max;
+      stage["mean"] = stats.mean;
+    }
+
+    JsonObject stalls = doc["stalls"].to<JsonObject>();
+    stalls["thresholdUs"] = LOOP_STALL_THRESHOLD_US;
+    stalls["count"] = getLoopStallCount();
+    stalls["lastStage"] = getLastStallStage();
+    stalls["lastDurationUs"] = getLastStallDuration();
+
+    if (request->hasParam("reset")) {
+      resetLoopProfiler();
+    }
+
+    sendDocument(request, doc);
+  });
+
+  // API: Boot timeline of this and the previous boot
+  onRoute("/api/boot", HTTP_GET, [](AsyncWebServerRequest *request) {
+    JsonDocument doc;
+    addBootTimeline(doc["current"].to<JsonObject>(), getBootTimeline());
+    doc["warmRestart"] = getRestoredState() != nullptr;
+
+    BootTimeline previous;
+    if (getPreviousBootTimeline(previous)) {
+      addBootTimeline(doc["previous"].to<JsonObject>(), previous);
+    }
+
+    sendDocument(request, doc);
+  });
+
+  // API: Heap history and allocation attribution
+  onRoute("/api/heap", HTTP_GET, [](AsyncWebServerRequest *request) {
+    // Printed directly: a JsonDocument for ~250 samples would itself fragment the heap
+    AsyncResponseStream *response = request->beginResponseStream("application/json");
+
+    response->printf("{\"freeHeap\":%lu,\"largestBlock\":%lu,\"minFreeHeap\":%lu,\"intervalS\":%d,\"longIntervalS\":%d",
+                     (unsigned long)ESP.getFreeHeap(), (unsigned long)ESP.getMaxAllocHeap(),
+                     (unsigned long)ESP.getMinFreeHeap(), HEAP_SAMPLE_INTERVAL_S,
+                     HEAP_SAMPLE_INTERVAL_S * HEAP_LONG_DECIMATION);
+
+    // Samples as [uptimeS, free, largest, minFree]
+    for (int ring = 0; ring < 2; ring++) {
+      bool longTerm = (ring == 1);
+      response->print(longTerm ? ",\"long\":[" : ",\"short\":[");
+      int count = getHeapSampleCount(longTerm);
+      for (int i = 0; i < count; i++) {
+        HeapSample sample = getHeapSample(longTerm, i);
+        response->printf("%s[%lu,%lu,%lu,%lu]", i > 0 ? "," : "",
+                         (unsigned long)sample.uptimeS, (unsigned long)sample.freeHeap,
+                         (unsigned long)sample.largestBlock, (unsigned long)sample.minFreeHeap);
+      }
+      response->print("]");
+    }
+
+    response->printf(",\"allocHooks\":%s,\"allocations\":{", heapAllocHooksEnabled() ? "true" : "false");
+    for (int tag = 0; tag < HEAP_TAG_COUNT; tag++) {
+      HeapTagStats stats = getHeapTagStats((HeapTag)tag);
+      response->printf("%s\"%s\":{\"allocs\":%lu,\"bytes\":%lu,\"frees\":%lu}", tag > 0 ? "," : "",
+                       stats.name, (unsigned long)stats.allocs, (unsigned long)stats.bytes,
+                       (unsigned long)stats.frees);
+    }
+    response->print("}}");
+
+    request->send(response);
+  });
+
+  // API: Log ring (?since=<seq> returns only newer messages)
+  onRoute("/api/logs", HTTP_GET, [](AsyncWebServerRequest *request) {
+    JsonDocument doc;
+    uint32_t next = getLogNextSeq();
+    uint32_t first = next > LOG_RING_SLOTS ? next - LOG_RING_SLOTS : 0;
+    if (request->hasParam("since")) {
+      uint32_t since = request->getParam("since")->value().toInt();
+      if (since > first && since <= next) {
+        first = since;
+      }
+    }
+
+    doc["next"] = next;
+    doc["dropped"] = getLogDroppedCount();
+    JsonArray entries = doc["entries"].to<JsonArray>();
+    LogEntry entry;
+    for (uint32_t seq = first; seq != next; seq++) {
+      if (!getLogEntry(seq, entry)) {
+        continue;   // Overwritten or still being written
+      }
+      JsonObject item = entries.add<JsonObject>();
+      item["seq"] = entry.seq;
+      item["ms"] = entry.ms;
+      char level[2] = { getLogLevelChar(entry.level), '\0' };
+      item["level"] = level;
+      if (entry.tag) {
+        item["tag"] = entry.tag;
+        item["msg"] = entry.text;
+      } else {
+        // Tokenized mode: format id and packed arguments for tools/logdecode.py
+        char data[LOG_LINE_MAX * 2 + 1];
+        for (int i = 0; i < entry.size; i++) {
+          snprintf(data + i * 2, 3, "%02x", (uint8_t)entry.text[i]);
+        }
+        data[entry.size * 2] = '\0';
+        item["id"] = entry.id;
+        item["data"] = data;
+      }
+    }
+
+    sendDocument(request, doc);
+  });
+
+  // API: Span trace as Chrome trace-event JSON (?minUs=<threshold>, ?clear)
+  onRoute("/api/trace", HTTP_GET, [](AsyncWebServerRequest *request) {
+    if (request->hasParam("minUs")) {
+      setTraceMinSpanUs(request->getParam("minUs")->value().toInt());
+    }
+
+    // Streamed in chunks: the full ring would not fit in one response buffer
+    std::shared_ptr<TraceExport> state = std::make_shared<TraceExport>();
+    beginTraceExport(*state);
+    if (request->hasParam("clear")) {
+      clearTrace();
+    }
+    AsyncWebServerResponse *response = request->beginChunkedResponse("application/json",
+      [state](uint8_t *buffer, size_t maxLen, size_t index) -> size_t {
+        return readTraceExport(*state, buffer, maxLen);
+      });
+    request->send(response);
+  });
+
+  // API: Task list with CPU shares since the previous call and stack high-water marks
+  onRoute("/api/tasks", HTTP_GET, [](AsyncWebServerRequest *request) {
+    std::unique_ptr<TaskSnapshot> snapshot(new TaskSnapshot);
+    if (!takeTaskSnapshot(*snapshot)) {
+      request->send(501, "application/json", "{\"success\":false,\"message\":\"Task list not available\"}");
+      return;
+    }
+
+    JsonDocument doc;
+    doc["runtimeStats"] = snapshot->runtimeStats;
+    doc["intervalMs"] = snapshot->intervalMs;
+    JsonArray tasks = doc["tasks"].to<JsonArray>();
+    for (int i = 0; i < snapshot->count; i++) {
+      const TaskInfo& info = snapshot->tasks[i];
+      JsonObject task = tasks.add<JsonObject>();
+      task["name"] = info.name;
+      task["priority"] = info.priority;
+      task["basePriority"] = info.basePriority;
+      char state[2] = { info.state, '\0' };
+      task["state"] = state;
+      task["stackFree"] = info.stackFreeMin;
+      if (info.stackSize) {
+        task["stackSize"] = info.stackSize;
+      }
+      if (info.cpuPercent >= 0) {
+        task["cpu"] = roundf(info.cpuPercent * 10) / 10;
+        task["cpuTotal"] = roundf(info.cpuTotalPercent * 10) / 10;
+      }
+    }
+
+    sendDocument(request, doc);
+  });
+
+  // API: Sampling profiler (?start=<seconds> begins a run, ?stop ends it early)
+  onRoute("/api/profile", HTTP_GET, [](AsyncWebServerRequest *request) {
+    if (request->hasParam("start")) {
+      if (getSampleProfileStats().running) {
+        request->send(409, "application/json", "{\"success\":false,\"message\":\"Profiler already running\"}");
+        return;
+      }
+      if (!startSampleProfiler(request->getParam("start")->value().toInt())) {
+        request->send(500, "application/json", "{\"success\":false,\"message\":\"Profiler timer unavailable\"}");
+        return;
+      }
+    } else if (request->hasParam("stop")) {
+      stopSampleProfiler();
+    }
+
+    AsyncResponseStream *response = request->beginResponseStream("application/json");
+    writeSampleProfile(*response);
+    request->send(response);
+  });
+
+  // Prometheus metrics
+  onRoute("/metrics", HTTP_GET, [](AsyncWebServerRequest *request) {
+    AsyncResponseStream *response = request->beginResponseStream("text/plain; version=0.0.4; charset=utf-8");
+    writeMetrics(*response);
+    request->send(response);
+  });
+
   // Start server
   webServer.begin();
   Serial.println("[WEB] Web server started on port 80");
@@ -8,6 +8,7 @@
 
 #include <ESPAsyncWebServer.h>
 #include <AsyncTCP.h>
+#include <ArduinoJson.h>
 
 // Initialize web server
 void setupWebServer();
@@ -15,6 +16,9 @@ void setupWebServer();
 // Process web server (if needed)
 void processWebServer();
 
+// Build the status document served at /api/status
+void buildStatusDocument(JsonDocument& doc);
+
 // Get server instance (for direct access if needed)
 AsyncWebServer& getWebServer();
 
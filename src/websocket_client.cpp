@@ -6,14 +6,20 @@
 #include "config.h"
 #include "config_manager.h"
 #include "printer_status.h"
+#include "metrics.h"
+#include "boot_profiler.h"
+#include "heap_monitor.h"
+#include "logger.h"
+#include "trace.h"
 
 // WebSocket instance
 static WebSocketsClient webSocket;
+static bool connectedOnce = false;
 
 void setupWebSocket() {
   SystemConfig& config = getConfig();
 
-  Serial.printf("Connecting to printer at ws://%s:%d%s\n", config.printerIP, config.printerPort, PRINTER_WS_PATH);
+  LOGI("WS", "Connecting to printer at ws://%s:%d%s", config.printerIP, config.printerPort, PRINTER_WS_PATH);
   webSocket.begin(config.printerIP, config.printerPort, PRINTER_WS_PATH);
   webSocket.onEvent(webSocketEvent);
   webSocket.setReconnectInterval(5000);
@@ -22,12 +28,17 @@ void setupWebSocket() {
 void webSocketEvent(WStype_t type, uint8_t * payload, size_t length) {
   switch(type) {
     case WStype_DISCONNECTED:
-      Serial.println("[WS] Disconnected!");
+      LOGW("WS", "Disconnected!");
       break;
 
     case WStype_CONNECTED:
-      Serial.println("[WS] Connected to printer!");
-      Serial.printf("[WS] URL: ws://%s%s\n", PRINTER_IP, PRINTER_WS_PATH);
+      LOGI("WS", "Connected to printer!");
+      bootProfilerMark(BOOT_MARK_PRINTER_CONNECTED);
+      if (connectedOnce) {
+        metricsIncrement(METRIC_WS_RECONNECTS);
+      }
+      connectedOnce = true;
+      LOGD("WS", "URL: ws://%s%s", PRINTER_IP, PRINTER_WS_PATH);
       requestStatus();
       break;
 
@@ -36,15 +47,15 @@ void webSocketEvent(WStype_t type, uint8_t * payload, size_t length) {
       break;
 
     case WStype_ERROR:
-      Serial.println("[WS] Error!");
+      LOGE("WS", "Error!");
       break;
 
     case WStype_PING:
-      Serial.println("[WS] Ping received");
+      LOGV("WS", "Ping received");
       break;
 
     case WStype_PONG:
-      Serial.println("[WS] Pong received");
+      LOGV("WS", "Pong received");
       break;
   }
 }
@@ -54,6 +65,8 @@ void sendCommand(int cmd) {
 }
 
 void sendCommand(int cmd, JsonObject *data) {
+  HEAP_TAG_SCOPE(HEAP_TAG_WEBSOCKET);
+  TRACE_SCOPE("ws", "sendCommand");
   JsonDocument doc;
 
   doc["Id"] = "";
@@ -88,18 +101,20 @@ void sendPing() {
 }
 
 void parseMessage(char* payload) {
+  HEAP_TAG_SCOPE(HEAP_TAG_WEBSOCKET);
+  TRACE_SCOPE("ws", "parseMessage");
   JsonDocument doc;
   DeserializationError error = deserializeJson(doc, payload);
 
   if (error) {
-    Serial.print("JSON parse error: ");
-    Serial.println(error.c_str());
+    metricsIncrement(METRIC_WS_PARSE_ERRORS);
+    LOGW("WS", "JSON parse error: %s", error.c_str());
     return;
   }
+  metricsIncrement(METRIC_WS_FRAMES_PARSED);
 
-  Serial.println("\n========== RAW JSON DATA ==========");
-  serializeJsonPretty(doc, Serial);
-  Serial.println("\n===================================\n");
+  // Raw frames only in verbose builds (a status frame is ~1.5 KB)
+  LOGV("WS", "Frame: %s", payload);
 
   if (doc["Status"].is<JsonObject>()) {
     JsonObject statusObj = doc["Status"];
@@ -145,22 +160,25 @@ void parseMessage(char* payload) {
       printerStatus.lightOn = (lightValue == 1);
     }
 
-    displayPrinterStatus();
+    LOGD("STATUS", "%s L%d/%d %d%% bed %.1f/%.1f nozzle %.1f/%.1f",
+         getStatusText(printerStatus.printStatus), printerStatus.currentLayer, printerStatus.totalLayers,
+         printerStatus.progress, printerStatus.bedTemp, printerStatus.bedTargetTemp,
+         printerStatus.nozzleTemp, printerStatus.nozzleTargetTemp);
   }
   else if (!doc["Data"].isNull()) {
     JsonObject data = doc["Data"];
     if (!data["Cmd"].isNull()) {
       int cmd = data["Cmd"];
-      Serial.printf("[ACK] Command %d acknowledged\n", cmd);
-
       if (!data["Data"].isNull() && !data["Data"]["Ack"].isNull()) {
         int ack = data["Data"]["Ack"];
         switch(ack) {
-          case 0: Serial.println("  Result: Success"); break;
-          case 1: Serial.println("  Result: Failure/Error"); break;
-          case 2: Serial.println("  Result: File Not Found"); break;
-          default: Serial.printf("  Result: Unknown (%d)\n", ack); break;
+          case 0: LOGD("ACK", "Command %d: Success", cmd); break;
+          case 1: LOGW("ACK", "Command %d: Failure/Error", cmd); break;
+          case 2: LOGW("ACK", "Command %d: File Not Found", cmd); break;
+          default: LOGW("ACK", "Command %d: Unknown result (%d)", cmd, ack); break;
         }
+      } else {
+        LOGD("ACK", "Command %d acknowledged", cmd);
       }
     }
   }
@@ -170,6 +188,10 @@ void processWebSocket() {
   webSocket.loop();
 }
 
+bool isWebSocketConnected() {
+  return webSocket.isConnected();
+}
+
 WebSocketsClient& getWebSocket() {
   return webSocket;
 }
@@ -31,6 +31,9 @@ void parseMessage(char* payload);
 // Process WebSocket loop
 void processWebSocket();
 
+// True while the printer connection is up
+bool isWebSocketConnected();
+
 // Get WebSocket instance (for direct access if needed)
 WebSocketsClient& getWebSocket();
 
@@ -1,32 +1,322 @@
 /*
  * WiFi Connection Manager Implementation
+ *
+ * Runs on the main loop and never blocks: every call of handleWiFiManager()
+ * only looks at WiFi.status() and the time spent in the current state.
+ * The driver's own auto-reconnect is disabled so that only this state
+ * machine starts connection attempts.
  */
 
 #include "wifi_manager.h"
 #include "config_manager.h"
+#include "settings_store.h"
+#include "metrics.h"
+#include "boot_profiler.h"
+#include "ping/ping_sock.h"
+
+static WiFiState state = WIFI_STATE_IDLE;
+static unsigned long stateSince = 0;
+static unsigned long attemptStart = 0;
+static unsigned long backoffDelay = WIFI_BACKOFF_MIN_MS;
+static unsigned long currentBackoff = 0;
+static unsigned long bootMs = 0;
+static bool everConnected = false;
+static volatile bool fallbackAp = false;
+
+// Link statistics (read from other tasks)
+static volatile unsigned long linkUpMs = 0;
+static volatile unsigned long lastConnectMs = 0;
+static volatile bool lastConnectFast = false;
+static bool usedCachedLease = false;  // Current attempt skipped DHCP
+
+// Gateway check after a connect with the cached lease (ping runs in its own task)
+enum LeaseCheck { LEASE_CHECK_IDLE, LEASE_CHECK_RUNNING, LEASE_CHECK_OK, LEASE_CHECK_FAILED };
+static volatile LeaseCheck leaseCheck = LEASE_CHECK_IDLE;
+static esp_ping_handle_t leaseCheckPing = nullptr;
+
+static const char* const stateNames[] = {
+  "idle", "fastConnecting", "connecting", "connected", "backoff"
+};
+
+static void enterState(WiFiState next) {
+  state = next;
+  stateSince = millis();
+}
+
+// Try the cached access point; returns false if there is no cache
+static bool startFastConnect() {
+  const WiFiCache& cache = getSettings().wifiCache;
+  if (!cache.valid) {
+    return false;
+  }
 
-void connectWiFi() {
   SystemConfig& config = getConfig();
+  usedCachedLease = cache.useStaticIp && cache.ip != 0;
+  if (usedCachedLease) {
+    WiFi.config(IPAddress(cache.ip), IPAddress(cache.gateway), IPAddress(cache.subnet), IPAddress(cache.dns));
+  } else {
+    WiFi.config(INADDR_NONE, INADDR_NONE, INADDR_NONE);
+  }
+
+  WiFi.disconnect(false, false);
+  WiFi.begin(config.wifiSSID, config.wifiPassword, cache.channel, cache.bssid, true);
 
-  Serial.printf("Connecting to WiFi: %s\n", config.wifiSSID);
+  Serial.printf("[WIFI] Fast connect to %02X:%02X:%02X:%02X:%02X:%02X on channel %u%s\n",
+                cache.bssid[0], cache.bssid[1], cache.bssid[2], cache.bssid[3], cache.bssid[4], cache.bssid[5],
+                cache.channel, usedCachedLease ? " (cached IP)" : "");
+  enterState(WIFI_STATE_FAST_CONNECTING);
+  return true;
+}
+
+static void startFullConnect() {
+  SystemConfig& config = getConfig();
+
+  usedCachedLease = false;
+  WiFi.config(INADDR_NONE, INADDR_NONE, INADDR_NONE);  // Always DHCP after a scan
+  WiFi.disconnect(false, false);
   WiFi.begin(config.wifiSSID, config.wifiPassword);
 
-  int attempts = 0;
-  while (WiFi.status() != WL_CONNECTED && attempts < 30) {
-    delay(500);
-    Serial.print(".");
-    attempts++;
+  Serial.printf("[WIFI] Connecting to %s (full scan)\n", config.wifiSSID);
+  enterState(WIFI_STATE_CONNECTING);
+}
+
+static void startAttempt() {
+  attemptStart = millis();
+  if (!startFastConnect()) {
+    startFullConnect();
   }
+}
 
-  if (WiFi.status() == WL_CONNECTED) {
-    Serial.println("\nWiFi Connected!");
-    Serial.print("IP Address: ");
-    Serial.println(WiFi.localIP());
-  } else {
-    Serial.println("\nWiFi Connection Failed!");
+static void startFallbackAp() {
+  Serial.printf("[WIFI] ⚠️ No connection after %d s - opening setup AP '%s' (still retrying)\n",
+                WIFI_PORTAL_TIMEOUT_MS / 1000, WIFI_FALLBACK_AP_SSID);
+  WiFi.mode(WIFI_AP_STA);
+  WiFi.softAP(WIFI_FALLBACK_AP_SSID);
+  fallbackAp = true;
+  Serial.printf("[WIFI]   Setup page: http://%s/setup\n", WiFi.softAPIP().toString().c_str());
+}
+
+static void stopFallbackAp() {
+  WiFi.softAPdisconnect(true);
+  WiFi.mode(WIFI_STA);
+  fallbackAp = false;
+  Serial.println("[WIFI] Setup AP closed");
+}
+
+static void onLeaseCheckEnd(esp_ping_handle_t handle, void* args) {
+  uint32_t replies = 0;
+  esp_ping_get_profile(handle, ESP_PING_PROF_REPLY, &replies, sizeof(replies));
+  leaseCheck = replies > 0 ? LEASE_CHECK_OK : LEASE_CHECK_FAILED;
+}
+
+static void stopLeaseCheck() {
+  if (leaseCheckPing) {
+    esp_ping_stop(leaseCheckPing);
+    esp_ping_delete_session(leaseCheckPing);
+    leaseCheckPing = nullptr;
+  }
+  leaseCheck = LEASE_CHECK_IDLE;
+}
+
+// A cached lease may be stale (new router, changed DHCP range): make sure the gateway answers
+static void startLeaseCheck() {
+  IPAddress gateway = WiFi.gatewayIP();
+  esp_ping_config_t config = ESP_PING_DEFAULT_CONFIG();
+  IP_ADDR4(&config.target_addr, gateway[0], gateway[1], gateway[2], gateway[3]);
+  config.count = WIFI_LEASE_CHECK_PINGS;
+  config.timeout_ms = WIFI_LEASE_CHECK_TIMEOUT_MS;
+
+  esp_ping_callbacks_t callbacks = {};
+  callbacks.on_ping_end = onLeaseCheckEnd;
+
+  if (esp_ping_new_session(&config, &callbacks, &leaseCheckPing) != ESP_OK) {
+    leaseCheckPing = nullptr;
+    return;  // Keep the link, the check is best effort
+  }
+  leaseCheck = LEASE_CHECK_RUNNING;
+  esp_ping_start(leaseCheckPing);
+}
+
+// Remember the access point and lease; only writes when something changed
+static void updateCache() {
+  WiFiCache fresh = getSettings().wifiCache;
+  const uint8_t* bssid = WiFi.BSSID();
+  if (!bssid) {
+    return;
+  }
+
+  fresh.valid = true;
+  memcpy(fresh.bssid, bssid, sizeof(fresh.bssid));
+  fresh.channel = WiFi.channel();
+  if (!usedCachedLease) {
+    // Only a DHCP connect yields a fresh lease; a cached one is kept as is
+    fresh.ip = (uint32_t)WiFi.localIP();
+    fresh.gateway = (uint32_t)WiFi.gatewayIP();
+    fresh.subnet = (uint32_t)WiFi.subnetMask();
+    fresh.dns = (uint32_t)WiFi.dnsIP();
+  }
+
+  if (memcmp(&fresh, &getSettings().wifiCache, sizeof(fresh)) == 0) {
+    return;
+  }
+
+  Settings& settings = beginSettingsUpdate();
+  settings.wifiCache = fresh;
+  endSettingsUpdate(SETTINGS_WIFI);
+  Serial.println("[WIFI] Access point cache updated");
+}
+
+static void onConnected() {
+  unsigned long now = millis();
+  lastConnectMs = now - attemptStart;
+  lastConnectFast = state == WIFI_STATE_FAST_CONNECTING;
+  linkUpMs = now;
+  everConnected = true;
+  bootProfilerMark(BOOT_MARK_WIFI_CONNECTED);
+  backoffDelay = WIFI_BACKOFF_MIN_MS;
+  enterState(WIFI_STATE_CONNECTED);
+
+  Serial.printf("[WIFI] ✓ Connected in %lu ms (%s), IP %s, channel %d, RSSI %d dBm\n",
+                (unsigned long)lastConnectMs, lastConnectFast ? "fast" : "scan",
+                WiFi.localIP().toString().c_str(), WiFi.channel(), WiFi.RSSI());
+
+  if (fallbackAp) {
+    stopFallbackAp();
+  }
+  updateCache();
+  if (usedCachedLease) {
+    startLeaseCheck();
+  }
+}
+
+static void onAttemptFailed() {
+  if (state == WIFI_STATE_FAST_CONNECTING) {
+    // Access point moved or the cached lease is no longer valid
+    Serial.println("[WIFI] Fast connect timed out, falling back to scan");
+    startFullConnect();
+    return;
+  }
+
+  metricsIncrement(METRIC_WIFI_CONNECT_FAILURES);
+  currentBackoff = backoffDelay;
+  backoffDelay = min(backoffDelay * 2, (unsigned long)WIFI_BACKOFF_MAX_MS);
+  Serial.printf("[WIFI] ❌ Connection failed (status %d), retry in %lu s\n",
+                WiFi.status(), currentBackoff / 1000);
+
+  WiFi.disconnect(false, false);
+  enterState(WIFI_STATE_BACKOFF);
+}
+
+// ========== Public API ==========
+
+void setupWiFiManager() {
+  bootMs = millis();
+
+  WiFi.persistent(false);        // Credentials live in the settings store
+  WiFi.setAutoReconnect(false);  // Reconnects are driven by handleWiFiManager()
+  WiFi.mode(WIFI_STA);
+
+  startAttempt();
+}
+
+void handleWiFiManager() {
+  unsigned long now = millis();
+  bool linkUp = WiFi.status() == WL_CONNECTED;
+
+  switch (state) {
+    case WIFI_STATE_IDLE:
+      return;
+
+    case WIFI_STATE_FAST_CONNECTING:
+    case WIFI_STATE_CONNECTING: {
+      unsigned long timeout = state == WIFI_STATE_FAST_CONNECTING ? WIFI_FAST_CONNECT_TIMEOUT_MS
+                                                                   : WIFI_CONNECT_TIMEOUT_MS;
+      if (linkUp) {
+        onConnected();
+      } else if (now - stateSince > timeout) {
+        onAttemptFailed();
+      }
+      break;
+    }
+
+    case WIFI_STATE_CONNECTED:
+      if (leaseCheck == LEASE_CHECK_OK) {
+        stopLeaseCheck();
+      } else if (leaseCheck == LEASE_CHECK_FAILED) {
+        stopLeaseCheck();
+        Serial.println("[WIFI] ⚠️ Gateway not reachable with the cached IP, reconnecting with DHCP");
+        linkUpMs = 0;
+        attemptStart = now;
+        startFullConnect();
+        break;
+      }
+      if (!linkUp) {
+        stopLeaseCheck();
+        metricsIncrement(METRIC_WIFI_DISCONNECTS);
+        Serial.printf("[WIFI] ⚠️ Connection lost after %lu s, reconnecting\n",
+                      (now - linkUpMs) / 1000);
+        linkUpMs = 0;
+        startAttempt();
+      }
+      break;
+
+    case WIFI_STATE_BACKOFF:
+      if (now - stateSince >= currentBackoff) {
+        startAttempt();
+      }
+      break;
+  }
+
+  if (!everConnected && !fallbackAp && now - bootMs > WIFI_PORTAL_TIMEOUT_MS) {
+    startFallbackAp();
   }
 }
 
 bool isWiFiConnected() {
   return WiFi.status() == WL_CONNECTED;
 }
+
+bool hasWiFiEverConnected() {
+  return everConnected;
+}
+
+bool isWiFiFallbackApActive() {
+  return fallbackAp;
+}
+
+WiFiState getWiFiState() {
+  return state;
+}
+
+const char* getWiFiStateName() {
+  return stateNames[state];
+}
+
+int getWiFiRssi() {
+  return isWiFiConnected() ? WiFi.RSSI() : 0;
+}
+
+unsigned long getWiFiLinkUptime() {
+  unsigned long up = linkUpMs;
+  return up != 0 ? millis() - up : 0;
+}
+
+unsigned long getWiFiLastConnectTime() {
+  return lastConnectMs;
+}
+
+bool getWiFiLastConnectWasFast() {
+  return lastConnectFast;
+}
+
+void setWiFiStaticIpCache(bool enabled) {
+  Settings& settings = beginSettingsUpdate();
+  settings.wifiCache.useStaticIp = enabled;
+  endSettingsUpdate(SETTINGS_WIFI);
+
+  Serial.printf("[WIFI] Cached IP for fast connects: %s\n", enabled ? "enabled" : "disabled");
+}
+
+bool getWiFiStaticIpCache() {
+  return getSettings().wifiCache.useStaticIp;
+}
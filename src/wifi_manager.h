@@ -1,6 +1,8 @@
 /*
  * WiFi Connection Manager
- * Handles WiFi connectivity
+ * Non-blocking connection state machine: fast reconnect to the cached
+ * access point (BSSID, channel, optionally the last IP lease), full scan
+ * as fallback, background retries with exponential backoff.
  */
 
 #ifndef WIFI_MANAGER_H
@@ -8,10 +10,63 @@
 
 #include <WiFi.h>
 
-// Initialize and connect to WiFi
-void connectWiFi();
+// ========== WiFi Manager Configuration ==========
+#define WIFI_FAST_CONNECT_TIMEOUT_MS 3000   // Connect to the cached BSSID/channel
+#define WIFI_CONNECT_TIMEOUT_MS 15000       // Connect with a full scan
+#define WIFI_BACKOFF_MIN_MS 1000            // First retry delay, doubled up to the max
+#define WIFI_BACKOFF_MAX_MS 60000
+#define WIFI_PORTAL_TIMEOUT_MS 60000        // Open the setup AP if never connected after this long
+#define WIFI_FALLBACK_AP_SSID "ESP32-Setup"
+#define WIFI_LEASE_CHECK_PINGS 3            // Gateway pings after a connect with the cached lease
+#define WIFI_LEASE_CHECK_TIMEOUT_MS 1000    // Per ping
+
+// Connection state
+enum WiFiState {
+  WIFI_STATE_IDLE,            // Not started
+  WIFI_STATE_FAST_CONNECTING, // Connecting to the cached access point
+  WIFI_STATE_CONNECTING,      // Connecting with a full scan
+  WIFI_STATE_CONNECTED,
+  WIFI_STATE_BACKOFF          // Waiting before the next attempt
+};
+
+// Cached access point and lease (persisted in the settings store)
+struct WiFiCache {
+  bool valid;
+  uint8_t bssid[6];
+  uint8_t channel;
+  bool useStaticIp;           // Reuse the cached lease instead of DHCP on fast connects
+  uint32_t ip;
+  uint32_t gateway;
+  uint32_t subnet;
+  uint32_t dns;
+};
+
+// Start connecting in the background (returns immediately)
+void setupWiFiManager();
+
+// Drive the state machine (call every loop)
+void handleWiFiManager();
 
 // Check if WiFi is connected
 bool isWiFiConnected();
 
+// True once the station connected at least once since boot
+bool hasWiFiEverConnected();
+
+// True while the fallback setup AP is running
+bool isWiFiFallbackApActive();
+
+WiFiState getWiFiState();
+const char* getWiFiStateName();
+
+// Link statistics
+int getWiFiRssi();                     // dBm, 0 if not connected
+unsigned long getWiFiLinkUptime();     // ms since the current link came up, 0 if down
+unsigned long getWiFiLastConnectTime(); // ms the last successful connect took
+bool getWiFiLastConnectWasFast();
+
+// Reuse the cached IP lease for fast connects (skips DHCP)
+void setWiFiStaticIpCache(bool enabled);
+bool getWiFiStaticIpCache();
+
 #endif // WIFI_MANAGER_H
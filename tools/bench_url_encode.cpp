@@ -0,0 +1,108 @@
+/*
+ * Host benchmark: single-pass urlEncode() vs. the former String.replace() chain
+ *
+ * Build and run on the development machine:
+ *   g++ -O2 -std=c++17 -Isrc tools/bench_url_encode.cpp src/url_encode.cpp -o bench_url_encode
+ *   ./bench_url_encode
+ *
+ * The replace chain is modelled with std::string (same algorithm as
+ * Arduino's String::replace: one scan plus reallocation per pattern).
+ * Heap allocations are counted through a global operator new.
+ */
+
+#include "url_encode.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <string>
+
+static size_t allocations = 0;
+
+void* operator new(size_t size) {
+  allocations++;
+  void* ptr = malloc(size);
+  if (!ptr) throw std::bad_alloc();
+  return ptr;
+}
+
+void operator delete(void* ptr) noexcept {
+  free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept {
+  free(ptr);
+}
+
+static void replaceAll(std::string& s, const char* find, const char* replace) {
+  size_t findLength = strlen(find);
+  size_t replaceLength = strlen(replace);
+  for (size_t pos = s.find(find); pos != std::string::npos; pos = s.find(find, pos + replaceLength)) {
+    s.replace(pos, findLength, replace);
+  }
+}
+
+// Former encoder from callmebot.cpp
+static std::string legacyEncode(const char* message) {
+  std::string encoded(message);
+  replaceAll(encoded, " ", "+");
+  replaceAll(encoded, "\n", "%0A");
+  replaceAll(encoded, "ä", "%C3%A4");
+  replaceAll(encoded, "ö", "%C3%B6");
+  replaceAll(encoded, "ü", "%C3%BC");
+  replaceAll(encoded, "ß", "%C3%9F");
+  replaceAll(encoded, "Ä", "%C3%84");
+  replaceAll(encoded, "Ö", "%C3%96");
+  replaceAll(encoded, "Ü", "%C3%9C");
+  return encoded;
+}
+
+static const char* const messages[] = {
+  "🚨 Centauri Carbon Alarm!\n\nFilament-Runout erkannt!\n\nDruck wurde pausiert.",
+  "✅ Druck abgeschlossen!\n\nDatei: Gehäuse_Deckel_v2.gcode\nDauer: 2h 45min",
+  "🖨️ Druck gestartet\n\nDatei: Halterung für Türschloß.gcode",
+  "📋 3 Meldungen\n\n✅ Druck abgeschlossen!\n\nDatei: a&b=c?.gcode\nDauer: 0h 12min\n\n"
+  "🖨️ Druck gestartet\n\nDatei: #1 100% Ölwanne.gcode\n\n(+1 weitere)",
+};
+
+static const int ITERATIONS = 200000;
+
+int main() {
+  const int count = sizeof(messages) / sizeof(messages[0]);
+  char buffer[URL_ENCODED_SIZE(1024)];
+  volatile size_t sink = 0;
+
+  printf("%-8s %10s %10s %12s\n", "message", "legacy ns", "single ns", "legacy allocs");
+
+  for (int m = 0; m < count; m++) {
+    size_t before = allocations;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < ITERATIONS; i++) {
+      sink = sink + legacyEncode(messages[m]).size();
+    }
+    auto legacyTime = std::chrono::steady_clock::now() - start;
+    double legacyAllocs = (double)(allocations - before) / ITERATIONS;
+
+    before = allocations;
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < ITERATIONS; i++) {
+      sink = sink + urlEncode(messages[m], buffer, sizeof(buffer));
+    }
+    auto singleTime = std::chrono::steady_clock::now() - start;
+    if (allocations != before) {
+      printf("urlEncode allocated memory!\n");
+      return 1;
+    }
+
+    printf("%-8d %10.1f %10.1f %12.1f\n", m,
+           std::chrono::duration<double, std::nano>(legacyTime).count() / ITERATIONS,
+           std::chrono::duration<double, std::nano>(singleTime).count() / ITERATIONS,
+           legacyAllocs);
+  }
+
+  // Show what the legacy chain leaves unencoded
+  urlEncode(messages[0], buffer, sizeof(buffer));
+  printf("\nlegacy: %s\nsingle: %s\n", legacyEncode(messages[0]).c_str(), buffer);
+  return 0;
+}
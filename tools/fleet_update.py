@@ -0,0 +1,351 @@
+#!/usr/bin/env python3
+"""
+Push a firmware image or settings to many monitors at once.
+
+Uses the same endpoints as the web interface: /api/ota/upload (with size
+and sha256, resuming interrupted uploads via offset), /api/ota/status
+(version, resume state, health gate) and /api/settings.
+
+    # Firmware (plain .bin or .bin.gz from tools/ota_pack.py)
+    python3 tools/fleet_update.py firmware firmware/firmware.bin --hosts-file monitors.txt --jobs 4
+
+    # Settings JSON as accepted by /api/settings, e.g. {"printerIP": "192.168.1.50", "printerPort": 80}
+    python3 tools/fleet_update.py config printer.json --hosts 192.168.1.21 192.168.1.22
+
+Devices already running the target version are skipped, older images are
+refused unless --force. After an update the tool waits until the device
+is back with the new version and has passed the health gate (or reports
+the rollback). Exit code 1 if any device failed.
+
+Test without hardware: tools/mock_device.py.
+"""
+
+import argparse
+import gzip
+import hashlib
+import json
+import re
+import sys
+import threading
+import time
+import urllib.error
+import urllib.request
+import uuid
+from concurrent.futures import ThreadPoolExecutor
+
+VERSION_TAG = re.compile(rb"CCMON_VERSION=([0-9A-Za-z.\-+_]{1,31})\x00")
+
+print_lock = threading.Lock()
+
+
+def log(host, message):
+    with print_lock:
+        print(f"[{host}] {message}", flush=True)
+
+
+def image_version(data):
+    """Version marker compiled into the image (FIRMWARE_VERSION)."""
+    if data[:2] == b"\x1f\x8b":
+        data = gzip.decompress(data)
+    match = VERSION_TAG.search(data)
+    return match.group(1).decode() if match else None
+
+
+def version_key(version):
+    return tuple(int(part) if part.isdigit() else 0 for part in re.split(r"[.\-+]", version))
+
+
+class Device:
+    def __init__(self, host, timeout):
+        self.host = host
+        self.base = host if host.startswith("http") else "http://" + host
+        self.timeout = timeout
+
+    def request(self, method, path, body=None, headers=None):
+        """Returns (status code, JSON document); connection errors raise OSError."""
+        req = urllib.request.Request(self.base + path, data=body, method=method, headers=headers or {})
+        try:
+            with urllib.request.urlopen(req, timeout=self.timeout) as response:
+                return response.status, json.loads(response.read() or b"{}")
+        except urllib.error.HTTPError as err:
+            try:
+                doc = json.loads(err.read() or b"{}")
+            except ValueError:
+                doc = {}
+            return err.code, doc
+
+    def status(self):
+        code, doc = self.request("GET", "/api/ota/status")
+        if code != 200:
+            raise OSError(f"/api/ota/status returned {code}")
+        return doc
+
+    def upload(self, data, size, sha256, offset, filename):
+        boundary = uuid.uuid4().hex
+        body = (f"--{boundary}\r\n"
+                f'Content-Disposition: form-data; name="firmware"; filename="{filename}"\r\n'
+                f"Content-Type: application/octet-stream\r\n\r\n").encode() + data + f"\r\n--{boundary}--\r\n".encode()
+        path = f"/api/ota/upload?size={size}&sha256={sha256}"
+        if offset:
+            path += f"&offset={offset}"
+        return self.request("POST", path, body, {"Content-Type": f"multipart/form-data; boundary={boundary}"})
+
+    def post_json(self, path, doc):
+        return self.request("POST", path, json.dumps(doc).encode(), {"Content-Type": "application/json"})
+
+
+class Result:
+    def __init__(self, host):
+        self.host = host
+        self.outcome = "failed"
+        self.old_version = "?"
+        self.new_version = ""
+        self.attempts = 0
+        self.seconds = 0.0
+        self.message = ""
+
+
+def first_status(device, retries):
+    """Status before changing anything; busy or flaky devices get retries."""
+    for attempt in range(retries + 1):
+        try:
+            return device.status()
+        except (OSError, ValueError) as err:
+            if attempt == retries:
+                raise
+            log(device.host, f"status failed ({err}), retrying")
+            time.sleep(min(2 ** (attempt + 1), 30))
+
+
+def wait_for_device(device, timeout, target_version=None):
+    """Poll until the device answers again and (for updates) the health gate is settled."""
+    deadline = time.time() + timeout
+    time.sleep(2)
+    status = None
+    while time.time() < deadline:
+        try:
+            status = device.status()
+            health = status.get("health", {}).get("state", "valid")
+            if target_version is None or health == "valid":
+                return status
+        except (OSError, ValueError):
+            pass
+        time.sleep(2)
+    return status
+
+
+def push_firmware(host, args, image):
+    result = Result(host)
+    device = Device(host, args.timeout)
+    started = time.time()
+    size = len(image["data"])
+
+    try:
+        status = first_status(device, args.retries)
+    except (OSError, ValueError) as err:
+        result.message = f"unreachable: {err}"
+        return result
+
+    result.old_version = status.get("version", "?")
+    target = image["version"]
+    if not target and "version" in status and not args.force:
+        result.outcome, result.message = "skipped", "image has no version marker, pass --version or --force"
+        return result
+    if target and "version" in status and not args.force:
+        if version_key(status["version"]) == version_key(target):
+            result.outcome, result.new_version = "skipped", status["version"]
+            result.message = "already up to date"
+            return result
+        if version_key(status["version"]) > version_key(target):
+            result.outcome, result.message = "skipped", f"device is newer ({status['version']}), use --force"
+            return result
+
+    if args.dry_run:
+        result.outcome, result.message = "skipped", f"dry run: would update to {target or 'unknown version'}"
+        return result
+
+    offset = 0
+    done = False
+    while result.attempts <= args.retries and not done:
+        result.attempts += 1
+        try:
+            if result.attempts > 1:
+                # Continue an interrupted upload where the device stopped
+                status = device.status()
+                written = status.get("written", 0)
+                offset = written if status.get("resumable") and 0 < written < size else 0
+                log(host, f"retry {result.attempts - 1}/{args.retries}" + (f", resuming at {offset}" if offset else ""))
+
+            code, doc = device.upload(image["data"][offset:], size, image["sha256"], offset, image["name"])
+            if code == 200:
+                done = True
+            elif code == 202:
+                offset = doc.get("written", offset)
+                result.attempts -= 1   # Progress, not a failure
+            elif code in (429, 503):
+                result.message = f"device busy ({code})"
+            else:
+                result.message = doc.get("message", f"HTTP {code}")
+                log(host, f"upload failed: {result.message}")
+        except (OSError, ValueError) as err:
+            result.message = f"connection lost: {err}"
+            log(host, result.message)
+
+        if not done:
+            time.sleep(min(2 ** result.attempts, 30))
+
+    if not done:
+        result.seconds = time.time() - started
+        return result
+
+    log(host, f"uploaded {size} bytes, waiting for reboot and health gate")
+    status = wait_for_device(device, args.wait, target or "")
+    result.seconds = time.time() - started
+
+    if status is None:
+        result.message = "no answer after reboot"
+        return result
+
+    result.new_version = status.get("version", "?")
+    rollback = status.get("health", {}).get("lastRollback", "")
+    if rollback:
+        result.outcome, result.message = "rolled back", rollback
+    elif status.get("health", {}).get("state", "valid") != "valid":
+        result.message = "health gate still pending after --wait"
+    elif target and result.new_version != target:
+        result.message = f"running {result.new_version} instead of {target}"
+    else:
+        result.outcome, result.message = "updated", ""
+    return result
+
+
+def push_config(host, args, settings):
+    result = Result(host)
+    device = Device(host, args.timeout)
+    started = time.time()
+
+    try:
+        result.old_version = first_status(device, args.retries).get("version", "?")
+    except (OSError, ValueError) as err:
+        result.message = f"unreachable: {err}"
+        return result
+
+    if args.dry_run:
+        result.outcome, result.message = "skipped", "dry run"
+        return result
+
+    while result.attempts <= args.retries:
+        result.attempts += 1
+        try:
+            code, doc = device.post_json("/api/settings", settings)
+            if code == 200:
+                break
+            result.message = doc.get("message", f"HTTP {code}")
+            if code not in (429, 503):
+                result.seconds = time.time() - started
+                return result
+        except (OSError, ValueError) as err:
+            result.message = f"connection lost: {err}"
+        time.sleep(min(2 ** result.attempts, 30))
+    else:
+        result.seconds = time.time() - started
+        return result
+
+    # /api/settings restarts the device - report it once it is back
+    status = wait_for_device(device, args.wait) if args.wait > 0 else {}
+    result.seconds = time.time() - started
+    if status is None:
+        result.message = "no answer after restart"
+        return result
+    result.outcome = "applied"
+    result.new_version = status.get("version", "")
+    result.message = ""
+    return result
+
+
+def print_summary(results):
+    print()
+    print(f"{'HOST':<24} {'RESULT':<12} {'VERSION':<20} {'TRIES':>5} {'TIME':>7}  MESSAGE")
+    for r in results:
+        version = r.old_version + (f" -> {r.new_version}" if r.new_version and r.new_version != r.old_version else "")
+        print(f"{r.host:<24} {r.outcome:<12} {version:<20} {r.attempts:>5} {r.seconds:>6.1f}s  {r.message}")
+
+    counts = {}
+    for r in results:
+        counts[r.outcome] = counts.get(r.outcome, 0) + 1
+    print()
+    print(", ".join(f"{count} {outcome}" for outcome, count in sorted(counts.items())))
+
+
+def read_hosts(args):
+    hosts = list(args.hosts or [])
+    if args.hosts_file:
+        with open(args.hosts_file) as f:
+            for line in f:
+                line = line.split("#", 1)[0].strip()
+                if line:
+                    hosts.append(line)
+    # Keep order, drop duplicates
+    return list(dict.fromkeys(hosts))
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Update many monitors in parallel")
+    sub = parser.add_subparsers(dest="command", required=True)
+
+    fw = sub.add_parser("firmware", help="upload a firmware image (.bin or .bin.gz)")
+    fw.add_argument("image")
+    fw.add_argument("--version", help="target version (default: read from the image)")
+    fw.add_argument("--force", action="store_true", help="also update devices on the same or a newer version")
+
+    cfg = sub.add_parser("config", help="send a settings JSON to /api/settings")
+    cfg.add_argument("settings")
+
+    for p in (fw, cfg):
+        p.add_argument("--hosts", nargs="+", help="device addresses (ip or ip:port)")
+        p.add_argument("--hosts-file", help="file with one address per line (# comments)")
+        p.add_argument("--jobs", type=int, default=4, help="devices updated at the same time (default 4)")
+        p.add_argument("--retries", type=int, default=3, help="retries per device (default 3)")
+        p.add_argument("--timeout", type=float, default=60, help="seconds per HTTP request (default 60)")
+        p.add_argument("--wait", type=float, default=240,
+                       help="seconds to wait for a device after reboot, covers the health gate (default 240)")
+        p.add_argument("--dry-run", action="store_true", help="only check versions, change nothing")
+        p.add_argument("--json", help="also write the summary to this file")
+
+    args = parser.parse_args()
+    hosts = read_hosts(args)
+    if not hosts:
+        parser.error("no devices given (--hosts or --hosts-file)")
+
+    if args.command == "firmware":
+        with open(args.image, "rb") as f:
+            data = f.read()
+        image = {
+            "data": data,
+            "name": args.image.replace("\\", "/").rsplit("/", 1)[-1],
+            "sha256": hashlib.sha256(data).hexdigest(),
+            "version": args.version or image_version(data),
+        }
+        print(f"image {image['name']}: {len(data)} bytes, version {image['version'] or 'unknown'}, "
+              f"sha256 {image['sha256'][:16]}...")
+        work = lambda host: push_firmware(host, args, image)
+    else:
+        with open(args.settings) as f:
+            settings = json.load(f)
+        work = lambda host: push_config(host, args, settings)
+
+    print(f"{len(hosts)} devices, {args.jobs} at a time")
+    with ThreadPoolExecutor(max_workers=max(1, args.jobs)) as pool:
+        results = list(pool.map(work, hosts))
+
+    print_summary(results)
+    if args.json:
+        with open(args.json, "w") as f:
+            json.dump([vars(r) for r in results], f, indent=2)
+            f.write("\n")
+
+    return 1 if any(r.outcome in ("failed", "rolled back") for r in results) else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,304 @@
+#!/usr/bin/env python3
+"""
+Decode the tokenized log of a -DLOG_BINARY build (see src/logger.h).
+
+The firmware only sends a 32-bit id per message; the id is the FNV-1a hash
+of level, tag and format string of the LOGx() call. This tool rebuilds the
+id table from the sources, so it must see the same src/ the image was
+built from (or a table written with 'table' at build time).
+
+    # Live from USB (needs pyserial), text output of other modules passes through
+    python3 tools/logdecode.py --serial /dev/ttyACM0
+
+    # Captured stream, e.g. from 'pio device monitor --raw > log.bin'
+    python3 tools/logdecode.py log.bin
+
+    # Ring tail over WiFi, --follow keeps polling /api/logs
+    python3 tools/logdecode.py --host 192.168.1.42 --follow
+
+    # Write the id table next to a release image
+    python3 tools/logdecode.py table -o firmware/logtable.json
+"""
+
+import argparse
+import codecs
+import json
+import os
+import re
+import struct
+import sys
+import time
+import urllib.request
+
+FRAME_START = 0x1E
+LEVELS = {"E": 1, "W": 2, "I": 3, "D": 4, "V": 5}
+
+STRING = r'"(?:[^"\\]|\\.)*"'
+CALL = re.compile(r"\bLOG([EWIDV])\(\s*(" + STRING + r")\s*,\s*((?:" + STRING + r"\s*)+)")
+CONVERSION = re.compile(r"%([-+ #0]*)(\*|\d+)?(?:\.(\*|\d+))?(hh|h|ll|l|z|j|t|L)?([diouxXeEfgGaAcsp%])")
+
+
+def c_string(literals):
+    """Bytes of one or more adjacent C string literals."""
+    out = bytearray()
+    for literal in re.findall(STRING, literals):
+        body = literal[1:-1].encode()
+        i = 0
+        while i < len(body):
+            c = body[i]
+            if c != 0x5C:
+                out.append(c)
+                i += 1
+                continue
+            esc = chr(body[i + 1])
+            i += 2
+            if esc in "01234567":
+                digits = esc
+                while len(digits) < 3 and i < len(body) and chr(body[i]) in "01234567":
+                    digits += chr(body[i])
+                    i += 1
+                out.append(int(digits, 8) & 0xFF)
+            elif esc == "x":
+                digits = ""
+                while i < len(body) and chr(body[i]) in "0123456789abcdefABCDEF":
+                    digits += chr(body[i])
+                    i += 1
+                out.append(int(digits, 16) & 0xFF)
+            else:
+                out.append(ord({"n": "\n", "t": "\t", "r": "\r", "a": "\a", "b": "\b",
+                                "f": "\f", "v": "\v"}.get(esc, esc)))
+    return bytes(out)
+
+
+def format_id(level, tag, fmt):
+    """Same hash as logFormatId() in src/logger.h."""
+    h = 2166136261
+    for byte in bytes([level]) + tag + b"\x00" + fmt:
+        h = ((h ^ byte) * 16777619) & 0xFFFFFFFF
+    return h
+
+
+def build_table(src):
+    table = {}
+    for root, _, files in os.walk(src):
+        for name in sorted(files):
+            if not name.endswith((".cpp", ".h", ".c")):
+                continue
+            path = os.path.join(root, name)
+            with open(path, encoding="utf-8") as f:
+                text = f.read()
+            for match in CALL.finditer(text):
+                level = LEVELS[match.group(1)]
+                tag, fmt = c_string(match.group(2)), c_string(match.group(3))
+                entry = {"level": match.group(1), "tag": tag.decode(), "format": fmt.decode(),
+                         "where": f"{os.path.relpath(path, src)}:{text.count(chr(10), 0, match.start()) + 1}"}
+                key = format_id(level, tag, fmt)
+                other = table.get(key)
+                if other and (other["tag"], other["format"]) != (entry["tag"], entry["format"]):
+                    print(f"warning: id {key:08x} collides: {other['where']} and {entry['where']}", file=sys.stderr)
+                table.setdefault(key, entry)
+    return table
+
+
+def load_table(args):
+    if args.table:
+        with open(args.table) as f:
+            return {int(key, 16): entry for key, entry in json.load(f).items()}
+    return build_table(args.src)
+
+
+def render(entry, data):
+    """printf-style output from the packed arguments."""
+    values = []
+    pos = 0
+    missing = False
+
+    def take(size):
+        nonlocal pos, missing
+        if pos + size > len(data):
+            missing = True
+            return None
+        chunk = data[pos:pos + size]
+        pos += size
+        return chunk
+
+    def take_int(signed, size=4):
+        raw = take(size)
+        if raw is None:
+            return 0
+        return int.from_bytes(raw, "little", signed=signed)
+
+    pieces = []
+    last = 0
+    fmt = entry["format"]
+    for match in CONVERSION.finditer(fmt):
+        pieces.append(fmt[last:match.start()].replace("%", "%%"))
+        last = match.end()
+        flags, width, precision, length, kind = match.groups()
+        if kind == "%":
+            pieces.append("%%")
+            continue
+        if width == "*":
+            values.append(take_int(True))
+        if precision == "*":
+            values.append(take_int(True))
+        size = 8 if length == "ll" else 4
+        if kind in "di":
+            values.append(take_int(True, size))
+        elif kind in "ouxXc":
+            values.append(take_int(False, size))
+        elif kind in "eEfgGaA":
+            raw = take(4)
+            values.append(struct.unpack("<f", raw)[0] if raw else 0.0)
+            kind = "f" if kind in "aA" else kind
+        elif kind == "s":
+            raw = take(1)
+            text = take(raw[0]) if raw else b""
+            values.append((text or b"").decode("utf-8", "replace"))
+        elif kind == "p":
+            values.append(take_int(False))
+            kind = "x"
+        pieces.append("%" + flags + (width or "") + ("." + precision if precision else "") + kind)
+    pieces.append(fmt[last:].replace("%", "%%"))
+
+    try:
+        text = "".join(pieces) % tuple(values)
+    except (TypeError, ValueError):
+        text = fmt + " " + data.hex()
+    if missing:
+        text += " …"
+    prefix = {"E": "ERROR: ", "W": "WARNING: "}.get(entry["level"], "")
+    return f"[{entry['tag']}] {prefix}{text}"
+
+
+def decode_message(table, ident, ms, data, show_time):
+    entry = table.get(ident)
+    line = render(entry, data) if entry else f"[LOG] unknown id {ident:08x} ({data.hex()}) - sources do not match the image?"
+    return f"{ms / 1000:10.3f} {line}" if show_time else line
+
+
+def crc8(data):
+    crc = 0
+    for byte in data:
+        crc ^= byte
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x07) & 0xFF if crc & 0x80 else (crc << 1) & 0xFF
+    return crc
+
+
+class StreamDecoder:
+    """Splits a byte stream into plain text and log frames."""
+
+    def __init__(self, table, show_time, out):
+        self.table = table
+        self.show_time = show_time
+        self.out = out
+        self.buffer = bytearray()
+        self.text = codecs.getincrementaldecoder("utf-8")("replace")   # Emoji may span reads
+
+    def feed(self, chunk):
+        self.buffer += chunk
+        while self.buffer:
+            start = self.buffer.find(FRAME_START)
+            if start != 0:
+                # Plain text up to the next frame
+                end = len(self.buffer) if start < 0 else start
+                self.out.write(self.text.decode(bytes(self.buffer[:end])))
+                del self.buffer[:end]
+                continue
+            if len(self.buffer) < 2 or len(self.buffer) < 3 + self.buffer[1]:
+                return   # Frame incomplete
+            length = self.buffer[1]
+            payload = bytes(self.buffer[2:2 + length])
+            if length < 8 or crc8(payload) != self.buffer[2 + length]:
+                self.out.write(chr(FRAME_START))   # Not a frame after all
+                del self.buffer[:1]
+                continue
+            ident, ms = struct.unpack_from("<II", payload)
+            self.out.write(decode_message(self.table, ident, ms, payload[8:], self.show_time) + "\n")
+            del self.buffer[:3 + length]
+        self.out.flush()
+
+
+def read_serial(args, decoder):
+    try:
+        import serial
+    except ImportError:
+        sys.exit("--serial needs pyserial (pip install pyserial)")
+    with serial.Serial(args.serial, args.baud, timeout=0.2) as port:
+        while True:
+            decoder.feed(port.read(256))
+
+
+def read_host(args, table):
+    base = args.host if args.host.startswith("http") else "http://" + args.host
+    since = None
+    while True:
+        url = base + "/api/logs" + (f"?since={since}" if since is not None else "")
+        with urllib.request.urlopen(url, timeout=10) as response:
+            doc = json.load(response)
+        for item in doc.get("entries", []):
+            if "id" in item:
+                line = decode_message(table, item["id"], item["ms"], bytes.fromhex(item["data"]), True)
+            else:
+                prefix = {"E": "ERROR: ", "W": "WARNING: "}.get(item["level"], "")
+                line = f"{item['ms'] / 1000:10.3f} [{item['tag']}] {prefix}{item['msg']}"
+            print(line, flush=True)
+        since = doc.get("next", since)
+        if not args.follow:
+            return
+        time.sleep(args.interval)
+
+
+def main():
+    default_src = os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "src")
+    if len(sys.argv) > 1 and sys.argv[1] == "table":
+        parser = argparse.ArgumentParser(description="Write the log id table")
+        parser.add_argument("command")
+        parser.add_argument("--src", default=default_src, help="firmware sources (default: ../src)")
+        parser.add_argument("-o", "--output", help="output file (default: stdout)")
+        args = parser.parse_args()
+        table = {f"{key:08x}": entry for key, entry in sorted(build_table(args.src).items())}
+        text = json.dumps(table, indent=2, ensure_ascii=False) + "\n"
+        if args.output:
+            with open(args.output, "w", encoding="utf-8") as f:
+                f.write(text)
+            print(f"{len(table)} messages -> {args.output}", file=sys.stderr)
+        else:
+            sys.stdout.write(text)
+        return 0
+
+    parser = argparse.ArgumentParser(description="Decode the tokenized log of a LOG_BINARY build")
+    parser.add_argument("input", nargs="?", help="captured stream (default: stdin)")
+    parser.add_argument("--serial", help="read from a serial port, e.g. /dev/ttyACM0 or COM5")
+    parser.add_argument("--baud", type=int, default=115200)
+    parser.add_argument("--host", help="read /api/logs from this device instead")
+    parser.add_argument("--follow", action="store_true", help="with --host: keep polling")
+    parser.add_argument("--interval", type=float, default=2, help="poll interval for --follow (default 2 s)")
+    parser.add_argument("--src", default=default_src, help="firmware sources for the id table (default: ../src)")
+    parser.add_argument("--table", help="id table written by 'logdecode.py table' instead of --src")
+    parser.add_argument("--time", action="store_true", help="prefix stream messages with the device uptime")
+    args = parser.parse_args()
+
+    table = load_table(args)
+    try:
+        if args.host:
+            read_host(args, table)
+            return 0
+        decoder = StreamDecoder(table, args.time, sys.stdout)
+        if args.serial:
+            read_serial(args, decoder)
+        stream = open(args.input, "rb") if args.input else sys.stdin.buffer
+        with stream:
+            while True:
+                chunk = stream.read1(4096) if hasattr(stream, "read1") else stream.read(4096)
+                if not chunk:
+                    break
+                decoder.feed(chunk)
+    except KeyboardInterrupt:
+        pass
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,265 @@
+#!/usr/bin/env python3
+"""
+Mock monitor for testing tools/fleet_update.py without hardware.
+
+Emulates /api/ota/status, /api/ota/upload (size, sha256, offset, gzip
+images) and /api/settings of the firmware, including the reboot after a
+successful update. Several devices run on consecutive ports:
+
+    python3 tools/mock_device.py --count 5 --port 8081
+    python3 tools/fleet_update.py firmware firmware/firmware.bin \\
+        --hosts 127.0.0.1:8081 127.0.0.1:8082 127.0.0.1:8083 127.0.0.1:8084 127.0.0.1:8085
+
+Failure injection (per device index, comma separated):
+    --drop 1,3       first upload is cut off halfway (tests resume)
+    --rollback 2     new image fails the health gate and rolls back
+    --busy 4         first two requests get 503 (admission control)
+"""
+
+import argparse
+import gzip
+import hashlib
+import json
+import re
+import sys
+import threading
+import time
+from http.server import BaseHTTPRequestHandler, ThreadingHTTPServer
+from urllib.parse import parse_qs, urlparse
+
+VERSION_TAG = re.compile(rb"CCMON_VERSION=([0-9A-Za-z.\-+_]{1,31})\x00")
+
+
+def image_version(data):
+    """Version marker of a plain or gzip image (None if not found)."""
+    if data[:2] == b"\x1f\x8b":
+        try:
+            data = gzip.decompress(data)
+        except OSError:
+            return None
+    match = VERSION_TAG.search(data)
+    return match.group(1).decode() if match else None
+
+
+class Device:
+    def __init__(self, index, version, reboot_seconds, drop, rollback, busy):
+        self.index = index
+        self.version = version
+        self.reboot_seconds = reboot_seconds
+        self.drop = drop
+        self.rollback = rollback
+        self.busy = 2 if busy else 0
+        self.lock = threading.Lock()
+        self.offline_until = 0.0
+        self.last_rollback = ""
+        self.reset_upload()
+        self.status = 0
+
+    def reset_upload(self):
+        self.status = 0          # 0 idle, 1 updating, 2 success, 3 error
+        self.error = ""
+        self.data = bytearray()
+        self.total = 0
+        self.sha256 = ""
+        self.image_sha = ""
+        self.last_chunk = 0.0
+
+    def reboot(self, new_version=None):
+        self.offline_until = time.time() + self.reboot_seconds
+        if new_version and self.rollback:
+            self.last_rollback = "printer not reachable"
+        elif new_version:
+            self.version = new_version
+            self.last_rollback = ""
+        self.reset_upload()
+
+    def status_document(self):
+        return {
+            "version": self.version,
+            "status": self.status,
+            "progress": int(len(self.data) * 100 / self.total) if self.total else 0,
+            "error": self.error,
+            "written": len(self.data),
+            "total": self.total,
+            "resumable": self.status == 1 and time.time() - self.last_chunk < 300,
+            "sha256": self.image_sha,
+            "compressed": self.data[:2] == b"\x1f\x8b",
+            "inflated": 0,
+            "health": {"state": "valid", "bootloaderRollback": False, "remainingMs": 0,
+                       "wifi": True, "printer": True, "sensor": True,
+                       "lastRollback": self.last_rollback},
+            "currentPartition": "app0",
+            "nextPartition": "app1",
+        }
+
+
+def multipart_file(body, content_type):
+    """Payload of the first part of a multipart/form-data body."""
+    match = re.search(r'boundary="?([^";]+)"?', content_type or "")
+    if not match:
+        return None
+    boundary = b"--" + match.group(1).encode()
+    start = body.find(boundary)
+    header_end = body.find(b"\r\n\r\n", start)
+    end = body.find(b"\r\n" + boundary, header_end)
+    if start < 0 or header_end < 0 or end < 0:
+        return None
+    return body[header_end + 4:end]
+
+
+def make_handler(device):
+    class Handler(BaseHTTPRequestHandler):
+        protocol_version = "HTTP/1.1"
+
+        def log_message(self, fmt, *args):
+            sys.stderr.write(f"[dev{device.index}:{self.server.server_port}] {fmt % args}\n")
+
+        def send_json(self, code, doc):
+            body = json.dumps(doc).encode()
+            self.send_response(code)
+            self.send_header("Content-Type", "application/json")
+            self.send_header("Content-Length", str(len(body)))
+            self.end_headers()
+            self.wfile.write(body)
+
+        def unavailable(self):
+            """Rebooting devices drop the connection, busy ones answer 503."""
+            if time.time() < device.offline_until:
+                self.close_connection = True
+                self.connection.close()
+                return True
+            if device.busy > 0:
+                device.busy -= 1
+                self.send_json(503, {"success": False, "message": "Server busy"})
+                return True
+            return False
+
+        def read_body(self):
+            length = int(self.headers.get("Content-Length", 0))
+            return self.rfile.read(length)
+
+        def do_GET(self):
+            with device.lock:
+                if self.unavailable():
+                    return
+                if urlparse(self.path).path == "/api/ota/status":
+                    self.send_json(200, device.status_document())
+                else:
+                    self.send_json(404, {"success": False, "message": "Not found"})
+
+        def do_POST(self):
+            url = urlparse(self.path)
+            query = {k: v[0] for k, v in parse_qs(url.query).items()}
+            body = self.read_body()
+            with device.lock:
+                if self.unavailable():
+                    return
+                if url.path == "/api/ota/upload":
+                    self.upload(query, body)
+                elif url.path == "/api/settings":
+                    self.settings(body)
+                else:
+                    self.send_json(404, {"success": False, "message": "Not found"})
+
+        def upload(self, query, body):
+            chunk = multipart_file(body, self.headers.get("Content-Type"))
+            if chunk is None:
+                self.send_json(400, {"success": False, "message": "Expected multipart/form-data"})
+                return
+
+            offset = int(query.get("offset", 0))
+            sha = query.get("sha256", "")
+            if offset > 0:
+                if device.status != 1 or offset != len(device.data) or sha != device.sha256:
+                    self.send_json(500, {"success": False,
+                                         "message": f"Resume offset mismatch, expected {len(device.data)}"})
+                    return
+            else:
+                device.reset_upload()
+                device.status = 1
+                device.sha256 = sha
+                device.total = int(query.get("size", 0))
+
+            if device.drop and offset == 0:
+                # Connection lost halfway through the first upload
+                device.drop = False
+                device.data += chunk[:len(chunk) // 2]
+                device.last_chunk = time.time()
+                self.close_connection = True
+                self.connection.close()
+                return
+
+            device.data += chunk
+            device.last_chunk = time.time()
+
+            if device.total and len(device.data) > device.total:
+                device.status, device.error = 3, "More data than the announced firmware size"
+            elif device.total and len(device.data) < device.total:
+                self.send_json(202, {"success": True, "message": "Partial upload stored",
+                                     "written": len(device.data), "total": device.total})
+                return
+            else:
+                device.image_sha = hashlib.sha256(device.data).hexdigest()
+                if device.sha256 and device.sha256 != device.image_sha:
+                    device.status, device.error = 3, "SHA-256 mismatch, image rejected"
+
+            if device.status == 3:
+                self.send_json(500, {"success": False, "message": device.error})
+                return
+
+            self.send_json(200, {"success": True, "message": "Firmware uploaded successfully. Rebooting...",
+                                 "sha256": device.image_sha})
+            device.reboot(image_version(bytes(device.data)) or device.version)
+
+        def settings(self, body):
+            try:
+                doc = json.loads(body)
+            except ValueError:
+                self.send_json(400, {"success": False, "message": "Invalid JSON"})
+                return
+            if isinstance(doc.get("wifiSSID"), str) and isinstance(doc.get("wifiPassword"), str):
+                self.send_json(200, {"success": True, "message": "WiFi settings saved. Restarting..."})
+            elif isinstance(doc.get("printerIP"), str):
+                self.send_json(200, {"success": True, "message": "Settings saved. Restarting..."})
+            else:
+                self.send_json(400, {"success": False, "message": "No settings to update"})
+                return
+            device.reboot()
+
+    return Handler
+
+
+def index_list(value):
+    return {int(i) for i in value.split(",") if i} if value else set()
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Mock monitor devices for fleet_update.py")
+    parser.add_argument("--port", type=int, default=8081, help="port of the first device")
+    parser.add_argument("--count", type=int, default=1, help="number of devices")
+    parser.add_argument("--version", default="1.0.0", help="firmware version the devices start with")
+    parser.add_argument("--reboot-seconds", type=float, default=3.0)
+    parser.add_argument("--drop", type=index_list, default=set(), help="devices that drop the first upload")
+    parser.add_argument("--rollback", type=index_list, default=set(), help="devices that roll back updates")
+    parser.add_argument("--busy", type=index_list, default=set(), help="devices that answer 503 twice")
+    args = parser.parse_args()
+
+    servers = []
+    for i in range(args.count):
+        device = Device(i, args.version, args.reboot_seconds,
+                        i in args.drop, i in args.rollback, i in args.busy)
+        server = ThreadingHTTPServer(("127.0.0.1", args.port + i), make_handler(device))
+        threading.Thread(target=server.serve_forever, daemon=True).start()
+        servers.append(server)
+        print(f"device {i}: http://127.0.0.1:{args.port + i} (version {args.version})", flush=True)
+
+    try:
+        while True:
+            time.sleep(3600)
+    except KeyboardInterrupt:
+        for server in servers:
+            server.shutdown()
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,70 @@
+#!/usr/bin/env python3
+"""
+Pack a firmware image for compressed OTA upload.
+
+Writes <firmware>.gz (gzip, level 9) and prints the values for
+/api/ota/upload: size and sha256 refer to the compressed file, the
+device inflates it while writing the update partition.
+
+    python3 tools/ota_pack.py firmware/firmware.bin
+    python3 tools/ota_pack.py firmware/firmware.bin -o fw.bin.gz --manifest fw.json
+"""
+
+import argparse
+import gzip
+import hashlib
+import json
+import os
+import sys
+
+ESP_IMAGE_MAGIC = 0xE9
+
+
+def main():
+    parser = argparse.ArgumentParser(description="gzip a firmware image for OTA upload")
+    parser.add_argument("firmware", help="firmware .bin")
+    parser.add_argument("-o", "--output", help="output file (default: <firmware>.gz)")
+    parser.add_argument("--manifest", help="also write size/sha256 as JSON")
+    parser.add_argument("--host", default="<ip>", help="device address for the printed curl command")
+    args = parser.parse_args()
+
+    with open(args.firmware, "rb") as f:
+        image = f.read()
+
+    if not image or image[0] != ESP_IMAGE_MAGIC:
+        print(f"error: {args.firmware} is not an ESP32 app image", file=sys.stderr)
+        return 1
+
+    # mtime=0 keeps the output reproducible for the same image
+    packed = gzip.compress(image, compresslevel=9, mtime=0)
+    output = args.output or args.firmware + ".gz"
+    with open(output, "wb") as f:
+        f.write(packed)
+
+    sha256 = hashlib.sha256(packed).hexdigest()
+    ratio = 100.0 * len(packed) / len(image)
+
+    print(f"image:      {len(image)} bytes")
+    print(f"compressed: {len(packed)} bytes ({ratio:.1f}%) -> {output}")
+    print(f"sha256:     {sha256}")
+    print()
+    print(f'curl -F "firmware=@{output}" '
+          f'"http://{args.host}/api/ota/upload?size={len(packed)}&sha256={sha256}"')
+
+    if args.manifest:
+        manifest = {
+            "file": os.path.basename(output),
+            "size": len(packed),
+            "sha256": sha256,
+            "imageSize": len(image),
+            "imageSha256": hashlib.sha256(image).hexdigest(),
+        }
+        with open(args.manifest, "w") as f:
+            json.dump(manifest, f, indent=2)
+            f.write("\n")
+
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
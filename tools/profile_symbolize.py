@@ -0,0 +1,235 @@
+#!/usr/bin/env python3
+"""
+Turn a /api/profile sample histogram into a flat profile or flame graph input.
+
+The device records only raw program counters; this script maps them to
+functions using the symbol table of the firmware ELF that is running on
+the device (same build!). No toolchain needed; with --lines the PlatformIO
+addr2line is used for source lines.
+
+    # Sample for 20 s, then symbolize
+    python3 tools/profile_symbolize.py --host 192.168.1.42 --start 20 \\
+        --elf .pio/build/nologo_esp32c3_super_mini/firmware.elf
+
+    # Saved histogram (curl http://<ip>/api/profile > profile.json)
+    python3 tools/profile_symbolize.py profile.json --elf firmware.elf --by-task
+
+    # Flame graph: flamegraph.pl profile.folded > profile.svg, or open in speedscope.app
+    python3 tools/profile_symbolize.py profile.json --elf firmware.elf --collapsed profile.folded
+
+Only the interrupted PC is sampled (no call stacks), so the flame graph
+has two levels: task and function.
+"""
+
+import argparse
+import bisect
+import glob
+import json
+import os
+import shutil
+import struct
+import subprocess
+import sys
+import time
+import urllib.request
+
+STT_FUNC = 2
+SHN_UNDEF = 0
+ROM_RANGE = (0x40000000, 0x40060000)   # ESP32-C3 mask ROM (not part of the ELF)
+NEAREST_LIMIT = 4096                   # Max distance to an unsized symbol
+
+
+def read_symbols(path):
+    """(address, size, name) for all defined symbols of an ELF32/ELF64 file."""
+    with open(path, "rb") as f:
+        data = f.read()
+    if data[:4] != b"\x7fELF":
+        sys.exit(f"{path} is not an ELF file")
+    is64 = data[4] == 2
+    endian = "<" if data[5] == 1 else ">"
+
+    if is64:
+        shoff, = struct.unpack_from(endian + "Q", data, 0x28)
+        shentsize, shnum = struct.unpack_from(endian + "HH", data, 0x3A)
+    else:
+        shoff, = struct.unpack_from(endian + "I", data, 0x20)
+        shentsize, shnum = struct.unpack_from(endian + "HH", data, 0x2E)
+
+    sections = []
+    for i in range(shnum):
+        base = shoff + i * shentsize
+        if is64:
+            name, kind, _, _, offset, size, link, _, _, entsize = struct.unpack_from(endian + "IIQQQQIIQQ", data, base)
+        else:
+            name, kind, _, _, offset, size, link, _, _, entsize = struct.unpack_from(endian + "IIIIIIIIII", data, base)
+        sections.append((kind, offset, size, link, entsize))
+
+    symbols = []
+    for kind, offset, size, link, entsize in sections:
+        if kind != 2:   # SHT_SYMTAB
+            continue
+        strtab_offset = sections[link][1]
+        for pos in range(offset, offset + size, entsize):
+            if is64:
+                name, info, _, shndx, value, sym_size = struct.unpack_from(endian + "IBBHQQ", data, pos)
+            else:
+                name, value, sym_size, info, _, shndx = struct.unpack_from(endian + "IIIBBH", data, pos)
+            if shndx == SHN_UNDEF or value == 0 or name == 0:
+                continue
+            end = data.index(b"\x00", strtab_offset + name)
+            symbol = data[strtab_offset + name:end].decode(errors="replace")
+            if symbol.startswith("$") or symbol.startswith(".L"):
+                continue
+            symbols.append((value & ~1, sym_size if info & 0xF == STT_FUNC else 0, symbol))
+    if not symbols:
+        sys.exit(f"{path} has no symbol table (stripped?)")
+    symbols.sort()
+    return symbols
+
+
+class Symbolizer:
+    def __init__(self, elf):
+        self.symbols = read_symbols(elf)
+        self.addresses = [s[0] for s in self.symbols]
+
+    def function(self, pc):
+        index = bisect.bisect_right(self.addresses, pc) - 1
+        # Prefer a sized function that contains pc (several symbols may share an address)
+        i = index
+        while i >= 0 and pc - self.symbols[i][0] < 0x10000:
+            address, size, name = self.symbols[i]
+            if size and address <= pc < address + size:
+                return name
+            i -= 1
+        if index >= 0 and pc - self.symbols[index][0] < NEAREST_LIMIT:
+            return self.symbols[index][2]
+        if ROM_RANGE[0] <= pc < ROM_RANGE[1]:
+            return "[rom]"
+        return f"[unknown 0x{pc:08x}]"
+
+
+def find_tool(name):
+    found = shutil.which("riscv32-esp-elf-" + name) or shutil.which(name)
+    if found:
+        return found
+    pattern = os.path.expanduser(f"~/.platformio/packages/toolchain-riscv32-esp/bin/riscv32-esp-elf-{name}*")
+    matches = glob.glob(pattern)
+    return matches[0] if matches else None
+
+
+def demangle(names):
+    tool = find_tool("c++filt")
+    if not tool or not names:
+        return {n: n for n in names}
+    result = subprocess.run([tool], input="\n".join(names), capture_output=True, text=True)
+    lines = result.stdout.splitlines()
+    if result.returncode != 0 or len(lines) != len(names):
+        return {n: n for n in names}
+    return dict(zip(names, lines))
+
+
+def source_lines(elf, pcs):
+    tool = find_tool("addr2line")
+    if not tool:
+        sys.exit("--lines needs addr2line (PlatformIO RISC-V toolchain or binutils in PATH)")
+    result = subprocess.run([tool, "-e", elf], input="\n".join(f"0x{pc:x}" for pc in pcs),
+                            capture_output=True, text=True)
+    lines = result.stdout.splitlines()
+    return dict(zip(pcs, lines)) if len(lines) == len(pcs) else {}
+
+
+def fetch_profile(args):
+    base = args.host if args.host.startswith("http") else "http://" + args.host
+    if args.start:
+        urllib.request.urlopen(f"{base}/api/profile?start={args.start}", timeout=10).read()
+        print(f"sampling for {args.start} s ...", file=sys.stderr)
+        time.sleep(args.start + 1)
+    while True:
+        with urllib.request.urlopen(base + "/api/profile", timeout=30) as response:
+            profile = json.load(response)
+        if not profile.get("running"):
+            return profile
+        time.sleep(1)
+
+
+def print_table(rows, total, label):
+    print(f"{'SAMPLES':>8} {'%':>6}  {label}")
+    for key, count in rows:
+        print(f"{count:>8} {100.0 * count / total:>5.1f}%  {key}")
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Symbolize a /api/profile histogram")
+    parser.add_argument("profile", nargs="?", help="saved /api/profile JSON")
+    parser.add_argument("--host", help="fetch the histogram from this device instead")
+    parser.add_argument("--start", type=int, help="with --host: start a run of this many seconds first")
+    parser.add_argument("--elf", required=True, help="firmware.elf of the image running on the device")
+    parser.add_argument("--by-task", action="store_true", help="separate table per task")
+    parser.add_argument("--lines", action="store_true", help="per source line instead of per function (addr2line)")
+    parser.add_argument("--top", type=int, default=40, help="rows per table (default 40, 0 = all)")
+    parser.add_argument("--collapsed", help="write task;function counts for flamegraph.pl / speedscope")
+    args = parser.parse_args()
+
+    if args.host:
+        profile = fetch_profile(args)
+    elif args.profile:
+        with open(args.profile) as f:
+            profile = json.load(f)
+    else:
+        parser.error("give a saved profile or --host")
+
+    if not profile.get("supported", True):
+        sys.exit("PC sampling is not supported on this chip")
+    pcs = profile.get("pcs", [])
+    if not pcs:
+        sys.exit("profile is empty - start a run with /api/profile?start=<seconds>")
+
+    tasks = profile.get("tasks", [])
+    task_name = lambda index: tasks[index] if index < len(tasks) else "other"
+
+    symbolizer = Symbolizer(args.elf)
+    names = demangle(sorted({symbolizer.function(pc) for pc, _, _ in pcs}))
+    lines = source_lines(args.elf, sorted({pc for pc, _, _ in pcs})) if args.lines else {}
+
+    def location(pc):
+        function = names[symbolizer.function(pc)]
+        return f"{function}  {lines.get(pc, '?')}" if args.lines else function
+
+    total = sum(count for _, _, count in pcs)
+    print(f"{total} samples at {profile.get('hz', '?')} Hz, {profile.get('dropped', 0)} dropped, "
+          f"{len(pcs)} distinct PCs")
+
+    per_task = {}
+    per_location = {}
+    for pc, task, count in pcs:
+        key = location(pc)
+        per_location[key] = per_location.get(key, 0) + count
+        bucket = per_task.setdefault(task_name(task), {})
+        bucket[key] = bucket.get(key, 0) + count
+
+    print()
+    task_totals = sorted(((name, sum(b.values())) for name, b in per_task.items()), key=lambda r: -r[1])
+    print_table(task_totals, total, "TASK")
+
+    limit = args.top or None
+    if args.by_task:
+        for name, task_total in task_totals:
+            print(f"\n== {name} ==")
+            print_table(sorted(per_task[name].items(), key=lambda r: -r[1])[:limit], total,
+                        "LINE" if args.lines else "FUNCTION")
+    else:
+        print()
+        print_table(sorted(per_location.items(), key=lambda r: -r[1])[:limit], total,
+                    "LINE" if args.lines else "FUNCTION")
+
+    if args.collapsed:
+        with open(args.collapsed, "w") as f:
+            for name, bucket in sorted(per_task.items()):
+                for key, count in sorted(bucket.items()):
+                    f.write(f"{name};{key.replace(';', ':')} {count}\n")
+        print(f"\ncollapsed stacks -> {args.collapsed}", file=sys.stderr)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())